@@ -0,0 +1,274 @@
+#include "parallel.hpp"
+
+#include "cgp/base/error/error.hpp"
+#include "cgp/base/profiler/profiler.hpp"
+
+namespace cgp
+{
+	// Index of the current thread in the queues of the pool it works for (external threads use the shared queue)
+	static thread_local thread_pool const* current_pool = nullptr;
+	static thread_local int current_index = -1;
+
+	thread_pool::thread_pool(int thread_count)
+	{
+		int const workers = thread_count > 1 ? thread_count - 1 : 0;
+		for (int k = 0; k < workers + 1; ++k)
+			queues.push_back(std::unique_ptr<task_queue>(new task_queue));
+		for (int k = 0; k < workers; ++k)
+			threads.push_back(std::thread(&thread_pool::worker, this, k));
+	}
+
+	thread_pool::~thread_pool()
+	{
+		{
+			std::lock_guard<std::mutex> guard(sleep_lock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& t : threads)
+			t.join();
+	}
+
+	int thread_pool::size() const
+	{
+		return int(threads.size()) + 1;
+	}
+
+	void thread_pool::submit(std::function<void()> run, task_counter& counter)
+	{
+		counter.pending++;
+		int const self = current_pool == this ? current_index : int(threads.size());
+		{
+			std::lock_guard<std::mutex> guard(queues[self]->lock);
+			queues[self]->tasks.push_back({ std::move(run), &counter });
+		}
+		queued++;
+
+		// Lock before notifying so that a worker about to sleep cannot miss the new task
+		{
+			std::lock_guard<std::mutex> guard(sleep_lock);
+		}
+		wake.notify_one();
+	}
+
+	bool thread_pool::run_one(int self)
+	{
+		if (queued.load() == 0)
+			return false;
+
+		task t;
+		bool found = false;
+
+		// Own tasks first (last pushed, still in cache), then steal the oldest task of the others
+		{
+			std::lock_guard<std::mutex> guard(queues[self]->lock);
+			if (!queues[self]->tasks.empty()) {
+				t = std::move(queues[self]->tasks.back());
+				queues[self]->tasks.pop_back();
+				found = true;
+			}
+		}
+		int const N = int(queues.size());
+		for (int k = 1; !found && k < N; ++k) {
+			task_queue& victim = *queues[(self + k) % N];
+			std::lock_guard<std::mutex> guard(victim.lock);
+			if (!victim.tasks.empty()) {
+				t = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+				found = true;
+			}
+		}
+		if (!found)
+			return false;
+
+		queued--;
+		try {
+			t.run();
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> guard(t.counter->error_lock);
+			if (t.counter->error == nullptr)
+				t.counter->error = std::current_exception();
+		}
+		finish(*t.counter);
+		return true;
+	}
+
+	void thread_pool::finish(task_counter& counter)
+	{
+		// The last task of a group wakes up the threads sleeping in wait (locking first so that none misses it)
+		if (counter.pending.fetch_sub(1) == 1) {
+			{
+				std::lock_guard<std::mutex> guard(sleep_lock);
+			}
+			wake.notify_all();
+		}
+	}
+
+	void thread_pool::wait(task_counter& counter)
+	{
+		int const self = current_pool == this ? current_index : int(threads.size());
+		while (counter.pending.load() > 0) {
+			if (run_one(self))
+				continue;
+
+			// Nothing to run: the remaining tasks of the group are running on other threads
+			std::unique_lock<std::mutex> guard(sleep_lock);
+			wake.wait(guard, [this, &counter]() { return counter.pending.load() == 0 || queued.load() > 0; });
+		}
+
+		std::exception_ptr error;
+		{
+			std::lock_guard<std::mutex> guard(counter.error_lock);
+			std::swap(error, counter.error);
+		}
+		if (error != nullptr)
+			std::rethrow_exception(error);
+	}
+
+	void thread_pool::worker(int index)
+	{
+		current_pool = this;
+		current_index = index;
+		profile_thread_cgp("worker " + std::to_string(index));
+		while (true) {
+			if (run_one(index))
+				continue;
+
+			std::unique_lock<std::mutex> guard(sleep_lock);
+			wake.wait(guard, [this]() { return stopping || queued.load() > 0; });
+			if (stopping)
+				return;
+		}
+	}
+
+
+	static int default_thread_count()
+	{
+		int const N = int(std::thread::hardware_concurrency());
+		return N > 0 ? N : 1;
+	}
+
+	static int thread_count_value = default_thread_count();
+	static int grain_size_value = 1024;
+	static std::unique_ptr<thread_pool> shared_pool;
+	static std::mutex shared_pool_lock;
+
+	thread_pool& parallel_pool()
+	{
+		std::lock_guard<std::mutex> guard(shared_pool_lock);
+		if (shared_pool == nullptr || shared_pool->size() != thread_count_value)
+			shared_pool.reset(new thread_pool(thread_count_value));
+		return *shared_pool;
+	}
+
+	void parallel_set_thread_count(int thread_count)
+	{
+		assert_cgp(thread_count > 0, "The number of threads must be positive");
+		std::lock_guard<std::mutex> guard(shared_pool_lock);
+		thread_count_value = thread_count;
+		shared_pool.reset();
+	}
+
+	int parallel_thread_count()
+	{
+		return thread_count_value;
+	}
+
+	void parallel_set_grain_size(int grain)
+	{
+		assert_cgp(grain > 0, "The grain size must be positive");
+		grain_size_value = grain;
+	}
+
+	int parallel_grain_size()
+	{
+		return grain_size_value;
+	}
+
+
+	int task_graph::add(std::function<void()> task)
+	{
+		node n;
+		n.task = std::move(task);
+		nodes.push_back(std::move(n));
+		return int(nodes.size()) - 1;
+	}
+
+	int task_graph::add(std::function<void()> task, std::vector<int> const& dependencies)
+	{
+		int const index = add(std::move(task));
+		for (int before : dependencies)
+			precede(before, index);
+		return index;
+	}
+
+	void task_graph::precede(int before, int after)
+	{
+		assert_cgp(before >= 0 && before < int(nodes.size()) && after >= 0 && after < int(nodes.size()), "Invalid task index in task_graph");
+		assert_cgp(before != after, "A task cannot depend on itself");
+		nodes[before].successors.push_back(after);
+		nodes[after].dependencies++;
+	}
+
+	void task_graph::run()
+	{
+		int const N = int(nodes.size());
+		if (N == 0)
+			return;
+
+		if (parallel_thread_count() <= 1) {
+			// Serial execution in topological order
+			std::vector<int> count(N), ready;
+			for (int k = 0; k < N; ++k) {
+				count[k] = nodes[k].dependencies;
+				if (count[k] == 0)
+					ready.push_back(k);
+			}
+			for (size_t k = 0; k < ready.size(); ++k) {
+				nodes[ready[k]].task();
+				for (int next : nodes[ready[k]].successors)
+					if (--count[next] == 0)
+						ready.push_back(next);
+			}
+			assert_cgp(int(ready.size()) == N, "task_graph contains a cycle");
+			return;
+		}
+
+		remaining.reset(new std::atomic<int>[N]);
+		for (int k = 0; k < N; ++k)
+			remaining[k] = nodes[k].dependencies;
+
+		thread_pool& pool = parallel_pool();
+		task_counter counter;
+		for (int k = 0; k < N; ++k)
+			if (nodes[k].dependencies == 0)
+				pool.submit([this, k, &counter]() { run_node(k, counter); }, counter);
+		pool.wait(counter);
+
+		for (int k = 0; k < N; ++k)
+			assert_cgp(remaining[k] == 0, "task_graph contains a cycle");
+	}
+
+	void task_graph::run_node(int index, task_counter& counter)
+	{
+		nodes[index].task();
+
+		// Successors are queued before this task is counted as finished: the counter cannot reach 0 in between
+		thread_pool& pool = parallel_pool();
+		for (int next : nodes[index].successors)
+			if (--remaining[next] == 0)
+				pool.submit([this, next, &counter]() { run_node(next, counter); }, counter);
+	}
+
+	void task_graph::clear()
+	{
+		nodes.clear();
+		remaining.reset();
+	}
+
+	int task_graph::size() const
+	{
+		return int(nodes.size());
+	}
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+namespace cgp
+{
+
+	/** Counter of the unfinished tasks of a group, waited by thread_pool::wait.
+	* The first exception thrown by a task of the group is kept and rethrown by wait. */
+	struct task_counter {
+		std::atomic<int> pending{ 0 };
+		std::exception_ptr error;
+		std::mutex error_lock;
+	};
+
+	/** Work-stealing thread pool.
+	* Each worker owns a deque of tasks: it pushes and pops at the back, idle workers steal from the front of the others.
+	* Tasks submitted from a thread outside the pool go to a shared queue.
+	* A thread waiting for a group of tasks runs pending tasks meanwhile, so that parallel loops can be nested,
+	* and sleeps when there is nothing left to run until its group completes or new tasks are queued. */
+	class thread_pool
+	{
+	public:
+		/** Pool using thread_count threads in total: the calling thread and thread_count-1 workers */
+		explicit thread_pool(int thread_count);
+		~thread_pool();
+		thread_pool(thread_pool const&) = delete;
+		thread_pool& operator=(thread_pool const&) = delete;
+
+		/** Number of threads running tasks (workers and calling thread) */
+		int size() const;
+
+		/** Queue a task, counter.pending is incremented now and decremented when the task is done */
+		void submit(std::function<void()> task, task_counter& counter);
+		/** Run pending tasks until counter.pending reaches 0, then rethrow the first exception of the group if any */
+		void wait(task_counter& counter);
+
+	private:
+		struct task {
+			std::function<void()> run;
+			task_counter* counter;
+		};
+		struct task_queue {
+			std::mutex lock;
+			std::deque<task> tasks;
+		};
+
+		bool run_one(int self);
+		void finish(task_counter& counter);
+		void worker(int index);
+
+		std::vector<std::unique_ptr<task_queue> > queues; // one per worker, the last one is shared by external threads
+		std::vector<std::thread> threads;
+		std::atomic<int> queued{ 0 };
+		std::mutex sleep_lock;
+		std::condition_variable wake; // new task queued, or a group completed
+		bool stopping = false;
+	};
+
+	/** Pool shared by the library, created at first use with parallel_thread_count() threads */
+	thread_pool& parallel_pool();
+
+	/** Number of threads used by parallel_for and task_graph (default: std::thread::hardware_concurrency()).
+	* Setting it recreates the shared pool: it must not be called while parallel work is running. 1 runs everything serially. */
+	void parallel_set_thread_count(int thread_count);
+	int parallel_thread_count();
+
+	/** Default number of iterations below which a range is not split further (default: 1024) */
+	void parallel_set_grain_size(int grain);
+	int parallel_grain_size();
+
+	/** Call f(first,last) on sub-ranges covering [begin,end), in parallel.
+	* Ranges are split in halves until they contain at most grain iterations (grain<=0 uses parallel_grain_size()).
+	* Returns once all the sub-ranges are processed. */
+	template <typename F> void parallel_for_range(int begin, int end, F const& f, int grain = 0);
+
+	/** Call f(k) for k in [begin,end), in parallel (see parallel_for_range) */
+	template <typename F> void parallel_for(int begin, int end, F const& f, int grain = 0);
+
+
+	/** Set of tasks with dependencies, run on the shared pool.
+	* Tasks are added once and the graph can be run several times. */
+	struct task_graph
+	{
+		/** Add a task and return its index */
+		int add(std::function<void()> task);
+		/** Add a task that starts once the given tasks are finished */
+		int add(std::function<void()> task, std::vector<int> const& dependencies);
+		/** Task "after" starts once task "before" is finished */
+		void precede(int before, int after);
+
+		/** Run all the tasks respecting the dependencies, returns when they are all done */
+		void run();
+		void clear();
+		int size() const;
+
+	private:
+		struct node {
+			std::function<void()> task;
+			std::vector<int> successors;
+			int dependencies = 0;
+		};
+		void run_node(int index, task_counter& counter);
+
+		std::vector<node> nodes;
+		std::unique_ptr<std::atomic<int>[]> remaining; // dependencies left for each node during run()
+	};
+
+}
+
+
+
+/* ************************************************** */
+/*           IMPLEMENTATION                           */
+/* ************************************************** */
+
+namespace cgp
+{
+	namespace detail
+	{
+		template <typename F>
+		void parallel_split(thread_pool& pool, int begin, int end, F const& f, int grain, task_counter& counter)
+		{
+			// Keep the first half, give the second one to the pool (stolen by idle threads)
+			while (end - begin > grain) {
+				int const middle = begin + (end - begin) / 2;
+				pool.submit([&pool, middle, end, &f, grain, &counter]() { parallel_split(pool, middle, end, f, grain, counter); }, counter);
+				end = middle;
+			}
+			f(begin, end);
+		}
+	}
+
+	template <typename F> void parallel_for_range(int begin, int end, F const& f, int grain)
+	{
+		if (end <= begin)
+			return;
+		if (grain <= 0)
+			grain = parallel_grain_size();
+
+		if (end - begin <= grain || parallel_thread_count() <= 1) {
+			f(begin, end);
+			return;
+		}
+
+		thread_pool& pool = parallel_pool();
+		task_counter counter;
+		try {
+			detail::parallel_split(pool, begin, end, f, grain, counter);
+		}
+		catch (...) {
+			// The submitted sub-ranges reference the counter: they must be done before leaving
+			std::lock_guard<std::mutex> guard(counter.error_lock);
+			if (counter.error == nullptr)
+				counter.error = std::current_exception();
+		}
+		pool.wait(counter);
+	}
+
+	template <typename F> void parallel_for(int begin, int end, F const& f, int grain)
+	{
+		parallel_for_range(begin, end, [&f](int first, int last) {
+			for (int k = first; k < last; ++k)
+				f(k);
+		}, grain);
+	}
+}
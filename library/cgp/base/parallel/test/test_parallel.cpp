@@ -0,0 +1,115 @@
+#include "test_parallel.hpp"
+
+#include "cgp/base/base.hpp"
+#include "cgp/containers/buffer/buffer.hpp"
+#include "cgp/containers/buffer_stack/buffer_stack.hpp"
+
+#include <stdexcept>
+
+namespace cgp_test
+{
+	void test_parallel()
+	{
+		using namespace cgp;
+
+		int const thread_count = parallel_thread_count();
+		parallel_set_thread_count(4);
+
+		// parallel_for visits each index once
+		{
+			std::vector<std::atomic<int> > visits(100000);
+			for (std::atomic<int>& v : visits) v = 0;
+			parallel_for(0, int(visits.size()), [&](int k) { visits[k]++; }, 64);
+			bool once = true;
+			for (std::atomic<int>& v : visits) once = once && v == 1;
+			assert_cgp_no_msg(once);
+		}
+
+		// An exception thrown by a task is rethrown after the loop completed, and the pool stays usable
+		{
+			std::atomic<int> visited{ 0 };
+			bool thrown = false;
+			try {
+				parallel_for(0, 10000, [&](int k) {
+					visited++;
+					if (k == 7777) throw std::runtime_error("task failure");
+				}, 16);
+			}
+			catch (std::runtime_error const&) {
+				thrown = true;
+			}
+			assert_cgp_no_msg(thrown);
+			assert_cgp_no_msg(visited > 0);
+
+			std::atomic<int> sum{ 0 };
+			parallel_for(0, 1000, [&](int k) { sum += k; }, 16);
+			assert_cgp_no_msg(sum == 999 * 1000 / 2);
+		}
+
+		// Same from the range kept by the calling thread
+		{
+			bool thrown = false;
+			try {
+				parallel_for(0, 10000, [&](int k) { if (k == 0) throw std::runtime_error("task failure"); }, 16);
+			}
+			catch (std::runtime_error const&) {
+				thrown = true;
+			}
+			assert_cgp_no_msg(thrown);
+		}
+
+		// Groups waited concurrently by threads outside the pool
+		{
+			std::atomic<int> sum{ 0 };
+			std::vector<std::thread> external;
+			for (int t = 0; t < 3; ++t)
+				external.push_back(std::thread([&]() {
+					for (int repeat = 0; repeat < 20; ++repeat)
+						parallel_for(0, 1000, [&](int) { sum++; }, 8);
+				}));
+			for (std::thread& t : external)
+				t.join();
+			assert_cgp_no_msg(sum == 3 * 20 * 1000);
+		}
+
+		// Task graph: dependencies respected, exceptions rethrown by run
+		{
+			std::vector<int> order;
+			std::mutex lock;
+			task_graph graph;
+			int const a = graph.add([&]() { std::lock_guard<std::mutex> guard(lock); order.push_back(0); });
+			int const b = graph.add([&]() { std::lock_guard<std::mutex> guard(lock); order.push_back(1); }, { a });
+			graph.add([&]() { std::lock_guard<std::mutex> guard(lock); order.push_back(2); }, { b });
+			graph.run();
+			assert_cgp_no_msg(order.size() == 3 && order[0] == 0 && order[1] == 1 && order[2] == 2);
+
+			task_graph failing;
+			failing.add([]() { throw std::runtime_error("task failure"); });
+			bool thrown = false;
+			try {
+				failing.run();
+			}
+			catch (std::runtime_error const&) {
+				thrown = true;
+			}
+			assert_cgp_no_msg(thrown);
+		}
+
+		// Element-wise buffer operators: serial on small buffers and on bool, parallel on large numerical buffers
+		{
+			buffer<float> a(100000), b(100000);
+			for (int k = 0; k < a.size(); ++k) { a[k] = float(k); b[k] = 1.0f; }
+			buffer<float> const c = 2.0f * (a + b);
+			bool equal = true;
+			for (int k = 0; k < c.size(); ++k) equal = equal && c[k] == 2.0f * (float(k) + 1.0f);
+			assert_cgp_no_msg(equal);
+
+			buffer<vec3> p(50000);
+			for (int k = 0; k < p.size(); ++k) p[k] = { float(k), 0.0f, 1.0f };
+			p += vec3(1.0f, 2.0f, 3.0f);
+			assert_cgp_no_msg(is_equal(p[10], vec3(11.0f, 2.0f, 4.0f)));
+		}
+
+		parallel_set_thread_count(thread_count);
+	}
+}
@@ -0,0 +1,164 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace cgp
+{
+	// Ring buffer of a thread. The owner thread is the only writer, the lock is only contended while exporting.
+	struct profiler_thread_buffer {
+		std::mutex lock;
+		std::vector<profiler_event> events;
+		uint64_t count = 0; // total number of zones recorded, events[count % capacity] is the next slot
+		int index = 0;
+		std::string name;
+	};
+
+	static std::chrono::steady_clock::time_point const profiler_origin = std::chrono::steady_clock::now();
+	static std::mutex registry_lock;
+	static std::vector<std::unique_ptr<profiler_thread_buffer> > registry;
+	static thread_local profiler_thread_buffer* current_buffer = nullptr;
+
+	static profiler_thread_buffer& thread_buffer()
+	{
+		if (current_buffer == nullptr) {
+			std::lock_guard<std::mutex> guard(registry_lock);
+			registry.push_back(std::unique_ptr<profiler_thread_buffer>(new profiler_thread_buffer));
+			current_buffer = registry.back().get();
+			current_buffer->events.resize(profiler_ring_capacity);
+			current_buffer->index = int(registry.size()) - 1;
+			current_buffer->name = "thread " + std::to_string(current_buffer->index);
+		}
+		return *current_buffer;
+	}
+
+	bool profiler_enabled()
+	{
+#ifdef CGP_PROFILER
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	int64_t profiler_now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profiler_origin).count();
+	}
+
+	void profiler_record(char const* name, int64_t start, int64_t end)
+	{
+		profiler_thread_buffer& buffer = thread_buffer();
+		std::lock_guard<std::mutex> guard(buffer.lock);
+		buffer.events[buffer.count % profiler_ring_capacity] = { name, start, end - start };
+		buffer.count++;
+	}
+
+	void profiler_set_thread_name(std::string const& name)
+	{
+		profiler_thread_buffer& buffer = thread_buffer();
+		std::lock_guard<std::mutex> guard(buffer.lock);
+		buffer.name = name;
+	}
+
+	std::vector<profiler_zone_statistics> profiler_statistics(float window_seconds)
+	{
+		int64_t const cutoff = profiler_now() - int64_t(window_seconds * 1e9);
+
+		std::vector<profiler_zone_statistics> result;
+		std::lock_guard<std::mutex> registry_guard(registry_lock);
+		for (auto const& buffer : registry) {
+
+			std::map<std::string, profiler_zone_statistics> zones;
+			{
+				std::lock_guard<std::mutex> guard(buffer->lock);
+				uint64_t const available = std::min<uint64_t>(buffer->count, profiler_ring_capacity);
+
+				// Most recent zones first, stop at the first one that ended before the window
+				for (uint64_t k = 0; k < available; ++k) {
+					profiler_event const& e = buffer->events[(buffer->count - 1 - k) % profiler_ring_capacity];
+					if (e.start + e.duration < cutoff)
+						break;
+
+					profiler_zone_statistics& z = zones[e.name];
+					float const ms = e.duration * 1e-6f;
+					z.calls++;
+					z.total_ms += ms;
+					z.max_ms = std::max(z.max_ms, ms);
+				}
+			}
+
+			size_t const first = result.size();
+			for (auto& it : zones) {
+				profiler_zone_statistics z = it.second;
+				z.name = it.first;
+				z.thread = buffer->name;
+				z.average_ms = z.total_ms / z.calls;
+				result.push_back(z);
+			}
+			std::sort(result.begin() + first, result.end(), [](profiler_zone_statistics const& a, profiler_zone_statistics const& b) { return a.total_ms > b.total_ms; });
+		}
+		return result;
+	}
+
+	// Zone names are string literals, only quotes and backslashes need to be escaped
+	static std::string json_string(std::string const& s)
+	{
+		std::string r = "\"";
+		for (char c : s) {
+			if (c == '"' || c == '\\')
+				r += '\\';
+			r += c;
+		}
+		return r + "\"";
+	}
+
+	bool profiler_export_chrome_trace(std::string const& filename)
+	{
+		std::FILE* file = std::fopen(filename.c_str(), "wb");
+		if (file == nullptr)
+			return false;
+
+		std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		bool first = true;
+
+		std::lock_guard<std::mutex> registry_guard(registry_lock);
+		for (auto const& buffer : registry) {
+
+			std::vector<profiler_event> events;
+			std::string name;
+			{
+				std::lock_guard<std::mutex> guard(buffer->lock);
+				uint64_t const available = std::min<uint64_t>(buffer->count, profiler_ring_capacity);
+				for (uint64_t k = buffer->count - available; k < buffer->count; ++k)
+					events.push_back(buffer->events[k % profiler_ring_capacity]);
+				name = buffer->name;
+			}
+
+			std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":%s}}", first ? "" : ",\n", buffer->index, json_string(name).c_str());
+			first = false;
+
+			// Complete events ("X"), timestamps in microseconds
+			for (profiler_event const& e : events)
+				std::fprintf(file, ",\n{\"name\":%s,\"cat\":\"cgp\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", json_string(e.name).c_str(), buffer->index, e.start * 1e-3, e.duration * 1e-3);
+		}
+
+		std::fprintf(file, "\n]}\n");
+		bool const ok = std::ferror(file) == 0;
+		std::fclose(file);
+		return ok;
+	}
+
+	void profiler_clear()
+	{
+		std::lock_guard<std::mutex> registry_guard(registry_lock);
+		for (auto const& buffer : registry) {
+			std::lock_guard<std::mutex> guard(buffer->lock);
+			buffer->count = 0;
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Scoped profiler
+//
+// - profile_zone_cgp( "name" ) : record the duration of the enclosing scope under the given name (string literal)
+// - profile_thread_cgp( "name" ) : name the current thread in the exported traces
+//
+// Each thread records its zones into its own ring buffer (the oldest zones are overwritten).
+// The recorded zones can be exported as a Chrome/Perfetto trace (chrome://tracing, ui.perfetto.dev) or summarized over
+// the last seconds (see profiler_gui for the ImGui panel).
+// The macros expand to nothing unless CGP_PROFILER is defined.
+
+namespace cgp
+{
+	/** Zone recorded by a thread: times in nanoseconds since the start of the profiler */
+	struct profiler_event {
+		char const* name;
+		int64_t start;
+		int64_t duration;
+	};
+
+	/** Summary of the calls of a zone by a thread */
+	struct profiler_zone_statistics {
+		std::string name;
+		std::string thread;
+		int calls = 0;
+		float total_ms = 0.0f;
+		float average_ms = 0.0f;
+		float max_ms = 0.0f;
+	};
+
+	/** Whether the zones are recorded (CGP_PROFILER defined) */
+	bool profiler_enabled();
+
+	/** Nanoseconds since the start of the profiler */
+	int64_t profiler_now();
+
+	/** Store a zone in the ring buffer of the current thread */
+	void profiler_record(char const* name, int64_t start, int64_t end);
+	void profiler_set_thread_name(std::string const& name);
+
+	/** Statistics of the zones that ended during the last window_seconds, sorted by thread then by decreasing total time */
+	std::vector<profiler_zone_statistics> profiler_statistics(float window_seconds);
+
+	/** Write all the recorded zones as a Chrome trace (JSON), return false if the file cannot be written */
+	bool profiler_export_chrome_trace(std::string const& filename);
+
+	/** Forget all the recorded zones */
+	void profiler_clear();
+
+	/** Number of zones kept per thread */
+	constexpr int profiler_ring_capacity = 1 << 16;
+
+	/** RAII timer used by profile_zone_cgp */
+	struct profiler_scope {
+		explicit profiler_scope(char const* name) : name(name), start(profiler_now()) {}
+		~profiler_scope() { profiler_record(name, start, profiler_now()); }
+		profiler_scope(profiler_scope const&) = delete;
+		profiler_scope& operator=(profiler_scope const&) = delete;
+
+		char const* name;
+		int64_t start;
+	};
+}
+
+#ifdef CGP_PROFILER
+#define cgp_profiler_concat_impl(A, B) A##B
+#define cgp_profiler_concat(A, B) cgp_profiler_concat_impl(A, B)
+#define profile_zone_cgp(NAME) cgp::profiler_scope cgp_profiler_concat(profiler_scope_, __LINE__)(NAME)
+#define profile_thread_cgp(NAME) cgp::profiler_set_thread_name(NAME)
+#else
+#define profile_zone_cgp(NAME)
+#define profile_thread_cgp(NAME)
+#endif
@@ -4,6 +4,7 @@
 
 #include <vector>
 #include <iostream>
+#include <type_traits>
 
 /* ************************************************** */
 /*           Header                                   */
@@ -15,7 +16,7 @@ namespace cgp
 /** Dynamic-sized container for numerical data
  *
  * The buffer structure is a wrapper around an std::vector with additional convenient functionalities
- * - Overloaded operators + - * / as well as common outputs
+ * - Overloaded operators + - * / as well as common outputs (element-wise operators on large buffers of numbers run with parallel_for)
  * - Strict bound checking with operator [] and () (unless cgp_NO_DEBUG is defined)
  *
  * Buffer follows the main syntax than std::vector
@@ -150,6 +151,33 @@ template <typename T> buffer<T>  operator/(buffer<T> const& a, float b);
 namespace cgp
 {
 
+template <typename T, int N> struct buffer_stack;
+
+namespace detail
+{
+    // Elements whose element-wise operators may run in parallel: arithmetic scalars and fixed size vectors of them.
+    //  bool is excluded, std::vector<bool> packs neighbouring elements in the same word.
+    template <typename T> struct buffer_parallel_element {
+        static constexpr bool value = std::is_arithmetic<T>::value && !std::is_same<T, bool>::value;
+    };
+    template <typename T, int N> struct buffer_parallel_element<buffer_stack<T, N> > {
+        static constexpr bool value = buffer_parallel_element<T>::value;
+    };
+
+    // Size below which an element-wise operator is cheaper than scheduling its parallel loop
+    constexpr int buffer_parallel_size = 16384;
+
+    // Loop of the element-wise operators: f(k) for k in [0,N)
+    template <typename T, typename F> void buffer_for_each(int N, F const& f)
+    {
+        if (buffer_parallel_element<T>::value && N >= buffer_parallel_size)
+            parallel_for(0, N, f);
+        else
+            for (int k = 0; k < N; ++k)
+                f(k);
+    }
+}
+
 template <typename T>
 buffer<T>::buffer()
     :data()
@@ -452,8 +480,7 @@ buffer<T>& operator+=(buffer<T>& a, buffer<T> const& b)
     assert_cgp(a.size()==b.size(), "Size do not agree");
 
     const int N = a.size();
-    for(int k=0; k<N; ++k)
-        a[k] += b[k];
+    detail::buffer_for_each<T>(N, [&](int k) { a[k] += b[k]; });
     return a;
 }
 
@@ -462,8 +489,7 @@ buffer<T>& operator+=(buffer<T>& a, T const& b)
 {
     assert_cgp(a.size()>0, "Size must be >0");
     const int N = a.size();
-    for(int k=0; k<N; ++k)
-        a[k] += b;
+    detail::buffer_for_each<T>(N, [&](int k) { a[k] += b; });
     return a;
 }
 
@@ -488,8 +514,7 @@ buffer<T>  operator+(T const& a, buffer<T> const& b)
 {
     int const N = b.size();
     buffer<T> res(N);
-    for(int k=0; k<N; ++k)
-        res[k] = a+b[k];
+    detail::buffer_for_each<T>(N, [&](int k) { res[k] = a+b[k]; });
     return res;
 }
 
@@ -497,8 +522,7 @@ template <typename T> buffer<T>  operator-(buffer<T> const& a)
 {
     int const N = a.size();
     buffer<T> b(N);
-    for(int k=0; k<N; ++k)
-        b[k] = -a[k];
+    detail::buffer_for_each<T>(N, [&](int k) { b[k] = -a[k]; });
     return b;
 }
 
@@ -509,16 +533,14 @@ template <typename T> buffer<T>& operator-=(buffer<T>& a, buffer<T> const& b)
     assert_cgp(a.size()==b.size(), "Size do not agree");
 
     const int N = a.size();
-    for(int k=0; k<N; ++k)
-        a[k] -= b[k];
+    detail::buffer_for_each<T>(N, [&](int k) { a[k] -= b[k]; });
     return a;
 }
 template <typename T> buffer<T>& operator-=(buffer<T>& a, T const& b)
 {
     assert_cgp(a.size()>0, "Size must be >0");
     const int N = a.size();
-    for(int k=0; k<N; ++k)
-        a[k] -= b;
+    detail::buffer_for_each<T>(N, [&](int k) { a[k] -= b; });
     return a;
 }
 template <typename T> buffer<T>  operator-(buffer<T> const& a, buffer<T> const& b)
@@ -537,8 +559,7 @@ template <typename T> buffer<T>  operator-(T const& a, buffer<T> const& b)
 {
     int const N = b.size();
     buffer<T> res(N);
-    for(int k=0; k<N; ++k)
-        res[k] = a-b[k];
+    detail::buffer_for_each<T>(N, [&](int k) { res[k] = a-b[k]; });
     return res;
 }
 
@@ -549,8 +570,7 @@ template <typename T> buffer<T>& operator*=(buffer<T>& a, buffer<T> const& b)
     assert_cgp(a.size()==b.size(), "Size do not agree");
 
     const int N = a.size();
-    for(int k=0; k<N; ++k)
-        a[k] *= b[k];
+    detail::buffer_for_each<T>(N, [&](int k) { a[k] *= b[k]; });
     return a;
 }
 template <typename T> buffer<T>  operator*(buffer<T> const& a, buffer<T> const& b)
@@ -566,24 +586,21 @@ template <typename T> buffer<T>  operator*(buffer<T> const& a, buffer<T> const&
 template <typename T> buffer<T>& operator*=(buffer<T>& a, float b)
 {
     int const N = a.size();
-    for(int k=0; k<N; ++k)
-        a[k] *= b;
+    detail::buffer_for_each<T>(N, [&](int k) { a[k] *= b; });
     return a;
 }
 template <typename T> buffer<T>  operator*(buffer<T> const& a, float b)
 {
     int const N = a.size();
     buffer<T> res(N);
-    for(int k=0; k<N; ++k)
-        res[k] = a[k]*b;
+    detail::buffer_for_each<T>(N, [&](int k) { res[k] = a[k]*b; });
     return res;
 }
 template <typename T> buffer<T>  operator*(float a, buffer<T> const& b)
 {
     int const N = b.size();
     buffer<T> res(N);
-    for(int k=0; k<N; ++k)
-        res[k] = a*b[k];
+    detail::buffer_for_each<T>(N, [&](int k) { res[k] = a*b[k]; });
     return res;
 }
 
@@ -593,16 +610,14 @@ template <typename T> buffer<T>& operator/=(buffer<T>& a, buffer<T> const& b)
     assert_cgp(a.size()==b.size(), "Size do not agree");
 
     const int N = a.size();
-    for(int k=0; k<N; ++k)
-        a[k] /= b[k];
+    detail::buffer_for_each<T>(N, [&](int k) { a[k] /= b[k]; });
     return a;
 }
 template <typename T> buffer<T>& operator/=(buffer<T>& a, float b)
 {
     assert_cgp(a.size()>0, "Size must be >0");
     const int N = a.size();
-    for(int k=0; k<N; ++k)
-        a[k] /= b;
+    detail::buffer_for_each<T>(N, [&](int k) { a[k] /= b; });
     return a;
 }
 template <typename T> buffer<T>  operator/(buffer<T> const& a, buffer<T> const& b)
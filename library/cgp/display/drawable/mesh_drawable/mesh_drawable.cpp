@@ -9,7 +9,7 @@ namespace cgp
 
 
 	mesh_drawable::mesh_drawable()
-		:vbo(), vao(0), number_triangles(0), shader(0), texture(0), transform(), anisotropic_scale({ 1,1,1 }), shading(), name("uninitialized")
+		:vbo(), vao(0), number_triangles(0), shader(0), texture(0), transform(), anisotropic_scale({ 1,1,1 }), shading(), name("uninitialized"), optimize_vertex_cache(false)
 	{}
 
 	static void warning_initialize(std::string const previous_name, std::string const current_name)
@@ -26,6 +26,8 @@ namespace cgp
 
 	mesh_drawable& mesh_drawable::initialize(mesh const& data_to_send, std::string const& object_name, GLuint shader_arg, GLuint texture_arg)
 	{
+		profile_zone_cgp("upload");
+
 		// Error detection before sending the data to avoid unexpected behavior
 		// *********************************************************************** //
 
@@ -62,7 +64,10 @@ namespace cgp
 		opengl_create_gl_buffer_data(GL_ARRAY_BUFFER, vbo["normal"], data_to_send.normal, GL_DYNAMIC_DRAW);
 		opengl_create_gl_buffer_data(GL_ARRAY_BUFFER, vbo["color"], data_to_send.color, GL_DYNAMIC_DRAW);
 		opengl_create_gl_buffer_data(GL_ARRAY_BUFFER, vbo["uv"], data_to_send.uv, GL_DYNAMIC_DRAW);
-		opengl_create_gl_buffer_data(GL_ELEMENT_ARRAY_BUFFER, vbo["index"], data_to_send.connectivity, GL_DYNAMIC_DRAW);
+		if (optimize_vertex_cache)
+			opengl_create_gl_buffer_data(GL_ELEMENT_ARRAY_BUFFER, vbo["index"], mesh_vertex_cache_order(data_to_send.connectivity, data_to_send.position.size()), GL_DYNAMIC_DRAW);
+		else
+			opengl_create_gl_buffer_data(GL_ELEMENT_ARRAY_BUFFER, vbo["index"], data_to_send.connectivity, GL_DYNAMIC_DRAW);
 
 		// Store number of triangles
 		number_triangles = static_cast<GLuint>(data_to_send.connectivity.size());
@@ -82,24 +87,35 @@ namespace cgp
 
 	mesh_drawable& mesh_drawable::update_position(buffer<vec3> const& new_position)
 	{
+		profile_zone_cgp("upload");
 		glBindBuffer(GL_ARRAY_BUFFER,vbo["position"]); opengl_check;
 		glBufferSubData(GL_ARRAY_BUFFER,0,size_in_memory(new_position),ptr(new_position));  opengl_check;
 		return *this;
 	}
+	mesh_drawable& mesh_drawable::update_position(vec3 const* new_position, size_t count)
+	{
+		profile_zone_cgp("upload");
+		glBindBuffer(GL_ARRAY_BUFFER,vbo["position"]); opengl_check;
+		glBufferSubData(GL_ARRAY_BUFFER,0,GLsizeiptr(count*sizeof(vec3)),new_position);  opengl_check;
+		return *this;
+	}
 	mesh_drawable& mesh_drawable::update_normal(buffer<vec3> const& new_normals)
 	{
+		profile_zone_cgp("upload");
 		glBindBuffer(GL_ARRAY_BUFFER,vbo["normal"]); opengl_check;
 		glBufferSubData(GL_ARRAY_BUFFER,0,size_in_memory(new_normals),ptr(new_normals));  opengl_check;
 		return *this;
 	}
 	mesh_drawable& mesh_drawable::update_color(buffer<vec3> const& new_color)
 	{
+		profile_zone_cgp("upload");
 		glBindBuffer(GL_ARRAY_BUFFER,vbo["color"]); opengl_check;
 		glBufferSubData(GL_ARRAY_BUFFER,0,size_in_memory(new_color),ptr(new_color));  opengl_check;
 		return *this;
 	}
 	mesh_drawable& mesh_drawable::update_uv(buffer<vec2> const& new_uv)
 	{
+		profile_zone_cgp("upload");
 		glBindBuffer(GL_ARRAY_BUFFER,vbo["uv"]); opengl_check;
 		glBufferSubData(GL_ARRAY_BUFFER,0,size_in_memory(new_uv),ptr(new_uv));  opengl_check;
 		return *this;
@@ -18,6 +18,8 @@ namespace cgp
 		mesh_drawable& update_normal(buffer<vec3> const& new_normal);
 		mesh_drawable& update_color(buffer<vec3> const& new_color);
 		mesh_drawable& update_uv(buffer<vec2> const& new_uv);
+		// Upload directly from memory that is not a buffer (e.g. a memory mapped file), no intermediate copy is made
+		mesh_drawable& update_position(vec3 const* new_position, size_t count);
 
 
 		// Stores VBO ID in GPU_elements_id
@@ -37,6 +39,12 @@ namespace cgp
 		std::string name;
 		
 
+		// Reorder the triangles for the GPU vertex cache when initialize() sends them (see mesh_vertex_cache_order).
+		//  Disabled by default, as the reordering costs more than it saves on small or frequently re-initialized meshes.
+		//  The vertices are not renumbered: update_position(), update_normal(), etc. still use the order of the mesh.
+		//  The setting is kept by clear().
+		bool optimize_vertex_cache;
+
 		static GLuint default_shader;
 		static GLuint default_texture;
 
@@ -0,0 +1,101 @@
+#include "mesh_lod_drawable.hpp"
+
+#include "cgp/base/base.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace cgp
+{
+	mesh_lod_drawable::mesh_lod_drawable()
+		:levels(), screen_size(), bounding_center({ 0,0,0 }), bounding_radius(0.0f), transform(), anisotropic_scale({ 1,1,1 }), shading(), name("uninitialized")
+	{}
+
+	mesh_lod_drawable& mesh_lod_drawable::initialize(buffer<mesh> const& lods, std::string const& object_name, GLuint shader, GLuint texture)
+	{
+		if (levels.size() != 0)
+			warning_cgp("Calling mesh_lod_drawable.initialize() on a structure mesh_lod_drawable with non empty levels [name:" + name + "]", "Call clear() before a new initialization to release the GPU memory of the previous levels");
+
+		assert_cgp(lods.size() > 0, "Cannot initialize mesh_lod_drawable without level [name:" + object_name + "]");
+		assert_cgp(lods[0].position.size() > 0, "The finest level of a mesh_lod_drawable cannot be empty [name:" + object_name + "]");
+
+		name = object_name;
+		transform = affine_rts();
+		anisotropic_scale = { 1,1,1 };
+		shading = shading_parameters_phong();
+
+		levels.clear();
+		screen_size.clear();
+		float const N_triangle_finest = std::max(float(lods[0].connectivity.size()), 1.0f);
+		for (size_t k = 0; k < lods.size(); ++k) {
+			mesh level = lods[k];
+			level.fill_empty_field();
+			mesh_drawable visual;
+			visual.optimize_vertex_cache = true; // static levels, uploaded once
+			visual.initialize(level, object_name + "[" + str(k) + "]", shader, texture);
+			levels.push_back(visual);
+			screen_size.push_back(std::sqrt(float(lods[k].connectivity.size()) / N_triangle_finest));
+		}
+
+		// Bounding sphere of the finest level
+		buffer<vec3> const& position = lods[0].position;
+		vec3 pmin = position[0], pmax = position[0];
+		for (vec3 const& p : position) {
+			pmin = { std::min(pmin.x,p.x), std::min(pmin.y,p.y), std::min(pmin.z,p.z) };
+			pmax = { std::max(pmax.x,p.x), std::max(pmax.y,p.y), std::max(pmax.z,p.z) };
+		}
+		bounding_center = (pmin + pmax) / 2.0f;
+		bounding_radius = 0.0f;
+		for (vec3 const& p : position)
+			bounding_radius = std::max(bounding_radius, norm(p - bounding_center));
+
+		return *this;
+	}
+
+	mesh_lod_drawable& mesh_lod_drawable::clear()
+	{
+		for (mesh_drawable& level : levels)
+			level.clear();
+		levels.clear();
+		screen_size.clear();
+
+		bounding_center = { 0,0,0 };
+		bounding_radius = 0.0f;
+		transform = affine_rts();
+		anisotropic_scale = { 1,1,1 };
+		shading = shading_parameters_phong();
+		name = "uninitialized";
+
+		return *this;
+	}
+
+	float mesh_lod_drawable::projected_size(mat4 const& view, mat4 const& projection) const
+	{
+		vec3 const c = transform * (anisotropic_scale * bounding_center);
+		float const scale = std::max(std::max(anisotropic_scale.x, anisotropic_scale.y), anisotropic_scale.z);
+		float const radius = bounding_radius * transform.scaling * scale;
+
+		// Depth of the center in camera space, and homogeneous coordinate w after projection (-depth for a perspective, 1 for an orthographic projection)
+		float const z = view(2,0)*c.x + view(2,1)*c.y + view(2,2)*c.z + view(2,3);
+		float const w = projection(3,2)*z + projection(3,3);
+		if (w <= radius * std::abs(projection(3,2)))
+			return std::numeric_limits<float>::max(); // camera inside the bounding sphere
+
+		return radius * projection(1,1) / w;
+	}
+
+	int mesh_lod_drawable::level(float size) const
+	{
+		int const N = int(levels.size());
+		for (int k = 0; k < N; ++k)
+			if (size >= screen_size[k])
+				return k;
+		return N - 1;
+	}
+
+	mat4 mesh_lod_drawable::model_matrix() const
+	{
+		mat4 const model = transform.matrix() * mat4::diagonal(anisotropic_scale);
+		return model;
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "cgp/display/drawable/mesh_drawable/mesh_drawable.hpp"
+
+namespace cgp
+{
+	/** Levels of detail of a mesh drawn according to their projected size on screen
+	* The projected size is the diameter of the bounding sphere of the mesh relative to the viewport height. The level k (from the finest)
+	*  is drawn if the projected size is at least screen_size[k], the coarsest level is drawn below.
+	* The uniform parameters (transform, anisotropic_scale, shading) are stored once and used for every level. */
+	struct mesh_lod_drawable
+	{
+		mesh_lod_drawable();
+
+		/** Send the levels to the GPU (typically computed by mesh_simplify_lod, from the finest to the coarsest)
+		* The default screen sizes keep the same number of triangles per projected area: sqrt(N_triangle(k)/N_triangle(0)) */
+		mesh_lod_drawable& initialize(buffer<mesh> const& lods, std::string const& object_name = "unset_name", GLuint shader = mesh_drawable::default_shader, GLuint texture = mesh_drawable::default_texture);
+		mesh_lod_drawable& clear();
+
+		/** Projected size of the bounding sphere relative to the viewport height */
+		float projected_size(mat4 const& view, mat4 const& projection) const;
+		/** Index of the level drawn for a given projected size */
+		int level(float size) const;
+
+		buffer<mesh_drawable> levels;
+		buffer<float> screen_size;
+
+		// Bounding sphere in local coordinates
+		vec3 bounding_center;
+		float bounding_radius;
+
+		// Uniform
+		affine_rts transform;
+		vec3 anisotropic_scale;
+		shading_parameters_phong shading;
+		mat4 model_matrix() const;
+
+		std::string name;
+	};
+
+	template <typename SCENE_ENVIRONMENT>
+	void draw(mesh_lod_drawable const& drawable, SCENE_ENVIRONMENT const& environment);
+
+	template <typename SCENE_ENVIRONMENT>
+	void draw_wireframe(mesh_lod_drawable const& drawable, SCENE_ENVIRONMENT const& environment, vec3 const& color={0,0,1});
+}
+
+
+namespace cgp
+{
+	template <typename SCENE_ENVIRONMENT>
+	mesh_drawable mesh_lod_drawable_select(mesh_lod_drawable const& drawable, SCENE_ENVIRONMENT const& environment)
+	{
+		// copy of the selected level (lightweight element) with the uniform parameters of the LOD
+		float const size = drawable.projected_size(environment.camera.matrix_view(), environment.projection.matrix());
+		mesh_drawable visual_element = drawable.levels[drawable.level(size)];
+		visual_element.transform = drawable.transform;
+		visual_element.anisotropic_scale = drawable.anisotropic_scale;
+		visual_element.shading = drawable.shading;
+		return visual_element;
+	}
+
+	template <typename SCENE_ENVIRONMENT>
+	void draw(mesh_lod_drawable const& drawable, SCENE_ENVIRONMENT const& environment)
+	{
+		if (drawable.levels.size() == 0) return;
+		draw(mesh_lod_drawable_select(drawable, environment), environment);
+	}
+
+	template <typename SCENE_ENVIRONMENT>
+	void draw_wireframe(mesh_lod_drawable const& drawable, SCENE_ENVIRONMENT const& environment, vec3 const& color)
+	{
+		if (drawable.levels.size() == 0) return;
+		draw_wireframe(mesh_lod_drawable_select(drawable, environment), environment, color);
+	}
+}
@@ -0,0 +1,95 @@
+#include "gpu_timer.hpp"
+
+#include "../debug/debug.hpp"
+#include "cgp/base/error/error.hpp"
+
+namespace cgp
+{
+	void gpu_timer::frame()
+	{
+		assert_cgp(active == -1, "gpu_timer::frame called while a pass is measured");
+
+		// Queries issued during the previous frame
+		int const previous = 1 - current;
+		for (size_t k = 0; k < passes.size(); ++k) {
+			pass& p = passes[k];
+			if (!p.issued[previous])
+				continue;
+			p.issued[previous] = false;
+
+			GLint available = 0;
+			glGetQueryObjectiv(p.query[previous], GL_QUERY_RESULT_AVAILABLE, &available); opengl_check;
+			if (!available) {
+				results[k].skipped++;
+				continue;
+			}
+
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(p.query[previous], GL_QUERY_RESULT, &elapsed); opengl_check;
+			gpu_pass_timing& r = results[k];
+			r.last_ms = float(elapsed * 1e-6);
+			r.average_ms = r.average_ms == 0.0f ? r.last_ms : (1 - smoothing) * r.average_ms + smoothing * r.last_ms;
+		}
+
+		current = previous;
+	}
+
+	void gpu_timer::begin(char const* name)
+	{
+		if (!enabled)
+			return;
+		assert_cgp(active == -1, "gpu_timer passes cannot be nested");
+
+		int index = -1;
+		for (size_t k = 0; k < results.size() && index == -1; ++k)
+			if (results[k].name == name)
+				index = int(k);
+		if (index == -1) {
+			pass p;
+			glGenQueries(2, p.query); opengl_check;
+			passes.push_back(p);
+			gpu_pass_timing r;
+			r.name = name;
+			results.push_back(r);
+			index = int(passes.size()) - 1;
+		}
+
+		// A pass measured twice in the same frame keeps its first measure
+		if (passes[index].issued[current])
+			return;
+
+		glBeginQuery(GL_TIME_ELAPSED, passes[index].query[current]); opengl_check;
+		active = index;
+	}
+
+	void gpu_timer::end()
+	{
+		if (active == -1)
+			return;
+		glEndQuery(GL_TIME_ELAPSED); opengl_check;
+		passes[active].issued[current] = true;
+		active = -1;
+	}
+
+	std::vector<gpu_pass_timing> const& gpu_timer::timings() const
+	{
+		return results;
+	}
+
+	float gpu_timer::total_ms() const
+	{
+		float total = 0.0f;
+		for (gpu_pass_timing const& r : results)
+			total += r.last_ms;
+		return total;
+	}
+
+	void gpu_timer::clear()
+	{
+		for (pass& p : passes)
+			glDeleteQueries(2, p.query);
+		passes.clear();
+		results.clear();
+		active = -1;
+	}
+}
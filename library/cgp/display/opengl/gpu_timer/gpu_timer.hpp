@@ -0,0 +1,58 @@
+#pragma once
+
+#include "../glad/glad.hpp"
+
+#include <string>
+#include <vector>
+
+namespace cgp
+{
+	/** GPU duration of a pass measured by gpu_timer */
+	struct gpu_pass_timing {
+		std::string name;
+		float last_ms = 0.0f;     // duration measured one frame ago
+		float average_ms = 0.0f;  // exponential moving average
+		int skipped = 0;          // results that were not available yet after one frame (dropped, never waited for)
+	};
+
+	/** Measure the GPU duration of named passes with GL_TIME_ELAPSED queries.
+	* Each pass owns two queries used in alternate frames: the result of a frame is read during the next one, which does not stall the pipeline.
+	* Passes cannot be nested (a single GL_TIME_ELAPSED query can be active at a time).
+	* The queries are not deleted automatically: call clear() while the OpenGL context exists. */
+	struct gpu_timer
+	{
+		bool enabled = true;
+		float smoothing = 0.1f; // weight of the last measure in the average
+
+		/** Call once per frame before the passes: read the results of the previous frame and switch queries */
+		void frame();
+		void begin(char const* name);
+		void end();
+
+		std::vector<gpu_pass_timing> const& timings() const;
+		/** Sum of the last durations of all the passes */
+		float total_ms() const;
+
+		void clear();
+
+	private:
+		struct pass {
+			GLuint query[2] = { 0, 0 };
+			bool issued[2] = { false, false };
+		};
+		std::vector<pass> passes;
+		std::vector<gpu_pass_timing> results;
+		int current = 0;   // index of the queries used by the current frame
+		int active = -1;   // pass being measured
+	};
+
+	/** Measure the enclosing scope with a gpu_timer */
+	struct gpu_timer_scope {
+		gpu_timer_scope(gpu_timer& timer, char const* name) : timer(timer) { timer.begin(name); }
+		~gpu_timer_scope() { timer.end(); }
+		gpu_timer_scope(gpu_timer_scope const&) = delete;
+		gpu_timer_scope& operator=(gpu_timer_scope const&) = delete;
+
+		gpu_timer& timer;
+	};
+}
@@ -5,4 +5,5 @@
 #include "debug/debug.hpp"
 #include "uniform/uniform.hpp"
 #include "shaders/shaders.hpp"
-#include "texture/texture.hpp"
\ No newline at end of file
+#include "texture/texture.hpp"
+#include "gpu_timer/gpu_timer.hpp"
\ No newline at end of file
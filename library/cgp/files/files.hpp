@@ -2,6 +2,7 @@
 
 
 #include "cgp/containers/containers.hpp"
+#include "mapped_file/mapped_file.hpp"
 
 #include <string>
 #include <sstream>
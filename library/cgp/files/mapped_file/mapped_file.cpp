@@ -0,0 +1,125 @@
+#include "mapped_file.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cgp
+{
+    mapped_file::mapped_file()
+        :ptr(nullptr), length(0)
+#ifdef _WIN32
+        ,file_handle(nullptr), mapping_handle(nullptr)
+#endif
+    {}
+
+    mapped_file::~mapped_file()
+    {
+        close();
+    }
+
+    mapped_file::mapped_file(mapped_file&& other)
+        :mapped_file()
+    {
+        *this = std::move(other);
+    }
+
+    mapped_file& mapped_file::operator=(mapped_file&& other)
+    {
+        if (this != &other) {
+            close();
+            std::swap(ptr, other.ptr);
+            std::swap(length, other.length);
+#ifdef _WIN32
+            std::swap(file_handle, other.file_handle);
+            std::swap(mapping_handle, other.mapping_handle);
+#endif
+        }
+        return *this;
+    }
+
+    bool mapped_file::open(std::string const& filename)
+    {
+        close();
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            CloseHandle(file);
+            return false;
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view == nullptr) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        file_handle = file;
+        mapping_handle = mapping;
+        ptr = static_cast<char const*>(view);
+        length = size_t(file_size.QuadPart);
+#else
+        int const fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat stat_buf;
+        if (fstat(fd, &stat_buf) != 0 || stat_buf.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void* view = mmap(nullptr, size_t(stat_buf.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps its own reference to the file
+        if (view == MAP_FAILED)
+            return false;
+
+        ptr = static_cast<char const*>(view);
+        length = size_t(stat_buf.st_size);
+#endif
+        return true;
+    }
+
+    void mapped_file::close()
+    {
+        if (ptr == nullptr)
+            return;
+
+#ifdef _WIN32
+        UnmapViewOfFile(ptr);
+        CloseHandle(mapping_handle);
+        CloseHandle(file_handle);
+        file_handle = nullptr;
+        mapping_handle = nullptr;
+#else
+        munmap(const_cast<char*>(ptr), length);
+#endif
+        ptr = nullptr;
+        length = 0;
+    }
+
+    bool mapped_file::is_open() const { return ptr != nullptr; }
+    char const* mapped_file::data() const { return ptr; }
+    size_t mapped_file::size() const { return length; }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace cgp
+{
+    /** Read-only memory mapping of a whole file (mmap on Unix, file mapping on Windows)
+    * The content is accessed through data()/size() without any copy; pages are loaded lazily by the OS.
+    * The mapping is released when the structure is destroyed or close() is called. */
+    struct mapped_file
+    {
+        mapped_file();
+        ~mapped_file();
+        mapped_file(mapped_file&& other);
+        mapped_file& operator=(mapped_file&& other);
+        mapped_file(mapped_file const&) = delete;
+        mapped_file& operator=(mapped_file const&) = delete;
+
+        /** Map the file. Return false if the file cannot be opened or mapped (empty files cannot be mapped). */
+        bool open(std::string const& filename);
+        void close();
+
+        bool is_open() const;
+        char const* data() const;
+        size_t size() const;
+
+    private:
+        char const* ptr;
+        size_t length;
+#ifdef _WIN32
+        void* file_handle;
+        void* mapping_handle;
+#endif
+    };
+}
@@ -69,8 +69,14 @@ namespace cgp {
 	void helper_common_scene::frame_end(GLFWwindow* window)
 	{
 		ImGui::End();
-		imgui_render_frame(window);
-		glfwSwapBuffers(window);
+		{
+			profile_zone_cgp("imgui render");
+			imgui_render_frame(window);
+		}
+		{
+			profile_zone_cgp("swap buffers");
+			glfwSwapBuffers(window);
+		}
 		glfwPollEvents();
 	}
 
@@ -3,6 +3,7 @@
 #include "camera/camera.hpp"
 #include "glfw_inputs/glfw_inputs.hpp"
 #include "gui/gui.hpp"
+#include "profiler_gui/profiler_gui.hpp"
 #include "timer/timer.hpp"
 #include "tracker/tracker.hpp"
 #include "camera_standard_behavior/camera_standard_behavior.hpp"
\ No newline at end of file
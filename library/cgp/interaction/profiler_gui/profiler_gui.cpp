@@ -0,0 +1,136 @@
+#include "profiler_gui.hpp"
+
+#include "third_party/src/imgui/imgui.h"
+
+namespace cgp
+{
+	void profiler_gui::update_statistics()
+	{
+		statistics = profiler_statistics(window);
+
+		for (profiler_zone_statistics const& z : statistics) {
+			std::vector<float>& h = history[z.thread + "/" + z.name];
+			h.push_back(z.average_ms);
+			if (int(h.size()) > history_size)
+				h.erase(h.begin(), h.begin() + (h.size() - history_size));
+		}
+	}
+
+	float profiler_gui::cpu_average_ms(std::string const& name) const
+	{
+		// Zones of the thread that issues the OpenGL calls
+		for (profiler_zone_statistics const& z : statistics)
+			if (z.name == name && z.thread == "main")
+				return z.average_ms;
+		return 0.0f;
+	}
+
+	void profiler_gui::display_gpu(gpu_timer const& gpu)
+	{
+		std::vector<gpu_pass_timing> const& timings = gpu.timings();
+		if (timings.empty())
+			return;
+
+		ImGui::Separator();
+		ImGui::Text("GPU passes (GL_TIME_ELAPSED, read one frame later)");
+		ImGui::Columns(4, "gpu");
+		ImGui::Text("Pass"); ImGui::NextColumn();
+		ImGui::Text("CPU (ms)"); ImGui::NextColumn();
+		ImGui::Text("GPU (ms)"); ImGui::NextColumn();
+		ImGui::Text("Skipped"); ImGui::NextColumn();
+
+		float gpu_total = 0.0f;
+		for (gpu_pass_timing const& t : timings) {
+			ImGui::Text("%s", t.name.c_str()); ImGui::NextColumn();
+			ImGui::Text("%.3f", cpu_average_ms(t.name)); ImGui::NextColumn();
+			ImGui::Text("%.3f", t.average_ms); ImGui::NextColumn();
+			ImGui::Text("%d", t.skipped); ImGui::NextColumn();
+			gpu_total += t.average_ms;
+		}
+		ImGui::Columns(1);
+
+		// The buffer swap waits for the GPU: the CPU work of a frame excludes it
+		float const cpu_frame = cpu_average_ms("frame") - cpu_average_ms("swap buffers");
+		if (cpu_frame > 0)
+			ImGui::Text("Frame: CPU %.2f ms, GPU passes %.2f ms -> %s-bound", cpu_frame, gpu_total, gpu_total > cpu_frame ? "GPU" : "CPU");
+	}
+
+	void profiler_gui::display()
+	{
+		display_window(nullptr);
+	}
+
+	void profiler_gui::display(gpu_timer const& gpu)
+	{
+		display_window(&gpu);
+	}
+
+	void profiler_gui::display_window(gpu_timer const* gpu)
+	{
+		ImGui::Begin("Profiler", NULL, ImGuiWindowFlags_AlwaysAutoResize);
+
+		if (!profiler_enabled()) {
+			ImGui::Text("Profiler disabled: build with CGP_PROFILER defined");
+			if (gpu != nullptr)
+				display_gpu(*gpu);
+			ImGui::End();
+			return;
+		}
+
+		int64_t const now = profiler_now();
+		if (last_refresh < 0 || now - last_refresh > int64_t(refresh * 1e9)) {
+			update_statistics();
+			last_refresh = now;
+		}
+
+		ImGui::SliderFloat("Window (s)", &window, 0.1f, 5.0f);
+
+		std::string thread;
+		for (profiler_zone_statistics const& z : statistics) {
+
+			if (z.thread != thread) {
+				thread = z.thread;
+				ImGui::Separator();
+				ImGui::Text("%s", thread.c_str());
+				ImGui::Columns(5, thread.c_str());
+				ImGui::Text("Zone"); ImGui::NextColumn();
+				ImGui::Text("Calls/s"); ImGui::NextColumn();
+				ImGui::Text("Avg (ms)"); ImGui::NextColumn();
+				ImGui::Text("Max (ms)"); ImGui::NextColumn();
+				ImGui::Text("History"); ImGui::NextColumn();
+			}
+
+			ImGui::Text("%s", z.name.c_str()); ImGui::NextColumn();
+			ImGui::Text("%.1f", z.calls / window); ImGui::NextColumn();
+			ImGui::Text("%.3f", z.average_ms); ImGui::NextColumn();
+			ImGui::Text("%.3f", z.max_ms); ImGui::NextColumn();
+
+			std::string const key = z.thread + "/" + z.name;
+			std::vector<float> const& h = history[key];
+			ImGui::PushID(key.c_str());
+			ImGui::PlotLines("", h.data(), int(h.size()), 0, NULL, 0.0f, FLT_MAX, ImVec2(120, 20));
+			ImGui::PopID();
+			ImGui::NextColumn();
+
+			bool const last = &z == &statistics.back() || (&z + 1)->thread != thread;
+			if (last)
+				ImGui::Columns(1);
+		}
+
+		if (gpu != nullptr)
+			display_gpu(*gpu);
+
+		ImGui::Separator();
+		if (ImGui::Button("Export Chrome trace"))
+			message = profiler_export_chrome_trace(trace_filename) ? "Trace written to " + trace_filename : "Cannot write " + trace_filename;
+		ImGui::SameLine();
+		if (ImGui::Button("Clear")) {
+			profiler_clear();
+			history.clear();
+		}
+		if (!message.empty())
+			ImGui::Text("%s", message.c_str());
+
+		ImGui::End();
+	}
+}
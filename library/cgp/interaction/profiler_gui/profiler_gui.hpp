@@ -0,0 +1,37 @@
+#pragma once
+
+#include "cgp/base/profiler/profiler.hpp"
+#include "cgp/display/opengl/gpu_timer/gpu_timer.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cgp
+{
+	/** ImGui window summarizing the zones recorded by the profiler (see profile_zone_cgp).
+	* For each thread and zone: calls per second, average and maximal duration over the last seconds, and the history of the average. */
+	struct profiler_gui
+	{
+		float window = 1.0f;           // duration (in seconds) summarized by the panel
+		float refresh = 0.25f;         // period (in seconds) between two updates of the statistics
+		int history_size = 120;        // number of updates kept for the plots
+		std::string trace_filename = "trace.json";
+
+		/** Display the "Profiler" window, to be called between imgui_create_frame() and imgui_render_frame() */
+		void display();
+		/** Same window, with the GPU duration of the passes next to the CPU zones of the same name */
+		void display(gpu_timer const& gpu);
+
+	private:
+		void display_window(gpu_timer const* gpu);
+		void display_gpu(gpu_timer const& gpu);
+		void update_statistics();
+		float cpu_average_ms(std::string const& name) const;
+
+		std::vector<profiler_zone_statistics> statistics;
+		std::map<std::string, std::vector<float> > history; // average duration in ms, indexed by thread/zone
+		int64_t last_refresh = -1;
+		std::string message;
+	};
+}
@@ -278,6 +278,7 @@ namespace cgp
         auto const it_end = end();
         for (; it != it_end; ++it)
             *it = value;
+        return *this;
     }
 
 
@@ -676,6 +677,7 @@ namespace cgp
     template <typename T, int N1, int N2> matrix_stack<T, N1, N2>& operator/=(matrix_stack<T, N1, N2>& a, float b)
     {
         a.data /= b;
+        return a;
     }
     template <typename T, int N1, int N2> matrix_stack<T, N1, N2>  operator/(matrix_stack<T, N1, N2> const& a, float b)
     {
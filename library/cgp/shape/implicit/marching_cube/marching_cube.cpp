@@ -102,13 +102,19 @@ namespace cgp
 
 
 
-	size_t marching_cube(std::vector<vec3>& position, std::vector<float> const& field, spatial_domain_grid_3D const& domain, float iso, std::vector<marching_cube_relative_coordinates>* relative)
+	// Tables of the marching cube, shared by all the slabs
+	struct marching_cube_tables {
+		std::array<std::array<int, 16>, 256> triTable;
+		std::array<std::pair<int, int>, 12> edge_order;
+		std::array<int, 256> edgeTable;
+	};
+
+	// Triangles of the voxels between the planes kz and kz+1, appended to position (and relative if not null)
+	static void marching_cube_slab(size_t kz, std::vector<vec3>& position, std::vector<marching_cube_relative_coordinates>* relative, std::vector<float> const& field, spatial_domain_grid_3D const& domain, float iso, marching_cube_tables const& lut)
 	{
-		// Table of correspondance between the 256 type of cube and the edges on which new vertices are created
-		static std::array<std::array<int, 16>, 256> const triTable = marching_cube_lut_triTable();
-		// Storage of the order of edge visiting on the cube
-		static std::array<std::pair<int, int>, 12> const lut_edge_order = marching_cube_lut_edge_order();
-		static std::array<int, 256> const edgeTable = marching_cube_lut_edgeTable();
+		std::array<std::array<int, 16>, 256> const& triTable = lut.triTable;
+		std::array<std::pair<int, int>, 12> const& lut_edge_order = lut.edge_order;
+		std::array<int, 256> const& edgeTable = lut.edgeTable;
 
 		vec3 const domain_min = domain.center - domain.length / 2.0;
 		vec3 const& domain_length = domain.length;
@@ -121,10 +127,6 @@ namespace cgp
 		float const dy = 1 / (Ny - 1.0f);
 		float const dz = 1 / (Nz - 1.0f);
 
-		size_t counter_position = 0;
-
-		// Marching-Cube
-		// *************************** //
 		cube_parameters cube;
 		std::array<vec3, 12> new_vertex;
 		std::array<float, 12> new_vertex_alpha;
@@ -133,129 +135,148 @@ namespace cgp
 
 		bool exist_cube_value_positive;
 		bool exist_cube_value_negative;
-		for (size_t kz = 0; kz < Nz - 1; ++kz) {
-			float const uz = kz * dz;
-			for (size_t ky = 0; ky < Ny - 1; ++ky) {
-				float const uy = ky * dy;
-				for (size_t kx = 0; kx < Nx - 1; ++kx) {
-					float const ux = kx * dx;
-
-					size_t const index_corner = kx + Nx * (ky + Ny * kz);
-				
-					// compute offsets of the cube vertices
-					for (size_t k_offset = 0; k_offset < 8; ++k_offset)
-						cube.index[k_offset] = index_corner + offset_cube[k_offset];
-
-					// get values
-					for (size_t k = 0; k < 8; ++k)
-						cube.value[k] = field[cube.index[k]] - iso;
-
-					// check if there is at least one change of sign in the vertices
-					exist_cube_value_positive = false;
-					exist_cube_value_negative = false;
-					for (size_t k = 0; k < 8; ++k) {
-						if (cube.value[k] >= 0) exist_cube_value_positive = true;
-						if (cube.value[k] <  0) exist_cube_value_negative = true;
-					}
-
-					// Only pursue if there is a change of sign
-					if (exist_cube_value_positive && exist_cube_value_negative) {
-
-						// Set the type of cube
-						int type = 0;
-						if (cube.value[0] < 0) type |= 1;
-						if (cube.value[1] < 0) type |= 2;
-						if (cube.value[2] < 0) type |= 4;
-						if (cube.value[3] < 0) type |= 8;
-						if (cube.value[4] < 0) type |= 16;
-						if (cube.value[5] < 0) type |= 32;
-						if (cube.value[6] < 0) type |= 64;
-						if (cube.value[7] < 0) type |= 128;
-
-						// 3D positions of the cube vertices
-						fill_position(cube.position[0], ux   , uy   , uz   , domain_min, domain_length);
-						fill_position(cube.position[1], ux+dx, uy   , uz   , domain_min, domain_length);
-						fill_position(cube.position[2], ux+dx, uy+dy, uz   , domain_min, domain_length);
-						fill_position(cube.position[3], ux   , uy+dy, uz   , domain_min, domain_length);
-						fill_position(cube.position[4], ux   , uy   , uz+dz, domain_min, domain_length);
-						fill_position(cube.position[5], ux+dx, uy   , uz+dz, domain_min, domain_length);
-						fill_position(cube.position[6], ux+dx, uy+dy, uz+dz, domain_min, domain_length);
-						fill_position(cube.position[7], ux   , uy+dy, uz+dz, domain_min, domain_length);
-
-
-						// Compute vertex at the intersection
-						if (edgeTable[type] &    1) 
-							interpolate_position_on_edge(new_vertex[0], new_vertex_alpha[0], 0, 1, cube.position, cube.value);
-						if (edgeTable[type] &    2)
-							interpolate_position_on_edge(new_vertex[1], new_vertex_alpha[1], 1, 2, cube.position, cube.value);
-						if (edgeTable[type] &    4)
-							interpolate_position_on_edge(new_vertex[2], new_vertex_alpha[2], 2, 3, cube.position, cube.value);
-						if (edgeTable[type] &    8)
-							interpolate_position_on_edge(new_vertex[3], new_vertex_alpha[3], 3, 0, cube.position, cube.value);
-						if (edgeTable[type] &   16)
-							interpolate_position_on_edge(new_vertex[4], new_vertex_alpha[4], 4, 5, cube.position, cube.value);
-						if (edgeTable[type] &   32)
-							interpolate_position_on_edge(new_vertex[5], new_vertex_alpha[5], 5, 6, cube.position, cube.value);
-						if (edgeTable[type] &   64)
-							interpolate_position_on_edge(new_vertex[6], new_vertex_alpha[6], 6, 7, cube.position, cube.value);
-						if (edgeTable[type] &  128)
-							interpolate_position_on_edge(new_vertex[7], new_vertex_alpha[7], 7, 4, cube.position, cube.value);
-						if (edgeTable[type] &  256)
-							interpolate_position_on_edge(new_vertex[8], new_vertex_alpha[8], 0, 4, cube.position, cube.value);
-						if (edgeTable[type] &  512)
-							interpolate_position_on_edge(new_vertex[9], new_vertex_alpha[9], 1, 5, cube.position, cube.value);
-						if (edgeTable[type] & 1024)
-							interpolate_position_on_edge(new_vertex[10], new_vertex_alpha[10], 2, 6, cube.position, cube.value);
-						if (edgeTable[type] & 2048)
-							interpolate_position_on_edge(new_vertex[11], new_vertex_alpha[11], 3, 7, cube.position, cube.value);
-
-
-
-						// Construct the new triangles
-						for (size_t k = 0; triTable[type][k] != -1; k += 3) { // read the table of correspondance for the triangle
-
-							vec3 const& p0 = new_vertex[triTable[type][k  ]];
-							vec3 const& p1 = new_vertex[triTable[type][k+1]];
-							vec3 const& p2 = new_vertex[triTable[type][k+2]];
-
-							if (position.size() < counter_position + 3)
-								position.resize(1.5 * (counter_position + 3));
-							
-
-							position[counter_position] = p0;
-							position[counter_position + 1] = p1;
-							position[counter_position + 2] = p2;
-							
-
-							if (relative != nullptr) {
-								if (relative->size() < counter_position + 3) 
-									relative->resize(1.5 * (counter_position + 3));
-								
-								int const idx0 = triTable[type][k];
-								(*relative)[counter_position].alpha = new_vertex_alpha[idx0];
-								(*relative)[counter_position].k0 = cube.index[lut_edge_order[idx0].first];
-								(*relative)[counter_position].k1 = cube.index[lut_edge_order[idx0].second];
-
-								int const idx1 = triTable[type][k+1];
-								(*relative)[counter_position+1].alpha = new_vertex_alpha[idx1];
-								(*relative)[counter_position+1].k0 = cube.index[lut_edge_order[idx1].first];
-								(*relative)[counter_position+1].k1 = cube.index[lut_edge_order[idx1].second];
-
-								int const idx2 = triTable[type][k+2];
-								(*relative)[counter_position+2].alpha = new_vertex_alpha[idx2];
-								(*relative)[counter_position+2].k0 = cube.index[lut_edge_order[idx2].first];
-								(*relative)[counter_position+2].k1 = cube.index[lut_edge_order[idx2].second];
-							}
+		float const uz = kz * dz;
+		for (size_t ky = 0; ky < Ny - 1; ++ky) {
+			float const uy = ky * dy;
+			for (size_t kx = 0; kx < Nx - 1; ++kx) {
+				float const ux = kx * dx;
 
-							counter_position += 3;
+				size_t const index_corner = kx + Nx * (ky + Ny * kz);
+			
+				// compute offsets of the cube vertices
+				for (size_t k_offset = 0; k_offset < 8; ++k_offset)
+					cube.index[k_offset] = index_corner + offset_cube[k_offset];
+
+				// get values
+				for (size_t k = 0; k < 8; ++k)
+					cube.value[k] = field[cube.index[k]] - iso;
+
+				// check if there is at least one change of sign in the vertices
+				exist_cube_value_positive = false;
+				exist_cube_value_negative = false;
+				for (size_t k = 0; k < 8; ++k) {
+					if (cube.value[k] >= 0) exist_cube_value_positive = true;
+					if (cube.value[k] <  0) exist_cube_value_negative = true;
+				}
 
+				// Only pursue if there is a change of sign
+				if (exist_cube_value_positive && exist_cube_value_negative) {
+
+					// Set the type of cube
+					int type = 0;
+					if (cube.value[0] < 0) type |= 1;
+					if (cube.value[1] < 0) type |= 2;
+					if (cube.value[2] < 0) type |= 4;
+					if (cube.value[3] < 0) type |= 8;
+					if (cube.value[4] < 0) type |= 16;
+					if (cube.value[5] < 0) type |= 32;
+					if (cube.value[6] < 0) type |= 64;
+					if (cube.value[7] < 0) type |= 128;
+
+					// 3D positions of the cube vertices
+					fill_position(cube.position[0], ux   , uy   , uz   , domain_min, domain_length);
+					fill_position(cube.position[1], ux+dx, uy   , uz   , domain_min, domain_length);
+					fill_position(cube.position[2], ux+dx, uy+dy, uz   , domain_min, domain_length);
+					fill_position(cube.position[3], ux   , uy+dy, uz   , domain_min, domain_length);
+					fill_position(cube.position[4], ux   , uy   , uz+dz, domain_min, domain_length);
+					fill_position(cube.position[5], ux+dx, uy   , uz+dz, domain_min, domain_length);
+					fill_position(cube.position[6], ux+dx, uy+dy, uz+dz, domain_min, domain_length);
+					fill_position(cube.position[7], ux   , uy+dy, uz+dz, domain_min, domain_length);
+
+
+					// Compute vertex at the intersection
+					if (edgeTable[type] &    1) 
+						interpolate_position_on_edge(new_vertex[0], new_vertex_alpha[0], 0, 1, cube.position, cube.value);
+					if (edgeTable[type] &    2)
+						interpolate_position_on_edge(new_vertex[1], new_vertex_alpha[1], 1, 2, cube.position, cube.value);
+					if (edgeTable[type] &    4)
+						interpolate_position_on_edge(new_vertex[2], new_vertex_alpha[2], 2, 3, cube.position, cube.value);
+					if (edgeTable[type] &    8)
+						interpolate_position_on_edge(new_vertex[3], new_vertex_alpha[3], 3, 0, cube.position, cube.value);
+					if (edgeTable[type] &   16)
+						interpolate_position_on_edge(new_vertex[4], new_vertex_alpha[4], 4, 5, cube.position, cube.value);
+					if (edgeTable[type] &   32)
+						interpolate_position_on_edge(new_vertex[5], new_vertex_alpha[5], 5, 6, cube.position, cube.value);
+					if (edgeTable[type] &   64)
+						interpolate_position_on_edge(new_vertex[6], new_vertex_alpha[6], 6, 7, cube.position, cube.value);
+					if (edgeTable[type] &  128)
+						interpolate_position_on_edge(new_vertex[7], new_vertex_alpha[7], 7, 4, cube.position, cube.value);
+					if (edgeTable[type] &  256)
+						interpolate_position_on_edge(new_vertex[8], new_vertex_alpha[8], 0, 4, cube.position, cube.value);
+					if (edgeTable[type] &  512)
+						interpolate_position_on_edge(new_vertex[9], new_vertex_alpha[9], 1, 5, cube.position, cube.value);
+					if (edgeTable[type] & 1024)
+						interpolate_position_on_edge(new_vertex[10], new_vertex_alpha[10], 2, 6, cube.position, cube.value);
+					if (edgeTable[type] & 2048)
+						interpolate_position_on_edge(new_vertex[11], new_vertex_alpha[11], 3, 7, cube.position, cube.value);
+
+
+
+					// Construct the new triangles
+					for (size_t k = 0; triTable[type][k] != -1; k += 3) { // read the table of correspondance for the triangle
+
+						vec3 const& p0 = new_vertex[triTable[type][k  ]];
+						vec3 const& p1 = new_vertex[triTable[type][k+1]];
+						vec3 const& p2 = new_vertex[triTable[type][k+2]];
+
+						position.push_back(p0);
+						position.push_back(p1);
+						position.push_back(p2);
+
+						if (relative != nullptr) {
+							for (size_t k_vertex = 0; k_vertex < 3; ++k_vertex) {
+								int const idx = triTable[type][k+k_vertex];
+								marching_cube_relative_coordinates r;
+								r.alpha = new_vertex_alpha[idx];
+								r.k0 = cube.index[lut_edge_order[idx].first];
+								r.k1 = cube.index[lut_edge_order[idx].second];
+								relative->push_back(r);
+							}
 						}
 
 					}
 
 				}
+
 			}
 		}
+	}
+
+
+	size_t marching_cube(std::vector<vec3>& position, std::vector<float> const& field, spatial_domain_grid_3D const& domain, float iso, std::vector<marching_cube_relative_coordinates>* relative)
+	{
+		// Table of correspondance between the 256 type of cube and the edges on which new vertices are created
+		//  + storage of the order of edge visiting on the cube
+		static marching_cube_tables const lut = { marching_cube_lut_triTable(), marching_cube_lut_edge_order(), marching_cube_lut_edgeTable() };
+
+		size_t const Nz = domain.samples.z;
+		if (Nz < 2)
+			return 0;
+
+		// Marching-Cube: the slabs between two z-planes are processed in parallel
+		// *************************** //
+		int const N_slab = int(Nz - 1);
+		std::vector<std::vector<vec3> > slab_position(N_slab);
+		std::vector<std::vector<marching_cube_relative_coordinates> > slab_relative(relative != nullptr ? N_slab : 0);
+		parallel_for(0, N_slab, [&](int kz) {
+			marching_cube_slab(kz, slab_position[kz], relative != nullptr ? &slab_relative[kz] : nullptr, field, domain, iso, lut);
+		}, 1);
+
+		// Concatenate the slabs in z order (same result as a sequential traversal)
+		std::vector<size_t> slab_offset(N_slab + 1, 0);
+		for (int kz = 0; kz < N_slab; ++kz)
+			slab_offset[kz + 1] = slab_offset[kz] + slab_position[kz].size();
+		size_t const counter_position = slab_offset[N_slab];
+
+		if (position.size() < counter_position)
+			position.resize(counter_position);
+		if (relative != nullptr && relative->size() < counter_position)
+			relative->resize(counter_position);
+		parallel_for(0, N_slab, [&](int kz) {
+			std::copy(slab_position[kz].begin(), slab_position[kz].end(), position.begin() + slab_offset[kz]);
+			if (relative != nullptr)
+				std::copy(slab_relative[kz].begin(), slab_relative[kz].end(), relative->begin() + slab_offset[kz]);
+		}, 1);
 
 		return counter_position;
 
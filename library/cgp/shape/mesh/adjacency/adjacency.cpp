@@ -0,0 +1,227 @@
+#include "adjacency.hpp"
+
+#include "cgp/base/base.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace cgp
+{
+	size_t csr_adjacency::size() const
+	{
+		return offset.size()>0 ? offset.size()-1 : 0;
+	}
+
+	unsigned int csr_adjacency::degree(size_t i) const
+	{
+		return offset.data[i+1]-offset.data[i];
+	}
+
+	unsigned int const* csr_adjacency::begin(size_t i) const
+	{
+		return index.data.data()+offset.data[i];
+	}
+
+	unsigned int const* csr_adjacency::end(size_t i) const
+	{
+		return index.data.data()+offset.data[i+1];
+	}
+
+	int csr_adjacency::find(size_t i, unsigned int value) const
+	{
+		unsigned int const* it = std::lower_bound(begin(i), end(i), value);
+		return (it!=end(i) && *it==value) ? int(it-begin(i)) : -1;
+	}
+
+	// Counting sort: lists for each target t the items i (increasing) such that one of the ARITY targets of i given by
+	//  keys(i, t) is t. keys writes -1 for a slot to ignore, and slots of an item with the same target are counted once.
+	//  The items are cut in at most one range per thread: each range counts its targets, the offsets of the ranges are
+	//  then accumulated target by target, and each range scatters its items after those of the previous ranges. The lists
+	//  come out sorted without sorting, and the extra memory is one counter per target and per range.
+	template <int ARITY, typename KEYS>
+	static csr_adjacency csr_invert(size_t N_item, size_t N_target, KEYS const& keys)
+	{
+		auto unique_keys = [&](int i, int* t) {
+			keys(i, t);
+			for(int j=1; j<ARITY; ++j)
+				for(int k=0; k<j; ++k)
+					if(t[j]==t[k]) t[j] = -1;
+		};
+
+		size_t const grain = size_t(std::max(1, parallel_grain_size()));
+		int const N_range = int(std::max(size_t(1), std::min(size_t(parallel_thread_count()), N_item/grain)));
+		auto range_first = [&](int r) { return int(N_item*r/N_range); };
+
+		// counter[r*N_target+t]: number of items of the range r in the list t, then the position where the next one is written
+		std::vector<unsigned int> counter(size_t(N_range)*N_target, 0u);
+		parallel_for(0, N_range, [&](int r) {
+			unsigned int* const count = counter.data() + size_t(r)*N_target;
+			int t[ARITY];
+			for(int i=range_first(r); i<range_first(r+1); ++i) {
+				unique_keys(i, t);
+				for(int j=0; j<ARITY; ++j)
+					if(t[j]>=0) count[t[j]]++;
+			}
+		}, 1);
+
+		csr_adjacency csr;
+		csr.offset.resize(int(N_target+1));
+		unsigned int* const offset = csr.offset.data.data();
+		unsigned int total = 0;
+		for(size_t k=0; k<N_target; ++k) {
+			offset[k] = total;
+			for(int r=0; r<N_range; ++r) {
+				unsigned int const count = counter[size_t(r)*N_target+k];
+				counter[size_t(r)*N_target+k] = total;
+				total += count;
+			}
+		}
+		offset[N_target] = total;
+
+		csr.index.resize(int(total));
+		unsigned int* const index = csr.index.data.data();
+		parallel_for(0, N_range, [&](int r) {
+			unsigned int* const cursor = counter.data() + size_t(r)*N_target;
+			int t[ARITY];
+			for(int i=range_first(r); i<range_first(r+1); ++i) {
+				unique_keys(i, t);
+				for(int j=0; j<ARITY; ++j)
+					if(t[j]>=0) index[cursor[t[j]]++] = (unsigned int)i;
+			}
+		}, 1);
+		return csr;
+	}
+
+	csr_adjacency mesh_vertex_to_face(buffer<uint3> const& connectivity, size_t N_vertex)
+	{
+		profile_zone_cgp("mesh vertex to face");
+		for(uint3 const& tri : connectivity)
+			assert_cgp(tri[0]<N_vertex && tri[1]<N_vertex && tri[2]<N_vertex, "Vertex index of face "+str(tri)+" is larger than the number of vertices "+str(N_vertex));
+
+		uint3 const* tri = connectivity.data.data();
+		return csr_invert<3>(connectivity.size(), N_vertex, [tri](int f, int* t) {
+			t[0] = int(tri[f].x); t[1] = int(tri[f].y); t[2] = int(tri[f].z);
+		});
+	}
+
+	csr_adjacency mesh_vertex_one_ring(buffer<uint3> const& connectivity, size_t N_vertex)
+	{
+		return mesh_vertex_one_ring(connectivity, mesh_vertex_to_face(connectivity, N_vertex));
+	}
+
+	csr_adjacency mesh_vertex_one_ring(buffer<uint3> const& connectivity, csr_adjacency const& vertex_to_face)
+	{
+		profile_zone_cgp("mesh one ring");
+		size_t const N_vertex = vertex_to_face.size();
+
+		// Each entry p of the vertex to face lists (face f of the vertex w) is an item whose targets are the other vertices v of f.
+		//  Inverting these items lists the entries of each v by increasing p, so by increasing w: the neighbors of v come out
+		//  sorted and the repeated ones are consecutive.
+		std::vector<unsigned int> owner(vertex_to_face.index.size());
+		parallel_for(0, int(N_vertex), [&](int w) {
+			std::fill(owner.begin()+vertex_to_face.offset.data[w], owner.begin()+vertex_to_face.offset.data[w+1], unsigned(w));
+		});
+		uint3 const* tri = connectivity.data.data();
+		unsigned int const* face = vertex_to_face.index.data.data();
+		unsigned int const* face_owner = owner.data();
+		csr_adjacency const entries = csr_invert<3>(owner.size(), N_vertex, [tri, face, face_owner](int p, int* t) {
+			uint3 const& f = tri[face[p]];
+			unsigned int const w = face_owner[p];
+			t[0] = f.x!=w ? int(f.x) : -1; t[1] = f.y!=w ? int(f.y) : -1; t[2] = f.z!=w ? int(f.z) : -1;
+		});
+
+		// Remove the repeated neighbors
+		std::vector<unsigned int> count(N_vertex);
+		parallel_for(0, int(N_vertex), [&](int v) {
+			unsigned int n = 0;
+			for(unsigned int const* p=entries.begin(v); p!=entries.end(v); ++p)
+				if(p==entries.begin(v) || face_owner[*p]!=face_owner[*(p-1)]) n++;
+			count[v] = n;
+		});
+
+		csr_adjacency one_ring;
+		one_ring.offset.resize(int(N_vertex+1));
+		one_ring.offset[0] = 0;
+		for(size_t v=0; v<N_vertex; ++v)
+			one_ring.offset[v+1] = one_ring.offset[v]+count[v];
+
+		one_ring.index.resize(int(one_ring.offset[N_vertex]));
+		parallel_for(0, int(N_vertex), [&](int v) {
+			unsigned int* out = one_ring.index.data.data()+one_ring.offset.data[v];
+			for(unsigned int const* p=entries.begin(v); p!=entries.end(v); ++p)
+				if(p==entries.begin(v) || face_owner[*p]!=face_owner[*(p-1)]) *out++ = face_owner[*p];
+		});
+		return one_ring;
+	}
+
+	int mesh_edge_adjacency::find(unsigned int a, unsigned int b) const
+	{
+		if(a>b) std::swap(a,b);
+		if(a==b || size_t(b)>=one_ring.size())
+			return -1;
+		unsigned int const* const end = one_ring.end(a);
+		unsigned int const* const it = std::lower_bound(one_ring.begin(a), end, b);
+		if(it==end || *it!=b)
+			return -1;
+		// Edges of a are its neighbors larger than a, which are at the end of its sorted one ring
+		return int(first_edge.data[a+1] - (end-it));
+	}
+
+	unsigned int const* mesh_edge_adjacency::faces(unsigned int a, unsigned int b, unsigned int& face_count) const
+	{
+		int const e = find(a, b);
+		if(e<0) {
+			face_count = 0;
+			return nullptr;
+		}
+		face_count = edge_to_face.degree(e);
+		return edge_to_face.begin(e);
+	}
+
+	mesh_edge_adjacency mesh_edges(buffer<uint3> const& connectivity, size_t N_vertex)
+	{
+		profile_zone_cgp("mesh edges");
+		mesh_edge_adjacency adjacency;
+		adjacency.one_ring = mesh_vertex_one_ring(connectivity, N_vertex);
+		csr_adjacency const& one_ring = adjacency.one_ring;
+
+		// Edges (a,b) with a<b, numbered in the order of a then b
+		adjacency.first_edge.resize(int(N_vertex+1));
+		adjacency.first_edge[0] = 0;
+		for(size_t a=0; a<N_vertex; ++a) {
+			unsigned int const larger = unsigned(one_ring.end(a) - std::upper_bound(one_ring.begin(a), one_ring.end(a), unsigned(a)));
+			adjacency.first_edge[a+1] = adjacency.first_edge[a] + larger;
+		}
+
+		adjacency.edges.resize(int(adjacency.first_edge[N_vertex]));
+		uint2* const edges = adjacency.edges.data.data();
+		parallel_for(0, int(N_vertex), [&](int a) {
+			unsigned int e = adjacency.first_edge.data[a];
+			for(unsigned int const* b=std::upper_bound(one_ring.begin(a), one_ring.end(a), unsigned(a)); b!=one_ring.end(a); ++b)
+				edges[e++] = uint2(unsigned(a), *b);
+		});
+
+		// Faces of each edge
+		std::vector<int> face_edge(3*connectivity.size());
+		uint3 const* tri = connectivity.data.data();
+		parallel_for(0, int(connectivity.size()), [&](int f) {
+			face_edge[3*f] = adjacency.find(tri[f].x, tri[f].y);
+			face_edge[3*f+1] = adjacency.find(tri[f].y, tri[f].z);
+			face_edge[3*f+2] = adjacency.find(tri[f].z, tri[f].x);
+		});
+		int const* edge_of_face = face_edge.data();
+		adjacency.edge_to_face = csr_invert<3>(connectivity.size(), adjacency.edges.size(), [edge_of_face](int f, int* t) {
+			t[0] = edge_of_face[3*f]; t[1] = edge_of_face[3*f+1]; t[2] = edge_of_face[3*f+2];
+		});
+
+		return adjacency;
+	}
+
+	size_t connectivity_vertex_count(buffer<uint3> const& connectivity)
+	{
+		unsigned int N = 0;
+		for(uint3 const& tri : connectivity)
+			N = std::max(N, std::max(tri[0], std::max(tri[1], tri[2]))+1);
+		return N;
+	}
+}
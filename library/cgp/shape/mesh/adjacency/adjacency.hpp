@@ -0,0 +1,58 @@
+#pragma once
+
+#include "cgp/containers/containers.hpp"
+
+namespace cgp
+{
+	/** Compressed sparse row storage of N lists of indices stored contiguously
+	* The list i is index[offset[i]] ... index[offset[i+1]-1], and offset has N+1 elements */
+	struct csr_adjacency
+	{
+		buffer<unsigned int> offset;
+		buffer<unsigned int> index;
+
+		/** Number of lists */
+		size_t size() const;
+		/** Number of elements in the list i */
+		unsigned int degree(size_t i) const;
+		/** Elements of the list i: for(unsigned int const* it=begin(i); it!=end(i); ++it) */
+		unsigned int const* begin(size_t i) const;
+		unsigned int const* end(size_t i) const;
+		/** Position of the value in the sorted list i, -1 if the value is not in the list */
+		int find(size_t i, unsigned int value) const;
+	};
+
+	/** Faces adjacent to each vertex, in increasing order (each face appears once, even if it is degenerate)
+	* Built by counting sort in O(T) time and O(N_vertex) extra memory per thread (parallel, the result doesn't depend on the number of threads). */
+	csr_adjacency mesh_vertex_to_face(buffer<uint3> const& connectivity, size_t N_vertex);
+
+	/** Vertices adjacent to each vertex through an edge (one ring), in increasing order
+	* Built in O(T) by a second counting sort of the vertex to face lists (no sort of the lists). */
+	csr_adjacency mesh_vertex_one_ring(buffer<uint3> const& connectivity, size_t N_vertex);
+	/** One ring computed from an existing vertex to face adjacency */
+	csr_adjacency mesh_vertex_one_ring(buffer<uint3> const& connectivity, csr_adjacency const& vertex_to_face);
+
+	/** Unique edges of a triangle mesh and their adjacent faces
+	* Edge k is edges[k]=(a,b) with a<b, the edges are sorted by (a,b) */
+	struct mesh_edge_adjacency
+	{
+		buffer<uint2> edges;
+		/** Faces adjacent to each edge, in increasing order (2 for an interior edge of a manifold mesh, 1 on a border) */
+		csr_adjacency edge_to_face;
+		/** One ring of each vertex */
+		csr_adjacency one_ring;
+		/** Edges (a,b) with a=v are the edges first_edge[v] to first_edge[v+1]-1 */
+		buffer<unsigned int> first_edge;
+
+		/** Index of the edge between a and b (in any order), -1 if there is no such edge */
+		int find(unsigned int a, unsigned int b) const;
+		/** Faces adjacent to the edge between a and b, nullptr (and 0 faces) if there is no such edge */
+		unsigned int const* faces(unsigned int a, unsigned int b, unsigned int& face_count) const;
+	};
+
+	/** Build the unique edges, their adjacent faces and the one ring of a triangle mesh in O(T) */
+	mesh_edge_adjacency mesh_edges(buffer<uint3> const& connectivity, size_t N_vertex);
+
+	/** Number of vertices referenced by the connectivity (largest index + 1) */
+	size_t connectivity_vertex_count(buffer<uint3> const& connectivity);
+}
@@ -0,0 +1,94 @@
+#include "test_adjacency.hpp"
+
+#include "cgp/base/base.hpp"
+#include "../adjacency.hpp"
+#include "cgp/shape/mesh/primitive/mesh_primitive.hpp"
+
+namespace cgp_test
+{
+	namespace {
+		bool is_equal_csr(cgp::csr_adjacency const& a, cgp::csr_adjacency const& b)
+		{
+			return cgp::is_equal(a.offset, b.offset) && cgp::is_equal(a.index, b.index);
+		}
+	}
+
+	void test_adjacency()
+	{
+		using namespace cgp;
+
+		// Two triangles sharing the edge (1,2)
+		{
+			buffer<uint3> const connectivity = { uint3(0,1,2), uint3(1,3,2) };
+			csr_adjacency const v2f = mesh_vertex_to_face(connectivity, 5);
+			assert_cgp_no_msg(v2f.size()==5);
+			assert_cgp_no_msg(v2f.degree(0)==1 && v2f.degree(1)==2 && v2f.degree(2)==2 && v2f.degree(3)==1 && v2f.degree(4)==0);
+			assert_cgp_no_msg(v2f.find(1,0)==0 && v2f.find(1,1)==1 && v2f.find(0,1)==-1);
+
+			csr_adjacency const ring = mesh_vertex_one_ring(connectivity, 4);
+			assert_cgp_no_msg(ring.degree(1)==3 && ring.find(1,0)>=0 && ring.find(1,2)>=0 && ring.find(1,3)>=0);
+			assert_cgp_no_msg(ring.degree(0)==2 && ring.find(0,3)==-1);
+
+			mesh_edge_adjacency const edges = mesh_edges(connectivity, 4);
+			assert_cgp_no_msg(edges.edges.size()==5);
+			unsigned int count = 0;
+			edges.faces(2, 1, count);
+			assert_cgp_no_msg(count==2);
+			edges.faces(0, 1, count);
+			assert_cgp_no_msg(count==1);
+			assert_cgp_no_msg(edges.find(0, 3)==-1);
+		}
+
+		// Degenerate face listed once per vertex
+		{
+			buffer<uint3> const connectivity = { uint3(0,0,1) };
+			csr_adjacency const v2f = mesh_vertex_to_face(connectivity, 2);
+			assert_cgp_no_msg(v2f.degree(0)==1 && v2f.degree(1)==1);
+		}
+
+		// The parallel construction gives the same sorted lists as the serial one
+		{
+			mesh const m = mesh_primitive_grid({0,0,0}, {1,0,0}, {1,1,0}, {0,1,0}, 120, 120);
+			int const thread_count = parallel_thread_count();
+
+			parallel_set_thread_count(1);
+			csr_adjacency const v2f_serial = mesh_vertex_to_face(m.connectivity, m.position.size());
+			mesh_edge_adjacency const edges_serial = mesh_edges(m.connectivity, m.position.size());
+
+			parallel_set_thread_count(4);
+			csr_adjacency const v2f_parallel = mesh_vertex_to_face(m.connectivity, m.position.size());
+			mesh_edge_adjacency const edges_parallel = mesh_edges(m.connectivity, m.position.size());
+			parallel_set_thread_count(thread_count);
+
+			assert_cgp_no_msg(is_equal_csr(v2f_serial, v2f_parallel));
+			assert_cgp_no_msg(is_equal_csr(edges_serial.edge_to_face, edges_parallel.edge_to_face));
+			assert_cgp_no_msg(is_equal_csr(edges_serial.one_ring, edges_parallel.one_ring));
+
+			bool sorted = true;
+			for(size_t v=0; v<v2f_parallel.size(); ++v)
+				for(unsigned int const* it=v2f_parallel.begin(v); it+1<v2f_parallel.end(v); ++it)
+					sorted = sorted && *it < *(it+1);
+			assert_cgp_no_msg(sorted);
+			assert_cgp_no_msg(v2f_parallel.index.size()==3*m.connectivity.size());
+		}
+
+		// Fan around a vertex of high valence: the lists are built in order, with any number of threads
+		{
+			int const N = 50000;
+			buffer<uint3> connectivity;
+			for(int k=0; k<N; ++k)
+				connectivity.push_back(uint3(0, k+1, (k+1)%N+1));
+			int const thread_count = parallel_thread_count();
+			parallel_set_thread_count(4);
+			csr_adjacency const v2f = mesh_vertex_to_face(connectivity, N+1);
+			csr_adjacency const ring = mesh_vertex_one_ring(connectivity, N+1);
+			parallel_set_thread_count(thread_count);
+
+			bool in_order = v2f.degree(0)==unsigned(N) && ring.degree(0)==unsigned(N);
+			for(int k=0; k<N; ++k)
+				in_order = in_order && v2f.begin(0)[k]==unsigned(k) && ring.begin(0)[k]==unsigned(k+1);
+			assert_cgp_no_msg(in_order);
+			assert_cgp_no_msg(ring.degree(1)==3 && ring.begin(1)[0]==0 && ring.begin(1)[1]==2 && ring.begin(1)[2]==unsigned(N));
+		}
+	}
+}
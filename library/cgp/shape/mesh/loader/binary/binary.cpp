@@ -0,0 +1,230 @@
+#ifdef _WIN32
+#pragma warning( disable : 4996 )
+#endif
+
+#include "binary.hpp"
+
+#include "cgp/base/base.hpp"
+#include "cgp/files/files.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <sys/stat.h>
+
+namespace cgp
+{
+
+namespace loader {
+
+    namespace {
+
+        uint32_t const mesh_binary_version = 1;
+        uint32_t const mesh_binary_byte_order = 0x01020304;
+        uint64_t const mesh_binary_alignment = 64;
+
+        uint64_t align(uint64_t offset)
+        {
+            return (offset + mesh_binary_alignment-1) / mesh_binary_alignment * mesh_binary_alignment;
+        }
+
+        // 64 bits multiplicative hash of the content, 4 independent lanes over 8 bytes words to keep the multiplications pipelined
+        uint64_t checksum_update(uint64_t hash, char const* data, size_t size)
+        {
+            uint64_t const prime = 0x100000001b3ull;
+            uint64_t lane[4] = { hash, hash ^ 0x9e3779b97f4a7c15ull, hash ^ 0xc2b2ae3d27d4eb4full, hash ^ 0x165667b19e3779f9ull };
+
+            size_t k = 0;
+            for(; k+32<=size; k+=32) {
+                for(int i=0; i<4; ++i) {
+                    uint64_t word;
+                    std::memcpy(&word, data+k+8*i, 8);
+                    lane[i] = (lane[i] ^ word) * prime;
+                }
+            }
+            for(; k<size; ++k)
+                lane[0] = (lane[0] ^ uint64_t(uint8_t(data[k]))) * prime;
+
+            uint64_t h = size;
+            for(int i=0; i<4; ++i)
+                h = (h ^ lane[i] ^ (lane[i]>>29)) * prime;
+            return h;
+        }
+
+        template <typename T>
+        char const* section_data(buffer<T> const& b)
+        {
+            return reinterpret_cast<char const*>(b.data.data());
+        }
+
+        template <typename T>
+        mesh_binary_section place_section(buffer<T> const& b, uint64_t& offset)
+        {
+            mesh_binary_section section;
+            section.offset = align(offset);
+            section.count = b.size();
+            offset = section.offset + section.count*sizeof(T);
+            return section;
+        }
+
+        template <typename T>
+        bool write_section(std::FILE* file, buffer<T> const& b, mesh_binary_section const& section, uint64_t& offset)
+        {
+            static char const zeros[mesh_binary_alignment] = {};
+            if(std::fwrite(zeros, 1, section.offset-offset, file) != section.offset-offset)
+                return false;
+            size_t const size = b.size()*sizeof(T);
+            if(size>0 && std::fwrite(section_data(b), 1, size, file) != size)
+                return false;
+            offset = section.offset + size;
+            return true;
+        }
+
+        template <typename T>
+        bool valid_section(mesh_binary_section const& section, size_t file_size)
+        {
+            return section.offset % mesh_binary_alignment == 0
+                && section.offset <= file_size
+                && section.count <= (file_size - section.offset) / sizeof(T)
+                && section.count <= uint64_t(std::numeric_limits<int>::max());
+        }
+
+        template <typename T>
+        uint64_t checksum_section(uint64_t hash, char const* data, mesh_binary_section const& section)
+        {
+            return checksum_update(hash, data+section.offset, section.count*sizeof(T));
+        }
+
+        template <typename T>
+        void copy_section(buffer<T>& b, char const* data, mesh_binary_section const& section)
+        {
+            b.resize(int(section.count));
+            if(section.count>0)
+                std::memcpy(b.data.data(), data+section.offset, section.count*sizeof(T));
+        }
+
+        uint64_t mesh_checksum(mesh const& m)
+        {
+            uint64_t hash = 0xcbf29ce484222325ull;
+            hash = checksum_update(hash, section_data(m.position), m.position.size()*sizeof(vec3));
+            hash = checksum_update(hash, section_data(m.normal), m.normal.size()*sizeof(vec3));
+            hash = checksum_update(hash, section_data(m.color), m.color.size()*sizeof(vec3));
+            hash = checksum_update(hash, section_data(m.uv), m.uv.size()*sizeof(vec2));
+            hash = checksum_update(hash, section_data(m.connectivity), m.connectivity.size()*sizeof(uint3));
+            return hash;
+        }
+    }
+
+    mesh_binary_stamp mesh_binary_file_stamp(std::string const& filename)
+    {
+        mesh_binary_stamp stamp = {0, 0};
+        struct stat stat_buf;
+        if(stat(filename.c_str(), &stat_buf)==0) {
+            stamp.size = uint64_t(stat_buf.st_size);
+            stamp.time = int64_t(stat_buf.st_mtime);
+        }
+        return stamp;
+    }
+
+    bool mesh_binary_write(std::string const& filename, mesh const& m, mesh_binary_stamp const& source)
+    {
+        profile_zone_cgp("mesh binary write");
+
+        mesh_binary_header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "CGPMESH", 8);
+        header.version = mesh_binary_version;
+        header.byte_order = mesh_binary_byte_order;
+        header.source = source;
+        header.checksum = mesh_checksum(m);
+
+        uint64_t offset = sizeof(header);
+        header.position = place_section(m.position, offset);
+        header.normal = place_section(m.normal, offset);
+        header.color = place_section(m.color, offset);
+        header.uv = place_section(m.uv, offset);
+        header.connectivity = place_section(m.connectivity, offset);
+
+        std::string const temporary = filename + ".tmp";
+        std::FILE* file = std::fopen(temporary.c_str(), "wb");
+        if(file==nullptr)
+            return false;
+
+        offset = sizeof(header);
+        bool ok = std::fwrite(&header, sizeof(header), 1, file)==1;
+        ok = ok && write_section(file, m.position, header.position, offset);
+        ok = ok && write_section(file, m.normal, header.normal, offset);
+        ok = ok && write_section(file, m.color, header.color, offset);
+        ok = ok && write_section(file, m.uv, header.uv, offset);
+        ok = ok && write_section(file, m.connectivity, header.connectivity, offset);
+        ok = (std::fclose(file)==0) && ok;
+
+        if(ok) {
+            std::remove(filename.c_str()); // rename doesn't replace an existing file on Windows
+            ok = std::rename(temporary.c_str(), filename.c_str())==0;
+        }
+        if(!ok)
+            std::remove(temporary.c_str());
+        return ok;
+    }
+
+    bool mesh_binary_read(std::string const& filename, mesh& m, mesh_binary_stamp const* source)
+    {
+        profile_zone_cgp("mesh binary read");
+
+        mapped_file file;
+        if(!file.open(filename) || file.size()<sizeof(mesh_binary_header))
+            return false;
+        char const* data = file.data();
+        size_t const size = file.size();
+
+        mesh_binary_header header;
+        std::memcpy(&header, data, sizeof(header));
+        if(std::memcmp(header.magic, "CGPMESH", 8)!=0 || header.version!=mesh_binary_version || header.byte_order!=mesh_binary_byte_order)
+            return false;
+        if(source!=nullptr && (header.source.size!=source->size || header.source.time!=source->time))
+            return false;
+
+        bool const valid = valid_section<vec3>(header.position, size)
+            && valid_section<vec3>(header.normal, size)
+            && valid_section<vec3>(header.color, size)
+            && valid_section<vec2>(header.uv, size)
+            && valid_section<uint3>(header.connectivity, size);
+        if(!valid)
+            return false;
+
+        uint64_t hash = 0xcbf29ce484222325ull;
+        hash = checksum_section<vec3>(hash, data, header.position);
+        hash = checksum_section<vec3>(hash, data, header.normal);
+        hash = checksum_section<vec3>(hash, data, header.color);
+        hash = checksum_section<vec2>(hash, data, header.uv);
+        hash = checksum_section<uint3>(hash, data, header.connectivity);
+        if(hash!=header.checksum)
+            return false;
+
+        copy_section(m.position, data, header.position);
+        copy_section(m.normal, data, header.normal);
+        copy_section(m.color, data, header.color);
+        copy_section(m.uv, data, header.uv);
+        copy_section(m.connectivity, data, header.connectivity);
+        return true;
+    }
+
+}
+
+    void mesh_save_file_binary(std::string const& filename, mesh const& m)
+    {
+        if(!loader::mesh_binary_write(filename, m))
+            error_cgp("Cannot write file " + str(filename));
+    }
+
+    mesh mesh_load_file_binary(std::string const& filename)
+    {
+        assert_file_exist(filename);
+        mesh m;
+        if(!loader::mesh_binary_read(filename, m))
+            error_cgp("File " + str(filename) + " is not a valid binary mesh file");
+        return m;
+    }
+
+}
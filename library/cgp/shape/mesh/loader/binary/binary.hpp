@@ -0,0 +1,66 @@
+#pragma once
+
+#include "../../structure/mesh.hpp"
+
+#include <cstdint>
+
+namespace cgp
+{
+    /** Save a mesh in the binary mesh format (.cgpmesh) - see loader::mesh_binary_header for the layout */
+    void mesh_save_file_binary(std::string const& filename, mesh const& m);
+
+    /** Load a mesh stored in the binary mesh format (.cgpmesh)
+    * The file is memory mapped, checked (header, section bounds, checksum), and each section is copied in one block in the buffers of the mesh */
+    mesh mesh_load_file_binary(std::string const& filename);
+
+
+namespace loader {
+
+    /** Section of a binary mesh file: byte offset from the start of the file (multiple of 64) and number of elements */
+    struct mesh_binary_section {
+        uint64_t offset;
+        uint64_t count;
+    };
+
+    /** Identification of the file a binary mesh was generated from (size and last modification time), zero if none */
+    struct mesh_binary_stamp {
+        uint64_t size;
+        int64_t time;
+    };
+
+    /** Header of a binary mesh file
+     * File layout:
+     *   header
+     *   position     vec3[position.count]
+     *   normal       vec3[normal.count]
+     *   color        vec3[color.count]
+     *   uv           vec2[uv.count]
+     *   connectivity uint3[connectivity.count]
+     * Each section starts on a 64 bytes boundary (zero padding in between).
+     * The checksum is computed on the content of the sections, values are stored in the byte order of the writer. */
+    struct mesh_binary_header {
+        char magic[8];        // "CGPMESH" followed by a zero
+        uint32_t version;
+        uint32_t byte_order;  // 0x01020304 as written by the machine that created the file
+        mesh_binary_stamp source;
+        uint64_t checksum;
+        mesh_binary_section position;
+        mesh_binary_section normal;
+        mesh_binary_section color;
+        mesh_binary_section uv;
+        mesh_binary_section connectivity;
+    };
+
+    /** Stamp of an existing file, the size is 0 if the file cannot be accessed */
+    mesh_binary_stamp mesh_binary_file_stamp(std::string const& filename);
+
+    /** Write the mesh in a binary file, the source stamp is stored in the header. Return false if the file cannot be written.
+     * The data is written in a temporary file renamed at the end, such that a reader never sees a partial file. */
+    bool mesh_binary_write(std::string const& filename, mesh const& m, mesh_binary_stamp const& source = mesh_binary_stamp());
+
+    /** Read a binary mesh file. Return false (m is unchanged) if the file cannot be opened, is invalid or corrupted,
+     * or if source is given and differs from the stamp stored in the header. */
+    bool mesh_binary_read(std::string const& filename, mesh& m, mesh_binary_stamp const* source = nullptr);
+}
+
+}
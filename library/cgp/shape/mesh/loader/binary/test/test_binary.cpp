@@ -0,0 +1,117 @@
+#include "test_binary.hpp"
+
+#include "cgp/base/base.hpp"
+#include "../binary.hpp"
+#include "../../obj/obj.hpp"
+#include "cgp/shape/mesh/primitive/mesh_primitive.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace cgp_test
+{
+    namespace {
+        bool is_same_mesh(cgp::mesh const& a, cgp::mesh const& b)
+        {
+            using namespace cgp;
+            if(a.connectivity.size()!=b.connectivity.size())
+                return false;
+            for(int k=0; k<a.connectivity.size(); ++k)
+                if(!is_equal(a.connectivity[k], b.connectivity[k]))
+                    return false;
+            return is_equal(a.position, b.position) && is_equal(a.normal, b.normal) && is_equal(a.color, b.color) && is_equal(a.uv, b.uv);
+        }
+
+        std::string read_file(std::string const& filename)
+        {
+            std::ifstream stream(filename, std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+        }
+
+        void write_file(std::string const& filename, std::string const& content)
+        {
+            std::ofstream stream(filename, std::ios::binary);
+            stream.write(content.data(), content.size());
+        }
+    }
+
+    void test_binary()
+    {
+        using namespace cgp;
+        std::string const filename = "cgp_test_binary.cgpmesh";
+
+        mesh m = mesh_primitive_torus(1.0f, 0.3f, {0,0,0}, {0,0,1}, 30, 12);
+        m.fill_empty_field();
+        for(int k=0; k<m.color.size(); ++k)
+            m.color[k] = vec3(k/float(m.color.size()), 0.5f, 1.0f);
+
+        // Exact round trip
+        {
+            mesh_save_file_binary(filename, m);
+            mesh const r = mesh_load_file_binary(filename);
+            assert_cgp_no_msg(is_same_mesh(r, m));
+        }
+
+        // Source stamp stored in the header
+        {
+            loader::mesh_binary_stamp const stamp = { 1234, 5678 };
+            assert_cgp_no_msg(loader::mesh_binary_write(filename, m, stamp));
+            mesh r;
+            assert_cgp_no_msg(loader::mesh_binary_read(filename, r, &stamp));
+            assert_cgp_no_msg(is_same_mesh(r, m));
+
+            loader::mesh_binary_stamp const other = { 1234, 5679 };
+            mesh unchanged;
+            assert_cgp_no_msg(!loader::mesh_binary_read(filename, unchanged, &other));
+            assert_cgp_no_msg(unchanged.position.size()==0);
+        }
+
+        // Corrupted and truncated files are rejected
+        {
+            std::string const content = read_file(filename);
+            std::string corrupted = content;
+            corrupted[corrupted.size()-5] ^= 1;
+            write_file(filename, corrupted);
+            mesh r;
+            assert_cgp_no_msg(!loader::mesh_binary_read(filename, r));
+            assert_cgp_no_msg(r.position.size()==0);
+
+            write_file(filename, content.substr(0, content.size()-64));
+            assert_cgp_no_msg(!loader::mesh_binary_read(filename, r));
+
+            write_file(filename, content.substr(0, sizeof(loader::mesh_binary_header)/2));
+            assert_cgp_no_msg(!loader::mesh_binary_read(filename, r));
+
+            assert_cgp_no_msg(!loader::mesh_binary_read("cgp_test_binary_missing.cgpmesh", r));
+        }
+
+        // Sidecar cache of the obj loader
+        {
+            std::string const obj = "cgp_test_binary.obj";
+            std::string const cache = obj + ".cgpmesh";
+            bool const enabled = obj_binary_cache();
+            obj_set_binary_cache(true);
+
+            mesh_save_file_obj(obj, m);
+            std::remove(cache.c_str());
+            mesh const parsed = mesh_load_file_obj(obj);
+            loader::mesh_binary_stamp const stamp = loader::mesh_binary_file_stamp(obj);
+            mesh cached;
+            assert_cgp_no_msg(loader::mesh_binary_read(cache, cached, &stamp));
+            assert_cgp_no_msg(is_same_mesh(cached, parsed));
+            assert_cgp_no_msg(is_same_mesh(mesh_load_file_obj(obj), parsed));
+
+            // A modified obj file doesn't match the stamp of the cache anymore
+            write_file(obj, read_file(obj) + "# modified\n");
+            loader::mesh_binary_stamp const modified = loader::mesh_binary_file_stamp(obj);
+            assert_cgp_no_msg(!loader::mesh_binary_read(cache, cached, &modified));
+
+            std::remove(obj.c_str());
+            std::remove(cache.c_str());
+            obj_set_binary_cache(enabled);
+        }
+
+        std::remove(filename.c_str());
+    }
+}
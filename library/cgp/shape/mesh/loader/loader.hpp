@@ -1,3 +1,5 @@
 #pragma once
 
-#include "obj/obj.hpp"
\ No newline at end of file
+#include "obj/obj.hpp"
+#include "binary/binary.hpp"
+#include "ply/ply.hpp"
\ No newline at end of file
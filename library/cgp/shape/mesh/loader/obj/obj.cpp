@@ -6,419 +6,615 @@
 #endif
 
 #include "obj.hpp"
+#include "../binary/binary.hpp"
 
 #include "cgp/base/base.hpp"
 #include "cgp/files/files.hpp"
 
-#include <map>
-
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <sstream>
 
 namespace cgp
 {
 
-    void mesh_save_file_obj(std::string const& filename, mesh const& m)
+// Text formatting for the obj writer: each function writes at p and returns the end of the written text
+namespace {
+
+    inline char* write_text(char* p, char const* text)
     {
-        std::ofstream stream(filename, std::ofstream::out);
-        assert_cgp(stream.is_open(), "Cannot open file " + str(filename));
-
-        for (int k = 0; k < m.position.size(); ++k)
-            stream << "v " << m.position[k].x << " " << m.position[k].y <<" " << m.position[k].z << std::endl;
-        for (int k = 0; k < m.uv.size(); ++k)
-            stream << "vt " << m.uv[k].x <<" " << m.uv[k].y << std::endl;
-        for (int k = 0; k < m.normal.size(); ++k)
-            stream << "vn " << m.normal[k].x << " " << m.normal[k].y <<" " << m.normal[k].z << std::endl;
-
-        for (int k = 0; k < m.connectivity.size(); ++k) {
-            std::string const u0 = str(m.connectivity[k][0]+1);
-            std::string const u1 = str(m.connectivity[k][1]+1);
-            std::string const u2 = str(m.connectivity[k][2]+1);
-            std::string const f0 = u0 + "/" + u0 + "/" + u0;
-            std::string const f1 = u1 + "/" + u1 + "/" + u1;
-            std::string const f2 = u2 + "/" + u2 + "/" + u2;
-
-            stream << "f " << f0 << " " << f1 << " " << f2 << std::endl;
-        }
+        while(*text) *p++ = *text++;
+        return p;
+    }
 
-        stream.close();
+    inline char* write_uint(char* p, unsigned int value)
+    {
+        char digits[10];
+        int n = 0;
+        do { digits[n++] = char('0' + value%10); value /= 10; } while(value>0);
+        while(n>0) *p++ = digits[--n];
+        return p;
     }
 
-    void save_file_obj(std::string const& filename, std::vector<vec3> const& position, std::vector<vec3> const& normal)
+    double const power_of_ten_write[] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10};
+
+    // Same text as printf("%g") (6 significant digits, what std::ostream writes by default)
+    //  Integer arithmetic for the usual range of values [1e-4,1e6), snprintf otherwise
+    inline char* write_float(char* p, float value)
     {
-        std::ofstream stream(filename, std::ofstream::out);
-        assert_cgp(stream.is_open(), "Cannot open file " + str(filename));
-
-        for (int k = 0; k < position.size(); ++k)
-            stream << "v " << position[k].x << " " << position[k].y <<" " << position[k].z << std::endl;
-        for (int k = 0; k < normal.size(); ++k)
-            stream << "vn " << normal[k].x << " " << normal[k].y <<" " << normal[k].z << std::endl;
-
-        for (int k = 0; k < position.size()/3; k++) {
-            std::string const u0 = str(3*k+1);
-            std::string const u1 = str(3*k+2);
-            std::string const u2 = str(3*k+3);
-            std::string const f0 = u0 + "//" + u0;
-            std::string const f1 = u1 + "//" + u1;
-            std::string const f2 = u2 + "//" + u2;
-
-            stream << "f " << f0 << " " << f1 << " " << f2 << std::endl;
+        double const v = std::abs(double(value));
+        if(v==0) {
+            if(std::signbit(value)) *p++ = '-';
+            *p++ = '0';
+            return p;
+        }
+        if(!(v>=1e-4 && v<1e6)) {
+            return p + std::snprintf(p, 32, "%g", double(value));
         }
 
-        stream.close();
-    }
+        int exponent = 0; // floor(log10(v))
+        if(v>=1) { while(exponent<5 && v>=power_of_ten_write[exponent+1]) ++exponent; }
+        else { exponent = -1; while(v<1/power_of_ten_write[-exponent]) --exponent; }
 
+        int decimals = 5-exponent;
+        uint64_t digits = uint64_t(std::nearbyint(v*power_of_ten_write[decimals]));
+        if(digits>=1000000) { // rounding reached the next power of 10
+            if(exponent==5) return p + std::snprintf(p, 32, "%g", double(value));
+            decimals--;
+            digits = uint64_t(std::nearbyint(v*power_of_ten_write[decimals]));
+        }
 
-// Comparator of triplet of integer for std::map
-struct comparator_int3 {
-    long int N; // number of vertices
+        // Remove the trailing zeros of the fractional part
+        while(decimals>0 && digits%10==0) { digits /= 10; decimals--; }
+
+        if(value<0) *p++ = '-';
+        uint64_t const scale = uint64_t(power_of_ten_write[decimals]);
+        p = write_uint(p, (unsigned int)(digits/scale));
+        if(decimals>0) {
+            *p++ = '.';
+            uint64_t fraction = digits%scale;
+            for(int k=decimals-1; k>=0; --k) {
+                p[k] = char('0' + fraction%10);
+                fraction /= 10;
+            }
+            p += decimals;
+        }
+        return p;
+    }
 
-    comparator_int3(int N_arg=0) :N(N_arg) {}
+    // Write count lines formatted by format_line(k, p) -> end. Blocks of lines are formatted in parallel into buffers reused
+    //  from one block to the next (one per chunk of the block, shared by reference with the tasks), and written in order.
+    //  max_line_size bounds the size of a line.
+    template <typename F>
+    void write_lines(std::FILE* file, int count, int max_line_size, F const& format_line)
+    {
+        int const lines_per_chunk = 1<<14;
+        int const chunks_per_block = std::max(1, 2*parallel_thread_count());
+
+        std::vector<std::vector<char> > buffers(chunks_per_block);
+        std::vector<size_t> size(chunks_per_block);
+
+        for(int block_start=0; block_start<count; block_start += lines_per_chunk*chunks_per_block) {
+            int const block_lines = std::min(count-block_start, lines_per_chunk*chunks_per_block);
+            int const N_chunk = (block_lines+lines_per_chunk-1)/lines_per_chunk;
+
+            parallel_for(0, N_chunk, [&](int c) {
+                std::vector<char>& buffer = buffers[c];
+                buffer.resize(size_t(lines_per_chunk)*max_line_size);
+                int const first = block_start + c*lines_per_chunk;
+                int const last = std::min(block_start+block_lines, first+lines_per_chunk);
+                char* p = buffer.data();
+                for(int k=first; k<last; ++k)
+                    p = format_line(k, p);
+                size[c] = p-buffer.data();
+            }, 1);
+
+            for(int c=0; c<N_chunk; ++c)
+                std::fwrite(buffers[c].data(), 1, size[c], file);
+        }
+    }
 
-    // compute a<b
-    bool operator()(int3 const& a, int3 const& b) const
+    inline char* write_vec3_line(char* p, char const* prefix, vec3 const& v)
     {
-        long int const offset_a = long(a[0]) + N*(long(a[1]) + N*long(a[2]));
-        long int const offset_b = long(b[0]) + N*(long(b[1]) + N*long(b[2]));
-        return offset_a < offset_b;
+        p = write_text(p, prefix);
+        p = write_float(p, v.x); *p++ = ' ';
+        p = write_float(p, v.y); *p++ = ' ';
+        p = write_float(p, v.z); *p++ = '\n';
+        return p;
     }
-};
 
+    // Corner of a face using the same index for the position and the given attributes: a, a/a, a//a or a/a/a
+    inline char* write_corner(char* p, unsigned int index, bool uv, bool normal)
+    {
+        p = write_uint(p, index);
+        if(uv || normal) {
+            *p++ = '/';
+            if(uv) p = write_uint(p, index);
+            if(normal) { *p++ = '/'; p = write_uint(p, index); }
+        }
+        return p;
+    }
 
-static buffer<buffer_stack<int3,3>> triangulate_faces(buffer<buffer<int3>> faces);
+    inline char* write_face_line(char* p, uint3 const& f, bool uv, bool normal)
+    {
+        p = write_text(p, "f ");
+        p = write_corner(p, f[0]+1, uv, normal); *p++ = ' ';
+        p = write_corner(p, f[1]+1, uv, normal); *p++ = ' ';
+        p = write_corner(p, f[2]+1, uv, normal); *p++ = '\n';
+        return p;
+    }
 
+    std::FILE* open_obj_for_writing(std::string const& filename)
+    {
+        std::FILE* file = std::fopen(filename.c_str(), "wb");
+        if(file==nullptr)
+            error_cgp("Cannot open file " + str(filename));
+        return file;
+    }
 
-static std::pair<mesh, std::map<int3, int, comparator_int3>>
-    make_unique_parameter_per_value(buffer<vec3> const& positions,
-                                    buffer<vec2> const& texture_uv,
-                                    buffer<vec3> const& normals,
-                                    buffer<buffer_stack<int3,3>> const& faces,
-                                    loader::obj_type const type);
+    void close_obj(std::FILE* file, std::string const& filename)
+    {
+        bool const ok = std::ferror(file)==0;
+        std::fclose(file);
+        if(!ok)
+            error_cgp("Cannot write file " + str(filename));
+    }
+}
 
+    void mesh_save_file_obj(std::string const& filename, mesh const& m)
+    {
+        std::FILE* file = open_obj_for_writing(filename);
+
+        int const N = m.position.size();
+        bool const has_uv = m.uv.size()==N && N>0;
+        bool const has_normal = m.normal.size()==N && N>0;
+
+        write_lines(file, N, 64, [&](int k, char* p) { return write_vec3_line(p, "v ", m.position[k]); });
+        if(has_uv)
+            write_lines(file, N, 64, [&](int k, char* p) {
+                p = write_text(p, "vt ");
+                p = write_float(p, m.uv[k].x); *p++ = ' ';
+                p = write_float(p, m.uv[k].y); *p++ = '\n';
+                return p;
+            });
+        if(has_normal)
+            write_lines(file, N, 64, [&](int k, char* p) { return write_vec3_line(p, "vn ", m.normal[k]); });
+        write_lines(file, m.connectivity.size(), 128, [&](int k, char* p) { return write_face_line(p, m.connectivity[k], has_uv, has_normal); });
+
+        close_obj(file, filename);
+    }
 
-mesh mesh_load_file_obj(const std::string& filename)
-{
-     buffer<buffer<int>> vertex_correspondance;
-     mesh m = mesh_load_file_obj(filename, vertex_correspondance);
-     m.fill_empty_field();
-     return m;
-}
-mesh mesh_load_file_obj(const std::string& filename, buffer<buffer<int> >& vertex_correspondance)
-{
-    assert_file_exist(filename);
+    void save_file_obj(std::string const& filename, mesh const& m)
+    {
+        mesh_save_file_obj(filename, m);
+    }
 
-    // Load parameters
-    buffer<vec3> positions = loader::obj_read_positions(filename);
-    buffer<vec2> texture_uv = loader::obj_read_texture_uv(filename);
-    buffer<vec3> normals = loader::obj_read_normals(filename);
+    void save_file_obj(std::string const& filename, std::vector<vec3> const& position, std::vector<vec3> const& normal)
+    {
+        std::FILE* file = open_obj_for_writing(filename);
 
-    assert_cgp(positions.size()>0, str("File ")+filename+" has 0 vertices");
+        int const N = int(position.size());
+        bool const has_normal = normal.size()==position.size() && N>0;
 
-    // set obj type
-    loader::obj_type type = loader::obj_type::vertex;
-    if(texture_uv.size()>0 && normals.size()>0)
-        type = loader::obj_type::vertex_texture_normal;
-    else if( texture_uv.size()>0 )
-        type = loader::obj_type::vertex_texture;
-    else if( normals.size()>0 )
-        type = loader::obj_type::vertex_normal;
+        write_lines(file, N, 64, [&](int k, char* p) { return write_vec3_line(p, "v ", position[k]); });
+        if(has_normal)
+            write_lines(file, N, 64, [&](int k, char* p) { return write_vec3_line(p, "vn ", normal[k]); });
+        write_lines(file, N/3, 128, [&](int k, char* p) {
+            unsigned int const i = 3*k;
+            return write_face_line(p, uint3{i, i+1, i+2}, false, has_normal);
+        });
 
-    // Load connectivity and triangulate
-    buffer<buffer_stack<int3,3>> faces = triangulate_faces( loader::obj_read_faces(filename, type) );
+        close_obj(file, filename);
+    }
 
-    // Set unique per-vertex value for texture and normals (duplicate vertices if necessary)
-    mesh m;
-    std::map<int3, int, comparator_int3> connectivity_map;
-    std::tie(m,connectivity_map) = make_unique_parameter_per_value(positions, texture_uv, normals, faces, type);
 
-    // Retrieve correspondance between initial vertices in files and new ones
-    vertex_correspondance.resize(positions.size());
-    for(auto const& it : connectivity_map)
-    {
-        int const vertex_in = it.first[0];
-        int const vertex_out = it.second;
+namespace loader {
 
-        vertex_correspondance[vertex_in].push_back(vertex_out);
-    }
+// Text parsing on the mapped file: the text is not null terminated, every read is bounded by end
+namespace {
 
-    return m;
-}
+    inline bool is_blank(char c) { return c==' ' || c=='\t' || c=='\r'; }
 
+    inline char const* skip_blank(char const* p, char const* end)
+    {
+        while(p<end && is_blank(*p)) ++p;
+        return p;
+    }
 
-buffer<buffer_stack<int3,3>> triangulate_faces(buffer<buffer<int3>> faces)
-{
-    buffer<buffer_stack<int3,3>> faces_triangulation;
-    size_t const N_face = faces.size();
-    for(size_t k_face=0; k_face<N_face; ++k_face)
+    inline char const* skip_line(char const* p, char const* end)
     {
-        buffer<int3> const& current_polygon = faces[k_face];
-        int const N_polygon = int(current_polygon.size());
+        while(p<end && *p!='\n') ++p;
+        return p<end ? p+1 : end;
+    }
 
-        for(int k=0; k<N_polygon-2; ++k) {
-            // triangulation
-            int3 const& f0 = current_polygon[0];
-            int3 const& f1 = current_polygon[k+1];
-            int3 const& f2 = current_polygon[k+2];
+    // Exact powers of 10 representable as double
+    double const power_of_ten[] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
 
-            faces_triangulation.push_back({f0,f1,f2});
+    // Decimal float without locale: [sign] digits [. digits] [e [sign] digits]
+    //  Falls back to strtod for other spellings (inf, nan, hexadecimal) and mantissas longer than 19 digits
+    char const* parse_float(char const* p, char const* end, float& value)
+    {
+        p = skip_blank(p, end);
+        char const* const start = p;
+
+        bool negative = false;
+        if(p<end && (*p=='-' || *p=='+')) { negative = (*p=='-'); ++p; }
+
+        uint64_t mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+        while(p<end && *p>='0' && *p<='9') { if(digits<19) {mantissa = 10*mantissa + (*p-'0'); ++digits;} else ++exponent; ++p; }
+        if(p<end && *p=='.') {
+            ++p;
+            while(p<end && *p>='0' && *p<='9') { if(digits<19) {mantissa = 10*mantissa + (*p-'0'); ++digits; --exponent;} ++p; }
+        }
+        if(p<end && (*p=='e' || *p=='E')) {
+            ++p;
+            bool negative_exponent = false;
+            if(p<end && (*p=='-' || *p=='+')) { negative_exponent = (*p=='-'); ++p; }
+            int e = 0;
+            while(p<end && *p>='0' && *p<='9') { if(e<10000) e = 10*e + (*p-'0'); ++p; }
+            exponent += negative_exponent ? -e : e;
         }
-    }
-    return faces_triangulation;
-}
 
-std::pair<mesh, std::map<int3, int, comparator_int3>>
-    make_unique_parameter_per_value(buffer<vec3> const& positions,
-                                    buffer<vec2> const& texture_uv,
-                                    buffer<vec3> const& normals,
-                                    buffer<buffer_stack<int3,3>> const& faces,
-                                    loader::obj_type const type)
-{
-    mesh m;
-    comparator_int3 comparator(int(positions.size()));
-    std::map<int3, int, comparator_int3> connectivity_map(comparator); // stores map between original face index and final offset
+        bool const simple = (p==end || is_blank(*p) || *p=='\n') && p>start;
+        if(simple && digits<=19 && exponent>=-22 && exponent<=22) {
+            double const m = double(mantissa);
+            double const v = exponent<0 ? m/power_of_ten[-exponent] : m*power_of_ten[exponent];
+            value = float(negative ? -v : v);
+            return p;
+        }
 
+        // Rare cases: copy the token to have a null terminated string
+        char token[64];
+        size_t length = 0;
+        for(char const* q=start; q<end && !is_blank(*q) && *q!='\n' && length<63; ++q)
+            token[length++] = *q;
+        token[length] = '\0';
+        char* token_end = nullptr;
+        value = float(std::strtod(token, &token_end));
+        return start + (token_end-token);
+    }
 
-    size_t const N_triangle = faces.size();
-    for(size_t k_triangle=0; k_triangle<N_triangle; ++k_triangle)
+    char const* parse_int(char const* p, char const* end, int& value, bool& valid)
     {
-        buffer_stack<int3,3> const& tri = faces[k_triangle];
-        uint3 new_triangle_index;
-        for(int k=0; k<3; ++k)
-        {
-            int3 const& index = tri[k];
-            auto const it = connectivity_map.find( index );
-            if( it==connectivity_map.end() ) {
+        bool negative = false;
+        if(p<end && (*p=='-' || *p=='+')) { negative = (*p=='-'); ++p; }
+        char const* const digits = p;
+        long v = 0;
+        while(p<end && *p>='0' && *p<='9') { v = 10*v + (*p-'0'); ++p; }
+        valid = p>digits;
+        value = int(negative ? -v : v);
+        return p;
+    }
 
-                size_t const offset = m.position.size();
-                connectivity_map[index] = int(offset);
-                new_triangle_index[k] = int(offset);
+    // Result of the parsing of a range of lines
+    struct obj_chunk {
+        obj_data data;
+        std::vector<std::pair<size_t,int> > relative; // (3*corner + attribute) of the negative (relative) indices, stored relative to the chunk counts
+    };
 
-                int const idx_position = index[0];
+    void parse_chunk(char const* p, char const* end, obj_chunk& chunk)
+    {
+        obj_data& data = chunk.data;
+        data.face_start.push_back(0);
+
+        while(p<end) {
+            p = skip_blank(p, end);
+            if(p>=end) break;
+
+            char const c0 = *p;
+            char const c1 = p+1<end ? p[1] : '\n';
+            if(c0=='v' && is_blank(c1)) {
+                vec3 v;
+                p = parse_float(p+1, end, v.x);
+                p = parse_float(p, end, v.y);
+                p = parse_float(p, end, v.z);
+                data.positions.push_back(v);
+            }
+            else if(c0=='v' && c1=='t') {
+                vec2 uv;
+                p = parse_float(p+2, end, uv.x);
+                p = parse_float(p, end, uv.y);
+                data.uv.push_back(uv);
+            }
+            else if(c0=='v' && c1=='n') {
+                vec3 n;
+                p = parse_float(p+2, end, n.x);
+                p = parse_float(p, end, n.y);
+                p = parse_float(p, end, n.z);
+                data.normals.push_back(n);
+            }
+            else if(c0=='f' && is_blank(c1)) {
+                p += 1;
+                int const counts[3] = {int(data.positions.size()), int(data.uv.size()), int(data.normals.size())};
+                while(true) {
+                    p = skip_blank(p, end);
+                    if(p>=end || *p=='\n' || *p=='#') break;
+
+                    // v, v/t, v//n or v/t/n
+                    int3 corner = {-1,-1,-1};
+                    for(int a=0; a<3; ++a) {
+                        int value; bool valid;
+                        p = parse_int(p, end, value, valid);
+                        if(valid && value>0)
+                            corner[a] = value-1;
+                        else if(valid && value<0) {
+                            corner[a] = counts[a]+value;
+                            chunk.relative.push_back(std::make_pair(3*data.corners.size()+a, a));
+                        }
+                        if(a<2 && p<end && *p=='/') ++p;
+                        else break;
+                    }
+                    // Skip anything unexpected in the token
+                    while(p<end && !is_blank(*p) && *p!='\n') ++p;
+                    data.corners.push_back(corner);
+                }
+                data.face_start.push_back(int(data.corners.size()));
+            }
+            p = skip_line(p, end);
+        }
+    }
 
-                assert_cgp_no_msg( idx_position<int(positions.size()));
-                m.position.push_back( positions[idx_position] );
+    // Open-addressing hash table from (position,uv,normal) indices to the vertex index in the mesh
+    struct corner_table {
+        struct entry { int3 key; int value; };
+        std::vector<entry> entries;
+        size_t mask;
 
-                if(type==loader::obj_type::vertex_texture_normal || type==loader::obj_type::vertex_texture) {
-                    int const idx_uv = index[1];
-                    assert_cgp_no_msg( idx_uv<int(texture_uv.size()) );
-                    m.uv.push_back( texture_uv[ idx_uv ] );
-                }
-                if(type==loader::obj_type::vertex_texture_normal || type==loader::obj_type::vertex_normal) {
-                    int const idx_normal = index[2];
-                    assert_cgp_no_msg( idx_normal<int(normals.size()) );
-                    m.normal.push_back( normals[index[2]] );
-                }
+        explicit corner_table(size_t expected)
+        {
+            size_t capacity = 16;
+            while(capacity < 2*expected) capacity *= 2;
+            entries.assign(capacity, {{0,0,0},-1});
+            mask = capacity-1;
+        }
 
+        // Return the value associated to the key, or insert the candidate value
+        int find_or_insert(int3 const& key, int candidate)
+        {
+            uint64_t h = uint64_t(uint32_t(key[0]))*0x9E3779B97F4A7C15ull ^ uint64_t(uint32_t(key[1]))*0xC2B2AE3D27D4EB4Full ^ uint64_t(uint32_t(key[2]))*0x165667B19E3779F9ull;
+            h ^= h>>29;
+            for(size_t i = size_t(h) & mask; ; i = (i+1) & mask) {
+                entry& e = entries[i];
+                if(e.value==-1) { e.key = key; e.value = candidate; return candidate; }
+                if(e.key[0]==key[0] && e.key[1]==key[1] && e.key[2]==key[2]) return e.value;
             }
-            else
-                new_triangle_index[k] = it->second;
         }
-        m.connectivity.push_back(new_triangle_index);
+    };
+}
+
+bool obj_parse(std::string const& filename, obj_data& data)
+{
+    data = obj_data();
+
+    mapped_file file;
+    if(!file.open(filename))
+        return false;
+    char const* const text = file.data();
+    size_t const size = file.size();
+
+    // Chunks of about 4MB cut at line boundaries, parsed in parallel
+    size_t const chunk_size = size_t(4)<<20;
+    std::vector<size_t> cut = {0};
+    while(cut.back() < size) {
+        size_t next = std::min(size, cut.back()+chunk_size);
+        while(next<size && text[next-1]!='\n') ++next;
+        cut.push_back(next);
+    }
+    int const N_chunk = int(cut.size())-1;
+    std::vector<obj_chunk> chunks(N_chunk);
+    parallel_for(0, N_chunk, [&](int k) { parse_chunk(text+cut[k], text+cut[k+1], chunks[k]); }, 1);
+
+    // Offsets of each chunk in the concatenated arrays
+    std::vector<size_t> offset_position(N_chunk+1,0), offset_uv(N_chunk+1,0), offset_normal(N_chunk+1,0), offset_corner(N_chunk+1,0), offset_face(N_chunk+1,0);
+    for(int k=0; k<N_chunk; ++k) {
+        obj_data const& d = chunks[k].data;
+        offset_position[k+1] = offset_position[k] + d.positions.size();
+        offset_uv[k+1] = offset_uv[k] + d.uv.size();
+        offset_normal[k+1] = offset_normal[k] + d.normals.size();
+        offset_corner[k+1] = offset_corner[k] + d.corners.size();
+        offset_face[k+1] = offset_face[k] + d.face_start.size()-1;
     }
 
-    return {m, connectivity_map};
+    data.positions.resize(offset_position[N_chunk]);
+    data.uv.resize(offset_uv[N_chunk]);
+    data.normals.resize(offset_normal[N_chunk]);
+    data.corners.resize(offset_corner[N_chunk]);
+    data.face_start.resize(offset_face[N_chunk]+1);
+    data.face_start[offset_face[N_chunk]] = int(offset_corner[N_chunk]);
+
+    parallel_for(0, N_chunk, [&](int k) {
+        obj_chunk& c = chunks[k];
+        std::copy(c.data.positions.begin(), c.data.positions.end(), data.positions.begin()+offset_position[k]);
+        std::copy(c.data.uv.begin(), c.data.uv.end(), data.uv.begin()+offset_uv[k]);
+        std::copy(c.data.normals.begin(), c.data.normals.end(), data.normals.begin()+offset_normal[k]);
+
+        // Relative indices are shifted by the number of elements defined in the previous chunks
+        size_t const offsets[3] = {offset_position[k], offset_uv[k], offset_normal[k]};
+        for(auto const& r : c.relative)
+            c.data.corners[r.first/3][int(r.first%3)] += int(offsets[r.second]);
+        std::copy(c.data.corners.begin(), c.data.corners.end(), data.corners.begin()+offset_corner[k]);
+
+        for(size_t f=0; f+1<c.data.face_start.size(); ++f)
+            data.face_start[offset_face[k]+f] = int(offset_corner[k]) + c.data.face_start[f];
+    }, 1);
+
+    return true;
 }
 
-
-namespace loader{
 std::vector<vec3> obj_read_positions(const std::string& filename)
 {
     assert_file_exist(filename);
-    std::vector<vec3> positions;
-
-    std::ifstream stream(filename);
-    assert_cgp(stream.is_open(), "Cannot open file "+str(filename));
-    while(stream.good()) {
-        std::string buffer;
-        std::getline(stream,buffer);
-        if( buffer.size()>0 )
-        {
-            std::stringstream tokens_buffer(buffer);
-            std::string first_word;
-            tokens_buffer >> first_word;
-            if( first_word.size()>0 && first_word[0]!='#' ) {
-                if( first_word=="v" ) {
-                    vec3 p;
-                    tokens_buffer >> p.x >> p.y >> p.z;
-                    positions.push_back(p);
-                }
-            }
-        }
-    }
-    stream.close();
-    assert_cgp(!stream.is_open(), "Cannot close file "+str(filename));
-    return positions;
+    obj_data data;
+    if(!obj_parse(filename, data))
+        error_cgp("Cannot open file "+str(filename));
+    return data.positions;
 }
 
 std::vector<vec3> obj_read_normals(const std::string& filename)
 {
     assert_file_exist(filename);
-    std::vector<vec3> normals;
-
-    std::ifstream stream(filename);
-    assert_cgp(stream.is_open(), "Cannot open file "+str(filename));
-    while(stream.good()) {
-        std::string buffer;
-        std::getline(stream,buffer);
-        if( buffer.size()>0 )
-        {
-            std::stringstream tokens_buffer(buffer);
-            std::string first_word;
-            tokens_buffer >> first_word;
-            if( first_word.size()>0 && first_word[0]!='#' ) {
-                if( first_word=="vn" ) {
-                    vec3 n;
-                    tokens_buffer >> n.x >> n.y >> n.z;
-                    normals.push_back(n);
-                }
-            }
-        }
-    }
-    stream.close();
-    assert_cgp(!stream.is_open(), "Cannot close file "+str(filename));
-    return normals;
+    obj_data data;
+    if(!obj_parse(filename, data))
+        error_cgp("Cannot open file "+str(filename));
+    return data.normals;
 }
 
 std::vector<vec2> obj_read_texture_uv(const std::string& filename)
 {
     assert_file_exist(filename);
-    std::vector<vec2> texture_uv;
-
-    std::ifstream stream(filename);
-    assert_cgp(stream.is_open(), "Cannot open file "+str(filename));
-    while(stream.good()) {
-        std::string buffer;
-        std::getline(stream,buffer);
-        if( buffer.size()>0 )
-        {
-            std::stringstream tokens_buffer(buffer);
-            std::string first_word;
-            tokens_buffer >> first_word;
-            if( first_word.size()>0 && first_word[0]!='#' ) {
-                if( first_word=="vt" ) {
-                    vec2 uv;
-                    tokens_buffer >> uv.x >> uv.y;
-                    texture_uv.push_back( {uv.x, uv.y} );
-                }
-            }
-        }
-    }
-    stream.close();
-    assert_cgp(!stream.is_open(), "Cannot close file "+str(filename));
-    return texture_uv;
+    obj_data data;
+    if(!obj_parse(filename, data))
+        error_cgp("Cannot open file "+str(filename));
+    return data.uv;
 }
 
-
 std::vector<uint3> obj_read_connectivity(const std::string& filename)
 {
     assert_file_exist(filename);
+    obj_data data;
+    if(!obj_parse(filename, data))
+        error_cgp("Cannot open file "+str(filename));
 
+    // Polygons are triangulated as a fan
     std::vector<uint3> connectivity;
+    for(size_t f=0; f+1<data.face_start.size(); ++f)
+        for(int k=data.face_start[f]+1; k+1<data.face_start[f+1]; ++k)
+            connectivity.push_back(uint3(data.corners[data.face_start[f]][0], data.corners[k][0], data.corners[k+1][0]));
+    return connectivity;
+}
 
-    // Open file
-    std::ifstream stream(filename);
-    assert_cgp(stream.is_open(), "Cannot open file "+str(filename));
-
-
-    while(stream.good())
-    {
-        std::string buffer;
-        std::getline(stream,buffer);
+// Index components that are not part of the type are set to -1
+static int3 obj_mask_corner(int3 corner, obj_type const type)
+{
+    if(type==obj_type::vertex || type==obj_type::vertex_normal)
+        corner[1] = -1;
+    if(type==obj_type::vertex || type==obj_type::vertex_texture)
+        corner[2] = -1;
+    return corner;
+}
 
-        if( buffer.size()>0 )
-        {
-            std::stringstream tokens_buffer(buffer);
-            std::string first_word;
-            tokens_buffer >> first_word;
-
-            if( first_word.size()>0 && first_word[0]!='#' )
-            {
-                if(first_word=="f")
-                {
-                    std::array<std::string,3> s;
-                    tokens_buffer >> s[0] >> s[1] >> s[2];
-
-                    uint3 f;
-                    for(int k=0; k<3; ++k)
-                        f[k] = std::stoi(s[k])-1;
-
-                    connectivity.push_back(f);
-                }
-            }
-        }
-    }
+buffer<buffer<int3>> obj_read_faces(const std::string& filename, obj_type const type)
+{
+    assert_file_exist(filename);
+    obj_data data;
+    if(!obj_parse(filename, data))
+        error_cgp("Cannot open file "+str(filename));
+
+    int const N_face = int(data.face_start.size())-1;
+    buffer<buffer<int3>> faces(N_face);
+    parallel_for(0, N_face, [&](int f) {
+        for(int k=data.face_start[f]; k<data.face_start[f+1]; ++k)
+            faces[f].push_back(obj_mask_corner(data.corners[k], type));
+    });
+    return faces;
+}
 
+}
 
 
-    stream.close();
-    assert_cgp(!stream.is_open(), "Cannot close file "+str(filename));
+namespace {
+    bool obj_binary_cache_enabled = true;
+}
 
-    return connectivity;
+void obj_set_binary_cache(bool enabled)
+{
+    obj_binary_cache_enabled = enabled;
 }
 
-int3 extract_face_index(std::string const& word, obj_type const type)
+bool obj_binary_cache()
 {
-    int3 indices = {0,0,0};
+    return obj_binary_cache_enabled;
+}
 
+mesh mesh_load_file_obj(const std::string& filename)
+{
+    assert_file_exist(filename);
 
-    if(type == obj_type::vertex)
-        sscanf(word.c_str(), "%d", &indices[0]);
-    else if( type==obj_type::vertex_texture )
-        sscanf(word.c_str(), "%d/%d", &indices[0], &indices[1]);
-    else if( type==obj_type::vertex_normal )
-        sscanf(word.c_str(), "%d//%d", &indices[0], &indices[2]);
-    else if( type==obj_type::vertex_texture_normal )
-        sscanf(word.c_str(), "%d/%d/%d", &indices[0], &indices[1], &indices[2]);
+    // Sidecar binary file, used as long as the obj file keeps the same size and modification time
+    std::string const cache = filename + ".cgpmesh";
+    loader::mesh_binary_stamp const stamp = loader::mesh_binary_file_stamp(filename);
 
-    for(int k=0; k<3; ++k)
-        indices[k]--;    // obj indices starts at 1
+    mesh m;
+    if(obj_binary_cache_enabled && loader::mesh_binary_read(cache, m, &stamp))
+        return m;
 
-    return indices;
+    buffer<buffer<int>> vertex_correspondance;
+    m = mesh_load_file_obj(filename, vertex_correspondance);
+    m.fill_empty_field();
 
+    if(obj_binary_cache_enabled)
+        loader::mesh_binary_write(cache, m, stamp); // the cache is optional: a read-only directory is not an error
+    return m;
 }
-
-
-buffer<buffer<int3>> obj_read_faces(const std::string& filename, obj_type const type)
+mesh mesh_load_file_obj(const std::string& filename, buffer<buffer<int> >& vertex_correspondance)
 {
     assert_file_exist(filename);
-    buffer<buffer<int3>> faces;
-
-    std::ifstream stream(filename);
-    assert_cgp(stream.is_open(), "Cannot open file "+str(filename));
-    while(stream.good()) {
-        std::string buffer;
-        std::getline(stream,buffer);
-        if( buffer.size()>0 )
-        {
-            std::stringstream tokens_buffer(buffer);
-            std::string first_word;
-            tokens_buffer >> first_word;
-            if( first_word.size()>0 && first_word[0]!='#' ) {
-                if( first_word=="f" ) {
-
-                    std::string word;
-                    cgp::buffer<int3> current_face;
-                    while(tokens_buffer) {
-                        tokens_buffer >> word;
-
-                        if(tokens_buffer){
-                            int3 face_index = extract_face_index(word, type);
-                            current_face.push_back(face_index);
-                        }
-                    }
-                    faces.push_back(current_face);
 
-                }
-            }
-        }
+    loader::obj_data data;
+    if(!loader::obj_parse(filename, data))
+        error_cgp("Cannot open file "+str(filename));
+    assert_cgp(data.positions.size()>0, str("File ")+filename+" has 0 vertices");
+
+    // set obj type
+    loader::obj_type type = loader::obj_type::vertex;
+    if(data.uv.size()>0 && data.normals.size()>0)
+        type = loader::obj_type::vertex_texture_normal;
+    else if( data.uv.size()>0 )
+        type = loader::obj_type::vertex_texture;
+    else if( data.normals.size()>0 )
+        type = loader::obj_type::vertex_normal;
+    bool const has_uv = type==loader::obj_type::vertex_texture_normal || type==loader::obj_type::vertex_texture;
+    bool const has_normal = type==loader::obj_type::vertex_texture_normal || type==loader::obj_type::vertex_normal;
+
+    int const N_position = int(data.positions.size());
+    int const N_uv = int(data.uv.size());
+    int const N_normal = int(data.normals.size());
+
+    // Triangulate the polygons as fans and set unique per-vertex value for texture and normals (duplicate vertices if necessary)
+    //  Vertices are numbered in their order of appearance in the faces
+    mesh m;
+    std::vector<int3> unique_corner;
+    loader::corner_table table(data.corners.size());
+    std::vector<int> vertex_of_corner(data.corners.size());
+    for(size_t k=0; k<data.corners.size(); ++k) {
+        int3 const corner = loader::obj_mask_corner(data.corners[k], type);
+        assert_cgp(corner[0]>=0 && corner[0]<N_position, "Invalid vertex index in file "+str(filename));
+        int const index = table.find_or_insert(corner, int(unique_corner.size()));
+        if(index==int(unique_corner.size()))
+            unique_corner.push_back(corner);
+        vertex_of_corner[k] = index;
     }
-    stream.close();
-    assert_cgp(!stream.is_open(), "Cannot close file "+str(filename));
 
-    return faces;
-}
+    int const N_vertex = int(unique_corner.size());
+    m.position.resize(N_vertex);
+    if(has_uv) m.uv.resize(N_vertex);
+    if(has_normal) m.normal.resize(N_vertex);
+    parallel_for(0, N_vertex, [&](int v) {
+        int3 const& c = unique_corner[v];
+        m.position[v] = data.positions[c[0]];
+        if(has_uv) m.uv[v] = (c[1]>=0 && c[1]<N_uv) ? data.uv[c[1]] : vec2{0,0};
+        if(has_normal) m.normal[v] = (c[2]>=0 && c[2]<N_normal) ? data.normals[c[2]] : vec3{0,0,1};
+    });
+
+    for(size_t f=0; f+1<data.face_start.size(); ++f) {
+        int const first = data.face_start[f];
+        for(int k=first+1; k+1<data.face_start[f+1]; ++k)
+            m.connectivity.push_back(uint3(vertex_of_corner[first], vertex_of_corner[k], vertex_of_corner[k+1]));
+    }
 
+    // Retrieve correspondance between initial vertices in files and new ones
+    vertex_correspondance.clear();
+    vertex_correspondance.resize(N_position);
+    for(int v=0; v<N_vertex; ++v)
+        vertex_correspondance[unique_corner[v][0]].push_back(v);
 
+    return m;
 }
 
 }
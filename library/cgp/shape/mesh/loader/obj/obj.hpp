@@ -5,7 +5,12 @@
 namespace cgp
 {
     /** Save a mesh in .obj file
-    * Note that OBJ format doesn't stores per-vertex color */
+    * Notes:
+    *  - OBJ format doesn't stores per-vertex color
+    *  - Lines are formatted into large buffers (in parallel blocks using the thread pool) and written with few fwrite calls
+    *  - Values are written with 6 significant digits (same text as the default std::ostream formatting)
+    *  - uv and normal are written only if they have one element per vertex, faces reference them accordingly */
+    void mesh_save_file_obj(std::string const& filename, mesh const& m);
     void save_file_obj(std::string const& filename, mesh const& m);
 
 
@@ -14,10 +19,13 @@ namespace cgp
 
     /** Load a mesh stored as .obj in the filename.
     * Notes: 
+    *  - The file is memory mapped and parsed once, in parallel chunks (see loader::obj_parse)
     *  - Normals and UV are read, and vertices are duplicated if needed
     *  - .mtl files are not read with this loader (cannot read shading and color)
     *  - Only one mesh is loaded - this parser cannot be used when multiple textures are associated to different objects
     *  - The mesh is triangulated if higher degree polygons are in the file
+    *  - The result is stored in a binary sidecar file (filename.cgpmesh) which is loaded instead of parsing the obj on the next calls,
+    *    as long as the size and modification time of the obj file don't change (see obj_set_binary_cache)
     */
     mesh mesh_load_file_obj(std::string const& filename);
 
@@ -25,6 +33,10 @@ namespace cgp
     * Outputs the correspondance between the vertex index in the file, and the loaded one */
     mesh mesh_load_file_obj(std::string const& filename, buffer<buffer<int>>& vertex_correspondance);
 
+    /** Enable/disable the use of the binary sidecar file by mesh_load_file_obj(filename) (enabled by default) */
+    void obj_set_binary_cache(bool enabled);
+    bool obj_binary_cache();
+
 
 
 namespace loader{
@@ -36,6 +48,20 @@ namespace loader{
         vertex_normal          // f %d//%d %d//%d %d//%d
     };
 
+    /** Raw content of an obj file: the attributes and the polygons as read, before triangulation and vertex deduplication */
+    struct obj_data {
+        std::vector<vec3> positions;
+        std::vector<vec2> uv;
+        std::vector<vec3> normals;
+        std::vector<int3> corners;   // (position, uv, normal) indices of the polygon corners, starting at 0, -1 if not given
+        std::vector<int> face_start; // polygon k uses corners[face_start[k]] to corners[face_start[k+1]-1]
+    };
+
+    /** Read the v, vt, vn and f lines of an obj file in a single pass (other lines are ignored). Return false if the file cannot be opened.
+     * The file is memory mapped and cut in chunks of lines parsed in parallel, numbers are read without locale.
+     * Negative (relative) indices are converted to absolute ones. */
+    bool obj_parse(std::string const& filename, obj_data& data);
+
     /** Simple file reader of the position connectivity assuming triangles (doesn't handle texture and normal connectivity) */
     std::vector<uint3> obj_read_connectivity(const std::string& filename);
 
@@ -0,0 +1,153 @@
+#include "test_obj.hpp"
+
+#include "cgp/base/base.hpp"
+#include "../obj.hpp"
+#include "cgp/shape/mesh/primitive/mesh_primitive.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace cgp_test
+{
+    namespace {
+        void write_file(std::string const& filename, std::string const& content)
+        {
+            std::ofstream stream(filename, std::ios::binary);
+            stream.write(content.data(), content.size());
+        }
+
+        std::string read_file(std::string const& filename)
+        {
+            std::ifstream stream(filename, std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+        }
+    }
+
+    void test_obj()
+    {
+        using namespace cgp;
+        std::string const filename = "cgp_test_obj.obj";
+
+        // Mixed corner formats, absolute and relative indices, comments and CRLF line endings
+        {
+            write_file(filename,
+                "# quad and triangle\r\n"
+                "v 0 0 0\r\nv 1 0 0\r\nv 1 1 0\r\nv 0 1 0\r\n"
+                "vt 0 0\r\nvt 1 0\r\nvt 1 1\r\n"
+                "vn 0 0 1\r\n"
+                "\r\n"
+                "f 1/1/1 2/2/1 3/3/1 4/3/1\r\n"
+                "v 2 0 0\r\n"
+                "f -4//-1 -1//-1 -3//-1\r\n");
+
+            loader::obj_data data;
+            assert_cgp_no_msg(loader::obj_parse(filename, data));
+            assert_cgp_no_msg(data.positions.size()==5 && data.uv.size()==3 && data.normals.size()==1);
+            assert_cgp_no_msg(data.face_start.size()==3 && data.face_start[1]==4 && data.face_start[2]==7);
+            assert_cgp_no_msg(is_equal(data.corners[3], int3(3,2,0)));
+            assert_cgp_no_msg(is_equal(data.corners[4], int3(1,-1,0)));
+            assert_cgp_no_msg(is_equal(data.corners[5], int3(4,-1,0)));
+            assert_cgp_no_msg(is_equal(data.corners[6], int3(2,-1,0)));
+            assert_cgp_no_msg(is_equal(data.positions[4], vec3(2,0,0)));
+
+            std::vector<uint3> const connectivity = loader::obj_read_connectivity(filename);
+            assert_cgp_no_msg(connectivity.size()==3);
+            assert_cgp_no_msg(is_equal(connectivity[1], uint3(0,2,3)));
+            assert_cgp_no_msg(is_equal(connectivity[2], uint3(1,4,2)));
+
+            // Corners with different (position,uv,normal) are distinct vertices
+            buffer<buffer<int>> vertex_correspondance;
+            mesh const m = mesh_load_file_obj(filename, vertex_correspondance);
+            assert_cgp_no_msg(m.connectivity.size()==3);
+            assert_cgp_no_msg(m.position.size()==7);
+            assert_cgp_no_msg(vertex_correspondance.size()==5 && vertex_correspondance[0].size()==1 && vertex_correspondance[1].size()==2);
+        }
+
+        // Relative indices across the chunks parsed in parallel (file larger than a chunk)
+        {
+            int const N_quad = 100000;
+            std::ostringstream stream;
+            for(int k=0; k<N_quad; ++k) {
+                stream << "v " << k << " 0 0\nv " << k << " 1 0\nv " << k << " 1 1\nv " << k << " 0 1\n";
+                stream << "f -4 -3 -2 -1\n";
+            }
+            write_file(filename, stream.str());
+            assert_cgp_no_msg(stream.str().size() > (size_t(4)<<20));
+
+            loader::obj_data data;
+            assert_cgp_no_msg(loader::obj_parse(filename, data));
+            assert_cgp_no_msg(data.positions.size()==4*N_quad);
+            assert_cgp_no_msg(data.face_start.size()==N_quad+1);
+            bool coherent = true;
+            for(int f=0; f<N_quad; ++f) {
+                coherent = coherent && data.face_start[f]==4*f;
+                for(int k=0; k<4; ++k)
+                    coherent = coherent && data.corners[4*f+k][0]==4*f+k && data.positions[4*f+k].x==float(f);
+            }
+            assert_cgp_no_msg(coherent);
+        }
+
+        // Round trip through the writer: each triangle keeps its corner attributes (with 6 significant digits)
+        {
+            mesh const m = mesh_primitive_torus(1.0f, 0.3f, {0.5f,-2.0f,1e-3f}, {0,0,1}, 40, 20);
+            mesh_save_file_obj(filename, m);
+            buffer<buffer<int>> vertex_correspondance;
+            mesh const r = mesh_load_file_obj(filename, vertex_correspondance);
+
+            assert_cgp_no_msg(r.connectivity.size()==m.connectivity.size());
+            assert_cgp_no_msg(r.position.size()==m.position.size());
+            assert_cgp_no_msg(r.normal.size()==r.position.size() && r.uv.size()==r.position.size());
+            bool same = true;
+            for(int f=0; f<m.connectivity.size(); ++f) {
+                for(int k=0; k<3; ++k) {
+                    unsigned int const a = m.connectivity[f][k], b = r.connectivity[f][k];
+                    same = same && norm(m.position[a]-r.position[b])<1e-5f && norm(m.normal[a]-r.normal[b])<1e-5f && norm(m.uv[a]-r.uv[b])<1e-5f;
+                }
+            }
+            assert_cgp_no_msg(same);
+
+            // Positions only
+            mesh p;
+            p.position = m.position;
+            p.connectivity = m.connectivity;
+            mesh_save_file_obj(filename, p);
+            loader::obj_data data;
+            assert_cgp_no_msg(loader::obj_parse(filename, data));
+            assert_cgp_no_msg(data.positions.size()==m.position.size() && data.uv.size()==0 && data.normals.size()==0);
+            assert_cgp_no_msg(data.face_start.size()==m.connectivity.size()+1);
+            assert_cgp_no_msg(is_equal(data.corners[5], int3(m.connectivity[1][2],-1,-1)));
+        }
+
+        // Files of several chunks of lines are formatted in parallel and written in order
+        {
+            mesh const m = mesh_primitive_grid({0,0,0}, {1,0,0}, {1,1,0}, {0,1,0}, 200, 200);
+            int const thread_count = parallel_thread_count();
+
+            parallel_set_thread_count(1);
+            mesh_save_file_obj(filename, m);
+            std::string const serial = read_file(filename);
+
+            parallel_set_thread_count(4);
+            mesh_save_file_obj(filename, m);
+            std::string const parallel = read_file(filename);
+            parallel_set_thread_count(thread_count);
+
+            assert_cgp_no_msg(m.position.size() > (size_t(1)<<14));
+            assert_cgp_no_msg(parallel==serial);
+
+            buffer<buffer<int>> vertex_correspondance;
+            mesh const r = mesh_load_file_obj(filename, vertex_correspondance);
+            assert_cgp_no_msg(r.position.size()==m.position.size() && r.connectivity.size()==m.connectivity.size());
+        }
+
+        // Missing file
+        {
+            loader::obj_data data;
+            assert_cgp_no_msg(!loader::obj_parse("cgp_test_obj_missing.obj", data));
+        }
+
+        std::remove(filename.c_str());
+    }
+}
@@ -0,0 +1,711 @@
+#ifdef _WIN32
+#pragma warning( disable : 4996 )
+#endif
+
+#include "ply.hpp"
+
+#include "cgp/base/base.hpp"
+#include "cgp/files/files.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace cgp
+{
+
+namespace loader {
+
+    namespace {
+
+        size_t const ply_block_size = size_t(1) << 22; // bytes read or written at once
+
+        bool machine_is_little_endian()
+        {
+            uint32_t const value = 1;
+            char first;
+            std::memcpy(&first, &value, 1);
+            return first==1;
+        }
+
+        size_t type_size(ply_type type)
+        {
+            switch(type) {
+            case ply_type::int8: case ply_type::uint8: return 1;
+            case ply_type::int16: case ply_type::uint16: return 2;
+            case ply_type::int32: case ply_type::uint32: case ply_type::float32: return 4;
+            default: return 8;
+            }
+        }
+
+        bool parse_type(std::string const& name, ply_type& type)
+        {
+            if(name=="char" || name=="int8") type = ply_type::int8;
+            else if(name=="uchar" || name=="uint8") type = ply_type::uint8;
+            else if(name=="short" || name=="int16") type = ply_type::int16;
+            else if(name=="ushort" || name=="uint16") type = ply_type::uint16;
+            else if(name=="int" || name=="int32") type = ply_type::int32;
+            else if(name=="uint" || name=="uint32") type = ply_type::uint32;
+            else if(name=="float" || name=="float32") type = ply_type::float32;
+            else if(name=="double" || name=="float64") type = ply_type::float64;
+            else return false;
+            return true;
+        }
+
+        template <typename T, bool SWAP>
+        T load(char const* p)
+        {
+            T value;
+            if(SWAP) {
+                char bytes[sizeof(T)];
+                for(size_t k=0; k<sizeof(T); ++k)
+                    bytes[k] = p[sizeof(T)-1-k];
+                std::memcpy(&value, bytes, sizeof(T));
+            }
+            else
+                std::memcpy(&value, p, sizeof(T));
+            return value;
+        }
+
+        template <bool SWAP>
+        double load_value(char const* p, ply_type type)
+        {
+            switch(type) {
+            case ply_type::int8: return load<int8_t,SWAP>(p);
+            case ply_type::uint8: return load<uint8_t,SWAP>(p);
+            case ply_type::int16: return load<int16_t,SWAP>(p);
+            case ply_type::uint16: return load<uint16_t,SWAP>(p);
+            case ply_type::int32: return load<int32_t,SWAP>(p);
+            case ply_type::uint32: return load<uint32_t,SWAP>(p);
+            case ply_type::float32: return load<float,SWAP>(p);
+            default: return load<double,SWAP>(p);
+            }
+        }
+
+        double load_value(char const* p, ply_type type, bool swap)
+        {
+            return swap ? load_value<true>(p, type) : load_value<false>(p, type);
+        }
+
+        // Convert one property of N consecutive records into floats (output with a stride of out_stride floats).
+        //  The type is resolved once per call, the loop over the records is specialized for it.
+        //  Integer colors are divided by their maximal value (a division rather than a product by the inverse gives back exactly c/255)
+        template <typename T, bool SWAP>
+        void convert_column(char const* records, size_t record_size, size_t N, float divisor, float* out, size_t out_stride)
+        {
+            if(divisor==1.0f) {
+                for(size_t k=0; k<N; ++k)
+                    out[k*out_stride] = float(load<T,SWAP>(records+k*record_size));
+            }
+            else {
+                for(size_t k=0; k<N; ++k)
+                    out[k*out_stride] = float(load<T,SWAP>(records+k*record_size)) / divisor;
+            }
+        }
+
+        template <bool SWAP>
+        void convert_column(ply_type type, char const* records, size_t record_size, size_t N, float divisor, float* out, size_t out_stride)
+        {
+            switch(type) {
+            case ply_type::int8: convert_column<int8_t,SWAP>(records, record_size, N, divisor, out, out_stride); break;
+            case ply_type::uint8: convert_column<uint8_t,SWAP>(records, record_size, N, divisor, out, out_stride); break;
+            case ply_type::int16: convert_column<int16_t,SWAP>(records, record_size, N, divisor, out, out_stride); break;
+            case ply_type::uint16: convert_column<uint16_t,SWAP>(records, record_size, N, divisor, out, out_stride); break;
+            case ply_type::int32: convert_column<int32_t,SWAP>(records, record_size, N, divisor, out, out_stride); break;
+            case ply_type::uint32: convert_column<uint32_t,SWAP>(records, record_size, N, divisor, out, out_stride); break;
+            case ply_type::float32: convert_column<float,SWAP>(records, record_size, N, divisor, out, out_stride); break;
+            case ply_type::float64: convert_column<double,SWAP>(records, record_size, N, divisor, out, out_stride); break;
+            }
+        }
+
+        void convert_column(ply_type type, bool swap, char const* records, size_t record_size, size_t N, float divisor, float* out, size_t out_stride)
+        {
+            if(swap) convert_column<true>(type, records, record_size, N, divisor, out, out_stride);
+            else convert_column<false>(type, records, record_size, N, divisor, out, out_stride);
+        }
+
+        // Divisor of integer colors to get values in [0,1]
+        float color_divisor(ply_type type)
+        {
+            switch(type) {
+            case ply_type::uint8: return 255.0f;
+            case ply_type::uint16: return 65535.0f;
+            default: return 1.0f;
+            }
+        }
+
+        int find_property(ply_element const& e, char const* name)
+        {
+            for(size_t k=0; k<e.properties.size(); ++k)
+                if(!e.properties[k].is_list && e.properties[k].name==name)
+                    return int(k);
+            return -1;
+        }
+
+        // Byte offset of the property in a record, -1 if absent
+        int property_offset(ply_element const& e, int index, ply_type& type)
+        {
+            if(index<0)
+                return -1;
+            size_t offset = 0;
+            for(int k=0; k<index; ++k)
+                offset += type_size(e.properties[k].type);
+            type = e.properties[index].type;
+            return int(offset);
+        }
+
+        // Find the first triplet (or pair) of properties given as alternatives of names
+        bool find_properties(ply_element const& e, std::vector<std::vector<char const*> > const& names, int* offset, ply_type* type)
+        {
+            for(auto const& alternative : names) {
+                bool found = true;
+                for(size_t k=0; k<alternative.size() && found; ++k) {
+                    offset[k] = property_offset(e, find_property(e, alternative[k]), type[k]);
+                    found = offset[k]>=0;
+                }
+                if(found)
+                    return true;
+            }
+            for(size_t k=0; k<names[0].size(); ++k)
+                offset[k] = -1;
+            return false;
+        }
+
+        template <typename T>
+        void store(char*& p, T const& value)
+        {
+            std::memcpy(p, &value, sizeof(T));
+            p += sizeof(T);
+        }
+
+        // Reverse the bytes of each value of a block made of values of the given sizes repeated
+        void swap_bytes(char* p, size_t N, std::vector<size_t> const& sizes)
+        {
+            for(size_t k=0; k<N; ++k) {
+                for(size_t s : sizes) {
+                    std::reverse(p, p+s);
+                    p += s;
+                }
+            }
+        }
+    }
+
+
+    ply_reader::ply_reader()
+        :file(nullptr), swap(false), error(false), current(0), remaining(0), block_begin(0), block_end(0), vertex_element(-1), face_element(-1)
+    {}
+
+    ply_reader::~ply_reader()
+    {
+        close();
+    }
+
+    void ply_reader::close()
+    {
+        if(file!=nullptr)
+            std::fclose(file);
+        file = nullptr;
+        element.clear();
+        block.clear();
+        block.shrink_to_fit();
+        block_begin = block_end = 0;
+        current = 0;
+        remaining = 0;
+        error = false;
+        vertex_element = face_element = -1;
+    }
+
+    bool ply_reader::is_open() const { return file!=nullptr; }
+    bool ply_reader::failed() const { return error; }
+    std::vector<ply_element> const& ply_reader::elements() const { return element; }
+    uint64_t ply_reader::vertex_count() const { return vertex_element>=0 ? element[vertex_element].count : 0; }
+    uint64_t ply_reader::face_count() const { return face_element>=0 ? element[face_element].count : 0; }
+    bool ply_reader::has_normal() const { return normal_offset[0]>=0; }
+    bool ply_reader::has_color() const { return color_offset[0]>=0; }
+    bool ply_reader::has_uv() const { return uv_offset[0]>=0; }
+    bool ply_reader::faces_before_vertices() const { return face_element>=0 && face_element<vertex_element; }
+
+    bool ply_reader::fill(size_t size)
+    {
+        if(block_end-block_begin >= size)
+            return true;
+
+        // Move the unread data at the beginning of the block and complete it from the file
+        size_t const left = block_end-block_begin;
+        std::memmove(block.data(), block.data()+block_begin, left);
+        if(block.size() < std::max(size, ply_block_size))
+            block.resize(std::max(size, ply_block_size));
+        block_begin = 0;
+        block_end = left + std::fread(block.data()+left, 1, block.size()-left, file);
+
+        if(block_end < size)
+            error = true;
+        return !error;
+    }
+
+    bool ply_reader::open(std::string const& filename)
+    {
+        close();
+        file = std::fopen(filename.c_str(), "rb");
+        if(file==nullptr)
+            return false;
+
+        // Header: text lines up to end_header
+        std::string line;
+        bool binary_little_endian = true;
+        bool first_line = true;
+        bool header_end = false;
+        int c;
+        while(!header_end && (c=std::fgetc(file))!=EOF) {
+            if(c!='\n') {
+                if(c!='\r') line += char(c);
+                continue;
+            }
+
+            std::istringstream stream(line);
+            std::string keyword;
+            stream >> keyword;
+            line.clear();
+
+            if(first_line) {
+                if(keyword!="ply") { close(); return false; }
+                first_line = false;
+            }
+            else if(keyword=="format") {
+                std::string format;
+                stream >> format;
+                if(format=="binary_little_endian") binary_little_endian = true;
+                else if(format=="binary_big_endian") binary_little_endian = false;
+                else {
+                    warning_cgp("Only binary ply files are supported", "File "+filename+" is in format "+format);
+                    close();
+                    return false;
+                }
+            }
+            else if(keyword=="element") {
+                ply_element e;
+                stream >> e.name >> e.count;
+                e.record_size = 0;
+                element.push_back(e);
+            }
+            else if(keyword=="property") {
+                if(element.empty()) { close(); return false; }
+                ply_property p;
+                std::string type;
+                stream >> type;
+                p.is_list = type=="list";
+                bool valid = true;
+                if(p.is_list) {
+                    std::string count_type;
+                    stream >> count_type >> type;
+                    valid = parse_type(count_type, p.count_type);
+                }
+                else
+                    p.count_type = ply_type::uint8;
+                valid = valid && parse_type(type, p.type);
+                stream >> p.name;
+                if(!valid) { close(); return false; }
+                element.back().properties.push_back(p);
+            }
+            else if(keyword=="end_header")
+                header_end = true;
+            // comment and obj_info lines are ignored
+        }
+        if(!header_end) {
+            close();
+            return false;
+        }
+
+        swap = binary_little_endian != machine_is_little_endian();
+
+        for(size_t k=0; k<element.size(); ++k) {
+            ply_element& e = element[k];
+            bool has_list = false;
+            for(auto const& p : e.properties) {
+                has_list = has_list || p.is_list;
+                e.record_size += type_size(p.type);
+            }
+            if(has_list)
+                e.record_size = 0;
+
+            if(e.name=="vertex" && vertex_element<0) vertex_element = int(k);
+            if(e.name=="face" && face_element<0) face_element = int(k);
+        }
+
+        // The vertex attributes are read by columns, which requires records of fixed size
+        if(vertex_element>=0 && element[vertex_element].record_size==0) {
+            warning_cgp("Vertices with list properties are not supported", "File "+filename);
+            close();
+            return false;
+        }
+
+        position_offset[0] = normal_offset[0] = color_offset[0] = uv_offset[0] = -1;
+        if(vertex_element>=0) {
+            ply_element const& v = element[vertex_element];
+            if(!find_properties(v, {{"x","y","z"}}, position_offset, position_type)) {
+                warning_cgp("Vertices without x,y,z properties are not supported", "File "+filename);
+                close();
+                return false;
+            }
+            find_properties(v, {{"nx","ny","nz"}}, normal_offset, normal_type);
+            find_properties(v, {{"red","green","blue"}, {"r","g","b"}, {"diffuse_red","diffuse_green","diffuse_blue"}}, color_offset, color_type);
+            find_properties(v, {{"s","t"}, {"u","v"}, {"texture_u","texture_v"}, {"texture_s","texture_t"}}, uv_offset, uv_type);
+        }
+
+        current = 0;
+        remaining = element.empty() ? 0 : element[0].count;
+        block.resize(ply_block_size);
+        block_begin = block_end = 0;
+        return true;
+    }
+
+    bool ply_reader::skip_records(uint64_t count)
+    {
+        ply_element const& e = element[current];
+        if(e.record_size>0) {
+            while(count>0 && !error) {
+                uint64_t const N = std::min(count, uint64_t(std::max(ply_block_size/e.record_size, size_t(1))));
+                if(!fill(size_t(N*e.record_size)))
+                    break;
+                block_begin += size_t(N*e.record_size);
+                count -= N;
+            }
+            return !error;
+        }
+
+        for(; count>0 && !error; --count) {
+            for(auto const& p : e.properties) {
+                size_t size = type_size(p.type);
+                if(p.is_list) {
+                    if(!fill(type_size(p.count_type)))
+                        break;
+                    double const n = load_value(block.data()+block_begin, p.count_type, swap);
+                    block_begin += type_size(p.count_type);
+                    size *= size_t(std::max(n, 0.0));
+                }
+                if(!fill(size))
+                    break;
+                block_begin += size;
+            }
+        }
+        return !error;
+    }
+
+    bool ply_reader::go_to_element(std::string const& name)
+    {
+        if(file==nullptr || error)
+            return false;
+        while(current<element.size() && element[current].name!=name) {
+            if(!skip_records(remaining))
+                return false;
+            current++;
+            remaining = current<element.size() ? element[current].count : 0;
+        }
+        if(current>=element.size()) {
+            error = true; // the element was already passed (or doesn't exist)
+            return false;
+        }
+        return true;
+    }
+
+    size_t ply_reader::read_vertices(mesh& m, size_t max_count)
+    {
+        if(vertex_element<0 || !go_to_element("vertex"))
+            return 0;
+        profile_zone_cgp("ply read vertices");
+
+        size_t const record_size = element[current].record_size;
+        size_t const N = size_t(std::min(uint64_t(max_count), remaining));
+        size_t const first = m.position.size();
+        if(N==0)
+            return 0;
+
+        m.position.resize(int(first+N));
+        if(has_normal()) m.normal.resize(int(first+N));
+        if(has_color()) m.color.resize(int(first+N));
+        if(has_uv()) m.uv.resize(int(first+N));
+
+        // Blocks of records converted property by property
+        size_t const records_per_block = std::max(ply_block_size/record_size, size_t(1));
+        size_t read = 0;
+        while(read<N) {
+            size_t const n = std::min(N-read, records_per_block);
+            if(!fill(n*record_size))
+                break;
+            char const* records = block.data()+block_begin;
+            size_t const k = first+read;
+
+            for(int c=0; c<3; ++c) {
+                convert_column(position_type[c], swap, records+position_offset[c], record_size, n, 1.0f, &m.position[k][c], 3);
+                if(has_normal())
+                    convert_column(normal_type[c], swap, records+normal_offset[c], record_size, n, 1.0f, &m.normal[k][c], 3);
+                if(has_color())
+                    convert_column(color_type[c], swap, records+color_offset[c], record_size, n, color_divisor(color_type[c]), &m.color[k][c], 3);
+            }
+            if(has_uv())
+                for(int c=0; c<2; ++c)
+                    convert_column(uv_type[c], swap, records+uv_offset[c], record_size, n, 1.0f, &m.uv[k][c], 2);
+
+            block_begin += n*record_size;
+            remaining -= n;
+            read += n;
+        }
+
+        if(read<N) {
+            m.position.resize(int(first+read));
+            if(has_normal()) m.normal.resize(int(first+read));
+            if(has_color()) m.color.resize(int(first+read));
+            if(has_uv()) m.uv.resize(int(first+read));
+        }
+        return read;
+    }
+
+    size_t ply_reader::read_faces(buffer<uint3>& triangles, size_t max_count)
+    {
+        if(face_element<0 || !go_to_element("face"))
+            return 0;
+        profile_zone_cgp("ply read faces");
+
+        ply_element const& e = element[current];
+        int index_property = -1;
+        for(size_t k=0; k<e.properties.size(); ++k)
+            if(e.properties[k].is_list && (e.properties[k].name=="vertex_indices" || e.properties[k].name=="vertex_index"))
+                index_property = int(k);
+        if(index_property<0) {
+            error = true;
+            return 0;
+        }
+        ply_property const& indices = e.properties[index_property];
+        size_t const N = size_t(std::min(uint64_t(max_count), remaining));
+
+        size_t read = 0;
+        bool const common_layout = e.properties.size()==1 && indices.count_type==ply_type::uint8
+            && (indices.type==ply_type::int32 || indices.type==ply_type::uint32);
+        if(common_layout) {
+            // uchar count followed by 32 bits indices: specialized loop
+            auto read_polygons = [&](auto swap_tag) {
+                constexpr bool SWAP = decltype(swap_tag)::value;
+                for(; read<N; ++read) {
+                    if(!fill(1))
+                        return;
+                    size_t const n = uint8_t(block[block_begin]);
+                    if(!fill(1+4*n))
+                        return;
+                    char const* p = block.data()+block_begin+1;
+                    unsigned int const i0 = load<uint32_t,SWAP>(p);
+                    for(size_t j=1; j+1<n; ++j)
+                        triangles.push_back(uint3(i0, load<uint32_t,SWAP>(p+4*j), load<uint32_t,SWAP>(p+4*j+4)));
+                    block_begin += 1+4*n;
+                }
+            };
+            if(swap) read_polygons(std::true_type());
+            else read_polygons(std::false_type());
+        }
+        else {
+            std::vector<unsigned int> polygon;
+            for(; read<N && !error; ++read) {
+                for(size_t k=0; k<e.properties.size() && !error; ++k) {
+                    ply_property const& p = e.properties[k];
+                    size_t n = 1;
+                    if(p.is_list) {
+                        if(!fill(type_size(p.count_type)))
+                            break;
+                        n = size_t(std::max(load_value(block.data()+block_begin, p.count_type, swap), 0.0));
+                        block_begin += type_size(p.count_type);
+                    }
+                    size_t const size = n*type_size(p.type);
+                    if(!fill(size))
+                        break;
+                    if(int(k)==index_property) {
+                        polygon.resize(n);
+                        for(size_t j=0; j<n; ++j)
+                            polygon[j] = (unsigned int)(load_value(block.data()+block_begin+j*type_size(p.type), p.type, swap));
+                        for(size_t j=1; j+1<n; ++j)
+                            triangles.push_back(uint3(polygon[0], polygon[j], polygon[j+1]));
+                    }
+                    block_begin += size;
+                }
+            }
+            if(error && read>0)
+                read--; // the last polygon is incomplete
+        }
+
+        remaining -= read;
+        return read;
+    }
+
+
+    ply_writer::ply_writer()
+        :file(nullptr), error(false), normal(false), color(false), uv(false), vertex_expected(0), vertex_written(0), triangle_expected(0), triangle_written(0)
+    {}
+
+    ply_writer::~ply_writer()
+    {
+        close();
+    }
+
+    bool ply_writer::is_open() const { return file!=nullptr; }
+
+    bool ply_writer::open(std::string const& filename, uint64_t vertex_count, uint64_t triangle_count, bool normal_arg, bool color_arg, bool uv_arg)
+    {
+        close();
+        file = std::fopen(filename.c_str(), "wb");
+        if(file==nullptr)
+            return false;
+
+        error = false;
+        normal = normal_arg;
+        color = color_arg;
+        uv = uv_arg;
+        vertex_expected = vertex_count;
+        triangle_expected = triangle_count;
+        vertex_written = triangle_written = 0;
+
+        std::string header = "ply\nformat binary_little_endian 1.0\n";
+        header += "element vertex " + str(vertex_count) + "\n";
+        header += "property float x\nproperty float y\nproperty float z\n";
+        if(normal) header += "property float nx\nproperty float ny\nproperty float nz\n";
+        if(color) header += "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+        if(uv) header += "property float s\nproperty float t\n";
+        header += "element face " + str(triangle_count) + "\n";
+        header += "property list uchar int vertex_indices\n";
+        header += "end_header\n";
+
+        error = std::fwrite(header.data(), 1, header.size(), file)!=header.size();
+        return !error;
+    }
+
+    bool ply_writer::write_vertices(mesh const& chunk)
+    {
+        if(file==nullptr || error)
+            return false;
+        size_t const N = chunk.position.size();
+        if( (normal && chunk.normal.size()!=N) || (color && chunk.color.size()!=N) || (uv && chunk.uv.size()!=N) ) {
+            error = true;
+            return false;
+        }
+
+        std::vector<size_t> sizes = {4,4,4};
+        if(normal) sizes.insert(sizes.end(), {4,4,4});
+        if(color) sizes.insert(sizes.end(), {1,1,1});
+        if(uv) sizes.insert(sizes.end(), {4,4});
+        size_t record_size = 0;
+        for(size_t s : sizes) record_size += s;
+
+        size_t const records_per_block = ply_block_size/record_size;
+        block.resize(records_per_block*record_size);
+        for(size_t first=0; first<N && !error; first+=records_per_block) {
+            size_t const n = std::min(N-first, records_per_block);
+            char* p = block.data();
+            for(size_t k=first; k<first+n; ++k) {
+                vec3 const& x = chunk.position[k];
+                store(p, x.x); store(p, x.y); store(p, x.z);
+                if(normal) {
+                    vec3 const& v = chunk.normal[k];
+                    store(p, v.x); store(p, v.y); store(p, v.z);
+                }
+                if(color) {
+                    vec3 const& c = chunk.color[k];
+                    for(int i=0; i<3; ++i)
+                        store(p, uint8_t(std::min(std::max(c[i], 0.0f), 1.0f)*255.0f+0.5f));
+                }
+                if(uv) {
+                    vec2 const& t = chunk.uv[k];
+                    store(p, t.x); store(p, t.y);
+                }
+            }
+            if(!machine_is_little_endian())
+                swap_bytes(block.data(), n, sizes);
+            error = std::fwrite(block.data(), 1, n*record_size, file)!=n*record_size;
+        }
+        vertex_written += N;
+        return !error;
+    }
+
+    bool ply_writer::write_triangles(buffer<uint3> const& triangles)
+    {
+        if(file==nullptr || error)
+            return false;
+
+        size_t const record_size = 13;
+        size_t const N = triangles.size();
+        size_t const records_per_block = ply_block_size/record_size;
+        block.resize(records_per_block*record_size);
+        for(size_t first=0; first<N && !error; first+=records_per_block) {
+            size_t const n = std::min(N-first, records_per_block);
+            char* p = block.data();
+            for(size_t k=first; k<first+n; ++k) {
+                store(p, uint8_t(3));
+                for(int i=0; i<3; ++i)
+                    store(p, int32_t(triangles[k][i]));
+            }
+            if(!machine_is_little_endian())
+                swap_bytes(block.data(), n, {1,4,4,4});
+            error = std::fwrite(block.data(), 1, n*record_size, file)!=n*record_size;
+        }
+        triangle_written += N;
+        return !error;
+    }
+
+    bool ply_writer::close()
+    {
+        if(file==nullptr)
+            return false;
+        bool const closed = std::fclose(file)==0;
+        file = nullptr;
+        block.clear();
+        block.shrink_to_fit();
+        return closed && !error && vertex_written==vertex_expected && triangle_written==triangle_expected;
+    }
+
+}
+
+    mesh mesh_load_file_ply(std::string const& filename)
+    {
+        assert_file_exist(filename);
+
+        loader::ply_reader reader;
+        if(!reader.open(filename))
+            error_cgp("Cannot read ply file " + str(filename));
+
+        // Counts from the header are bounded by the file size before reserving memory
+        uint64_t const file_size = file_get_size(filename);
+        mesh m;
+        m.position.data.reserve(size_t(std::min(reader.vertex_count(), file_size)));
+        m.connectivity.data.reserve(size_t(std::min(reader.face_count(), file_size)));
+        // Elements are streamed in the order of the file
+        bool const faces_first = reader.faces_before_vertices();
+        if(faces_first)
+            while(reader.read_faces(m.connectivity, size_t(1)<<20)>0) {}
+        while(reader.read_vertices(m, size_t(1)<<20)>0) {}
+        if(!faces_first)
+            while(reader.read_faces(m.connectivity, size_t(1)<<20)>0) {}
+
+        if(reader.failed() || m.position.size()!=reader.vertex_count())
+            error_cgp("File " + str(filename) + " is truncated or invalid");
+        unsigned int const N = m.position.size();
+        for(auto const& f : m.connectivity)
+            if(f[0]>=N || f[1]>=N || f[2]>=N)
+                error_cgp("Invalid vertex index in file " + str(filename));
+
+        m.fill_empty_field();
+        return m;
+    }
+
+    void mesh_save_file_ply(std::string const& filename, mesh const& m)
+    {
+        size_t const N = m.position.size();
+        bool const has_normal = N>0 && m.normal.size()==N;
+        bool const has_color = N>0 && m.color.size()==N;
+        bool const has_uv = N>0 && m.uv.size()==N;
+
+        loader::ply_writer writer;
+        if(!writer.open(filename, N, m.connectivity.size(), has_normal, has_color, has_uv))
+            error_cgp("Cannot open file " + str(filename));
+        writer.write_vertices(m);
+        writer.write_triangles(m.connectivity);
+        if(!writer.close())
+            error_cgp("Cannot write file " + str(filename));
+    }
+
+}
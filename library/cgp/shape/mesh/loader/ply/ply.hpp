@@ -0,0 +1,136 @@
+#pragma once
+
+#include "../../structure/mesh.hpp"
+
+#include <cstdint>
+#include <cstdio>
+
+namespace cgp
+{
+    /** Load a mesh stored as .ply (binary little or big endian)
+    * Notes:
+    *  - Reads the vertex properties x,y,z / nx,ny,nz / red,green,blue (uchar colors are divided by 255) / s,t (or u,v, texture_u,texture_v)
+    *  - Polygons of the face element (vertex_indices or vertex_index list) are triangulated as fans
+    *  - Other elements and properties are skipped
+    *  - The file is streamed by blocks (see loader::ply_reader to process large files chunk by chunk) */
+    mesh mesh_load_file_ply(std::string const& filename);
+
+    /** Save a mesh in binary little endian .ply
+    * Normal, color (stored as uchar) and uv (stored as s,t) are written if they have one element per vertex */
+    void mesh_save_file_ply(std::string const& filename, mesh const& m);
+
+
+namespace loader {
+
+    enum class ply_type { int8, uint8, int16, uint16, int32, uint32, float32, float64 };
+
+    struct ply_property {
+        std::string name;
+        ply_type type;
+        bool is_list;
+        ply_type count_type; // type of the number of elements when is_list is true
+    };
+
+    struct ply_element {
+        std::string name;
+        uint64_t count;
+        std::vector<ply_property> properties;
+        size_t record_size; // size in bytes of one record, 0 if it contains a list
+    };
+
+    /** Streaming reader of binary ply files
+     * Elements are read in the order of the file, by chunks appended to the given buffers. Elements that are not requested are skipped.
+     * Requesting an element placed before the current one is an error: files storing the faces before the vertices must be read
+     * faces first (see faces_before_vertices).
+     * The memory used by the reader is bounded (one block of the file), whatever the size of the file. */
+    struct ply_reader
+    {
+        ply_reader();
+        ~ply_reader();
+        ply_reader(ply_reader const&) = delete;
+        ply_reader& operator=(ply_reader const&) = delete;
+
+        /** Open the file and parse its header. Return false if the file cannot be opened or is not a supported binary ply file
+         * (including vertices without x,y,z properties). */
+        bool open(std::string const& filename);
+        void close();
+        bool is_open() const;
+
+        std::vector<ply_element> const& elements() const;
+        uint64_t vertex_count() const;
+        uint64_t face_count() const;
+        bool has_normal() const;
+        bool has_color() const;
+        bool has_uv() const;
+        /** True if the face element is stored before the vertex element in the file */
+        bool faces_before_vertices() const;
+
+        /** Read at most max_count of the next vertices, appended to m.position (and to m.normal, m.color, m.uv when present in the file).
+         * Return the number of vertices read, 0 once all of them are read or in case of error. */
+        size_t read_vertices(mesh& m, size_t max_count);
+
+        /** Read at most max_count of the next polygons, appended as triangles (fan triangulation).
+         * Return the number of polygons read, 0 once all of them are read or in case of error. */
+        size_t read_faces(buffer<uint3>& triangles, size_t max_count);
+
+        /** True if the file ended before the expected data, or if the elements were not requested in the file order */
+        bool failed() const;
+
+    private:
+        bool go_to_element(std::string const& name);
+        bool fill(size_t size);
+        bool skip_records(uint64_t count);
+
+        std::FILE* file;
+        std::vector<ply_element> element;
+        bool swap;              // the byte order of the file differs from the one of the machine
+        bool error;
+
+        size_t current;         // element being read
+        uint64_t remaining;     // records left in the current element
+
+        std::vector<char> block; // data of the file read in advance
+        size_t block_begin;
+        size_t block_end;
+
+        int vertex_element;
+        int face_element;
+        int position_offset[3];
+        int normal_offset[3];
+        int color_offset[3];
+        int uv_offset[2];
+        ply_type position_type[3];
+        ply_type normal_type[3];
+        ply_type color_type[3];
+        ply_type uv_type[2];
+    };
+
+    /** Streaming writer of binary little endian ply files
+     * The number of vertices and triangles is given at the opening (it is written in the header), then the vertices and the triangles
+     * are written by chunks, in this order. */
+    struct ply_writer
+    {
+        ply_writer();
+        ~ply_writer();
+        ply_writer(ply_writer const&) = delete;
+        ply_writer& operator=(ply_writer const&) = delete;
+
+        bool open(std::string const& filename, uint64_t vertex_count, uint64_t triangle_count, bool normal, bool color, bool uv);
+        /** Write the vertices of the chunk (position, and normal/color/uv if declared at the opening, which must then have the same size) */
+        bool write_vertices(mesh const& chunk);
+        bool write_triangles(buffer<uint3> const& triangles);
+        /** Close the file. Return false if an error occured or if the number of written elements differs from the declared one. */
+        bool close();
+        bool is_open() const;
+
+    private:
+        std::FILE* file;
+        bool error;
+        bool normal, color, uv;
+        uint64_t vertex_expected, vertex_written;
+        uint64_t triangle_expected, triangle_written;
+        std::vector<char> block;
+    };
+}
+
+}
@@ -0,0 +1,107 @@
+#include "test_ply.hpp"
+
+#include "cgp/base/base.hpp"
+#include "../ply.hpp"
+#include "cgp/shape/mesh/primitive/mesh_primitive.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+namespace cgp_test
+{
+    namespace {
+        // Binary little endian file from a text header and raw records (the tests run on little endian machines)
+        void write_file(std::string const& filename, std::string const& header, std::vector<char> const& data)
+        {
+            std::ofstream stream(filename, std::ios::binary);
+            stream.write(header.data(), header.size());
+            stream.write(data.data(), data.size());
+        }
+
+        template <typename T>
+        void append(std::vector<char>& data, T const& value)
+        {
+            char const* p = reinterpret_cast<char const*>(&value);
+            data.insert(data.end(), p, p+sizeof(T));
+        }
+    }
+
+    void test_ply()
+    {
+        using namespace cgp;
+        std::string const filename = "cgp_test_ply.ply";
+
+        // Round trip of positions, normals, colors, uvs and triangles
+        {
+            mesh m = mesh_primitive_torus(1.0f, 0.3f, {0,0,0}, {0,0,1}, 20, 10);
+            m.fill_empty_field();
+            for(int k=0; k<m.color.size(); ++k)
+                m.color[k] = vec3(1.0f, 0.0f, 128/255.0f);
+            mesh_save_file_ply(filename, m);
+            mesh const r = mesh_load_file_ply(filename);
+
+            assert_cgp_no_msg(r.position.size()==m.position.size());
+            assert_cgp_no_msg(r.connectivity.size()==m.connectivity.size());
+            assert_cgp_no_msg(is_equal(r.position, m.position));
+            assert_cgp_no_msg(is_equal(r.normal, m.normal));
+            assert_cgp_no_msg(is_equal(r.uv, m.uv));
+            assert_cgp_no_msg(is_equal(r.color[3], vec3(1.0f, 0.0f, 128/255.0f)));
+            bool same_faces = true;
+            for(int k=0; k<m.connectivity.size(); ++k)
+                same_faces = same_faces && is_equal(r.connectivity[k], m.connectivity[k]);
+            assert_cgp_no_msg(same_faces);
+        }
+
+        // Chunked streaming gives the same vertices as a single read
+        {
+            loader::ply_reader reader;
+            assert_cgp_no_msg(reader.open(filename));
+            mesh m;
+            while(reader.read_vertices(m, 7)>0) {}
+            buffer<uint3> triangles;
+            while(reader.read_faces(triangles, 5)>0) {}
+            assert_cgp_no_msg(!reader.failed());
+            assert_cgp_no_msg(m.position.size()==reader.vertex_count());
+            assert_cgp_no_msg(triangles.size()==reader.face_count());
+        }
+
+        // Faces stored before the vertices, quad triangulated as a fan
+        {
+            std::vector<char> data;
+            append(data, uint8_t(4));
+            for(uint32_t i : {0u,1u,2u,3u}) append(data, i);
+            for(float x : {0.0f,0.0f,0.0f, 1.0f,0.0f,0.0f, 1.0f,1.0f,0.0f, 0.0f,1.0f,0.0f}) append(data, x);
+            write_file(filename, "ply\nformat binary_little_endian 1.0\nelement face 1\nproperty list uchar int vertex_indices\n"
+                "element vertex 4\nproperty float x\nproperty float y\nproperty float z\nend_header\n", data);
+
+            mesh const m = mesh_load_file_ply(filename);
+            assert_cgp_no_msg(m.position.size()==4);
+            assert_cgp_no_msg(m.connectivity.size()==2);
+            assert_cgp_no_msg(is_equal(m.connectivity[1], uint3(0,2,3)));
+            assert_cgp_no_msg(is_equal(m.position[2], vec3(1.0f,1.0f,0.0f)));
+        }
+
+        // Vertices without positions are rejected at the opening
+        {
+            std::vector<char> data;
+            for(float x : {0.0f,1.0f}) append(data, x);
+            write_file(filename, "ply\nformat binary_little_endian 1.0\nelement vertex 1\nproperty float x\nproperty float y\nend_header\n", data);
+            loader::ply_reader reader;
+            assert_cgp_no_msg(!reader.open(filename));
+        }
+
+        // Truncated file
+        {
+            std::vector<char> data;
+            for(float x : {0.0f,1.0f,2.0f}) append(data, x);
+            write_file(filename, "ply\nformat binary_little_endian 1.0\nelement vertex 2\nproperty float x\nproperty float y\nproperty float z\nend_header\n", data);
+            loader::ply_reader reader;
+            assert_cgp_no_msg(reader.open(filename));
+            mesh m;
+            while(reader.read_vertices(m, 16)>0) {}
+            assert_cgp_no_msg(reader.failed());
+        }
+
+        std::remove(filename.c_str());
+    }
+}
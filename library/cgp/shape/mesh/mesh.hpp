@@ -1,5 +1,9 @@
 #pragma once
 
 #include "structure/mesh.hpp"
+#include "adjacency/adjacency.hpp"
+#include "topology/topology.hpp"
+#include "simplification/simplification.hpp"
+#include "vertex_cache/vertex_cache.hpp"
 #include "primitive/mesh_primitive.hpp"
 #include "loader/loader.hpp"
\ No newline at end of file
@@ -0,0 +1,480 @@
+#include "simplification.hpp"
+
+#include "cgp/base/base.hpp"
+#include "../topology/topology.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace cgp
+{
+	namespace
+	{
+		// Symmetric 4x4 matrix of the squared distance to a set of planes: E(p) = p^T A p + 2 b.p + c
+		struct quadric
+		{
+			double a00, a01, a02, a11, a12, a22;
+			double b0, b1, b2;
+			double c;
+
+			// Plane n.p+d=0 (n unit) with weight w
+			void set_plane(double nx, double ny, double nz, double d, double w)
+			{
+				a00 = w*nx*nx; a01 = w*nx*ny; a02 = w*nx*nz;
+				a11 = w*ny*ny; a12 = w*ny*nz; a22 = w*nz*nz;
+				b0 = w*d*nx; b1 = w*d*ny; b2 = w*d*nz;
+				c = w*d*d;
+			}
+			void add(quadric const& q)
+			{
+				a00 += q.a00; a01 += q.a01; a02 += q.a02;
+				a11 += q.a11; a12 += q.a12; a22 += q.a22;
+				b0 += q.b0; b1 += q.b1; b2 += q.b2;
+				c += q.c;
+			}
+			double error(vec3 const& p) const
+			{
+				double const x = p.x, y = p.y, z = p.z;
+				return x*(a00*x + 2*a01*y + 2*a02*z + 2*b0)
+					+ y*(a11*y + 2*a12*z + 2*b1)
+					+ z*(a22*z + 2*b2)
+					+ c;
+			}
+		};
+
+		// Error of the pair of quadrics evaluated without forming the sum
+		double error(quadric const& q1, quadric const& q2, vec3 const& p)
+		{
+			return q1.error(p) + q2.error(p);
+		}
+
+		// Binary min-heap of vertices keyed by the cost of their best collapse, with update and removal of any vertex
+		struct collapse_queue
+		{
+			std::vector<unsigned int> heap;
+			std::vector<int> slot;    // position of each vertex in the heap, -1 if absent
+			std::vector<float> cost;
+
+			void initialize(size_t N)
+			{
+				heap.clear();
+				heap.reserve(N);
+				slot.assign(N, -1);
+				cost.assign(N, 0.0f);
+			}
+			bool empty() const { return heap.empty(); }
+			bool contains(unsigned int v) const { return slot[v]>=0; }
+			unsigned int top() const { return heap[0]; }
+
+			void update(unsigned int v, float c)
+			{
+				cost[v] = c;
+				if(slot[v]<0) {
+					slot[v] = int(heap.size());
+					heap.push_back(v);
+				}
+				sift_down(sift_up(slot[v]));
+			}
+			void remove(unsigned int v)
+			{
+				int const k = slot[v];
+				if(k<0)
+					return;
+				slot[v] = -1;
+				unsigned int const last = heap.back();
+				heap.pop_back();
+				if(last==v)
+					return;
+				heap[k] = last;
+				slot[last] = k;
+				sift_down(sift_up(k));
+			}
+
+		private:
+			void place(int k, unsigned int v) { heap[k] = v; slot[v] = k; }
+			int sift_up(int k)
+			{
+				unsigned int const v = heap[k];
+				while(k>0) {
+					int const parent = (k-1)/2;
+					if(cost[heap[parent]]<=cost[v]) break;
+					place(k, heap[parent]);
+					k = parent;
+				}
+				place(k, v);
+				return k;
+			}
+			void sift_down(int k)
+			{
+				unsigned int const v = heap[k];
+				int const N = int(heap.size());
+				while(true) {
+					int child = 2*k+1;
+					if(child>=N) break;
+					if(child+1<N && cost[heap[child+1]]<cost[heap[child]]) child++;
+					if(cost[heap[child]]>=cost[v]) break;
+					place(k, heap[child]);
+					k = child;
+				}
+				place(k, v);
+			}
+		};
+
+		// Weight of the planes orthogonal to the boundary edges relative to the face planes
+		constexpr double boundary_weight = 10.0;
+		// Minimal cosine between the normals of a face before and after a collapse
+		constexpr float flip_threshold = 0.25f;
+
+		/* Decimation state
+		* Faces are stored in a flat array and rewritten in place by the collapses. Each vertex lists its corners (3f+j) in a linked
+		*  list (head/next_corner): a collapse u->v relabels the corners of u and splices its list in front of the one of v.
+		*  Corners of removed faces are dropped lazily when a list is traversed. */
+		struct simplifier
+		{
+			std::vector<uint3> triangles;
+			std::vector<unsigned char> face_alive;
+			std::vector<int> head, next_corner;
+			std::vector<quadric> quadrics;
+			std::vector<unsigned char> boundary, locked, removed;
+			std::vector<unsigned char> outdated;   // candidate to re-evaluate before being used
+			std::vector<unsigned int> target;   // best collapse of each vertex in the queue
+			collapse_queue queue;
+			vec3 const* position = nullptr;
+			size_t alive_count = 0;
+
+			// Work buffers
+			std::vector<unsigned int> targets, ring;
+			std::vector<float> costs;
+			std::vector<unsigned int> mark, ring_mark;   // vertices already visited (equal to stamp/ring_stamp)
+			unsigned int stamp = 0, ring_stamp = 0;
+
+			void initialize(mesh const& m);
+			template <typename F> void for_each_face(unsigned int v, F const& f);
+			/** Neighbors of v, also marked in ring_mark with ring_stamp */
+			void ring_neighbors(unsigned int v, std::vector<unsigned int>& out);
+			/** Check the collapse u->v, the neighbors of u must be marked by ring_neighbors(u) */
+			bool valid(unsigned int u, unsigned int v);
+			void evaluate(unsigned int u);
+			void collapse(unsigned int u, unsigned int v);
+			/** Collapse until reaching target_count faces, return false when no valid collapse remains */
+			bool run(size_t target_count);
+			mesh extract(mesh const& m) const;
+		};
+
+		// Call f(face, corner) on the alive faces around v, remove the dead faces from the list of v
+		template <typename F> void simplifier::for_each_face(unsigned int v, F const& f)
+		{
+			int* link = &head[v];
+			while(*link>=0) {
+				int const c = *link;
+				int const face = c/3;
+				if(!face_alive[face]) {
+					*link = next_corner[c];
+					continue;
+				}
+				f(face, c%3);
+				link = &next_corner[c];
+			}
+		}
+
+		void simplifier::ring_neighbors(unsigned int v, std::vector<unsigned int>& out)
+		{
+			out.clear();
+			ring_stamp++;
+			for_each_face(v, [&](int face, int j) {
+				uint3 const& t = triangles[face];
+				unsigned int const a = (&t.x)[j==2 ? 0 : j+1];
+				unsigned int const b = (&t.x)[j==0 ? 2 : j-1];
+				if(ring_mark[a]!=ring_stamp) { ring_mark[a] = ring_stamp; out.push_back(a); }
+				if(ring_mark[b]!=ring_stamp) { ring_mark[b] = ring_stamp; out.push_back(b); }
+			});
+		}
+
+		void simplifier::initialize(mesh const& m)
+		{
+			size_t const N_vertex = m.position.size();
+			size_t const N_face = m.connectivity.size();
+			position = m.position.data.data();
+			triangles.assign(m.connectivity.begin(), m.connectivity.end());
+			face_alive.assign(N_face, 1);
+			alive_count = N_face;
+
+			// Corner lists (built backward to list the corners of each vertex in increasing order)
+			head.assign(N_vertex, -1);
+			next_corner.assign(3*N_face, -1);
+			for(int c=int(3*N_face)-1; c>=0; --c) {
+				unsigned int const v = (&triangles[c/3].x)[c%3];
+				next_corner[c] = head[v];
+				head[v] = c;
+			}
+
+			// Boundary vertices, locked when another vertex has the same position (seam between duplicated attributes)
+			mesh_topology topology;
+			topology.build(m.connectivity, N_vertex);
+			boundary.assign(N_vertex, 0);
+			locked.assign(N_vertex, 0);
+			removed.assign(N_vertex, 0);
+			outdated.assign(N_vertex, 0);
+			target.assign(N_vertex, 0);
+			mark.assign(N_vertex, 0);
+			ring_mark.assign(N_vertex, 0);
+			stamp = 0;
+			ring_stamp = 0;
+			std::vector<unsigned int> boundary_vertices;
+			for(size_t v=0; v<N_vertex; ++v) {
+				if(topology.is_boundary_vertex(unsigned(v))) {
+					boundary[v] = 1;
+					boundary_vertices.push_back(unsigned(v));
+				}
+			}
+			auto position_less = [this](unsigned int a, unsigned int b) {
+				vec3 const& pa = position[a];
+				vec3 const& pb = position[b];
+				return pa.x<pb.x || (pa.x==pb.x && (pa.y<pb.y || (pa.y==pb.y && pa.z<pb.z)));
+			};
+			std::sort(boundary_vertices.begin(), boundary_vertices.end(), position_less);
+			for(size_t k=1; k<boundary_vertices.size(); ++k) {
+				unsigned int const a = boundary_vertices[k-1], b = boundary_vertices[k];
+				if(!position_less(a, b)) {
+					locked[a] = 1;
+					locked[b] = 1;
+				}
+			}
+
+			// Quadrics: planes of the faces weighted by their area, and planes orthogonal to the boundary edges
+			quadrics.assign(N_vertex, quadric{0,0,0,0,0,0,0,0,0,0});
+			for(size_t f=0; f<N_face; ++f) {
+				uint3 const& t = triangles[f];
+				vec3 const& p0 = position[t.x];
+				vec3 const& p1 = position[t.y];
+				vec3 const& p2 = position[t.z];
+				double const e1x = p1.x-p0.x, e1y = p1.y-p0.y, e1z = p1.z-p0.z;
+				double const e2x = p2.x-p0.x, e2y = p2.y-p0.y, e2z = p2.z-p0.z;
+				double nx = e1y*e2z-e1z*e2y, ny = e1z*e2x-e1x*e2z, nz = e1x*e2y-e1y*e2x;
+				double const length = std::sqrt(nx*nx+ny*ny+nz*nz);
+				if(length<=0)
+					continue;
+				nx /= length; ny /= length; nz /= length;
+
+				quadric q;
+				q.set_plane(nx, ny, nz, -(nx*p0.x+ny*p0.y+nz*p0.z), 0.5*length);
+				quadrics[t.x].add(q);
+				quadrics[t.y].add(q);
+				quadrics[t.z].add(q);
+
+				for(int j=0; j<3; ++j) {
+					int const h = int(3*f)+j;
+					if(!topology.is_boundary_edge(h))
+						continue;
+					unsigned int const a = (&t.x)[j], b = (&t.x)[(j+1)%3];
+					vec3 const& pa = position[a];
+					vec3 const& pb = position[b];
+					double const ex = pb.x-pa.x, ey = pb.y-pa.y, ez = pb.z-pa.z;
+					double mx = ey*nz-ez*ny, my = ez*nx-ex*nz, mz = ex*ny-ey*nx;
+					double const m_length = std::sqrt(mx*mx+my*my+mz*mz);
+					if(m_length<=0)
+						continue;
+					mx /= m_length; my /= m_length; mz /= m_length;
+					q.set_plane(mx, my, mz, -(mx*pa.x+my*pa.y+mz*pa.z), boundary_weight*(ex*ex+ey*ey+ez*ez));
+					quadrics[a].add(q);
+					quadrics[b].add(q);
+				}
+			}
+
+			queue.initialize(N_vertex);
+			for(size_t v=0; v<N_vertex; ++v)
+				evaluate(unsigned(v));
+		}
+
+		bool simplifier::valid(unsigned int u, unsigned int v)
+		{
+			// Faces shared by u and v (one on a boundary edge, two on an interior edge), the other faces of u move to v and must not flip
+			int shared = 0;
+			bool flip = false;
+			vec3 const& p = position[u];
+			vec3 const& pv = position[v];
+			for_each_face(u, [&](int face, int j) {
+				uint3 const& t = triangles[face];
+				if(t.x==v || t.y==v || t.z==v) {
+					shared++;
+					return;
+				}
+				if(flip) return;
+				vec3 const& a = position[(&t.x)[j==2 ? 0 : j+1]];
+				vec3 const& b = position[(&t.x)[j==0 ? 2 : j-1]];
+				float const e1x = a.x-p.x, e1y = a.y-p.y, e1z = a.z-p.z;
+				float const e2x = b.x-p.x, e2y = b.y-p.y, e2z = b.z-p.z;
+				float const f1x = a.x-pv.x, f1y = a.y-pv.y, f1z = a.z-pv.z;
+				float const f2x = b.x-pv.x, f2y = b.y-pv.y, f2z = b.z-pv.z;
+				float const n0x = e1y*e2z-e1z*e2y, n0y = e1z*e2x-e1x*e2z, n0z = e1x*e2y-e1y*e2x;
+				float const n1x = f1y*f2z-f1z*f2y, n1y = f1z*f2x-f1x*f2z, n1z = f1x*f2y-f1y*f2x;
+				float const d = n0x*n1x+n0y*n1y+n0z*n1z;
+				float const l0 = n0x*n0x+n0y*n0y+n0z*n0z;
+				float const l1 = n1x*n1x+n1y*n1y+n1z*n1z;
+				if(l1<=0 || d<=0 || d*d < flip_threshold*flip_threshold*l0*l1)
+					flip = true;
+			});
+			if(flip || shared==0 || shared>2 || (boundary[u] && shared!=1))
+				return false;
+
+			// Link condition: the only common neighbors of u and v are the opposite vertices of the shared faces
+			//  (the neighbors of u are marked with ring_stamp)
+			int common = 0;
+			stamp++;
+			for_each_face(v, [&](int face, int j) {
+				uint3 const& t = triangles[face];
+				unsigned int const a = (&t.x)[j==2 ? 0 : j+1];
+				unsigned int const b = (&t.x)[j==0 ? 2 : j-1];
+				if(mark[a]!=stamp) { mark[a] = stamp; common += ring_mark[a]==ring_stamp; }
+				if(mark[b]!=stamp) { mark[b] = stamp; common += ring_mark[b]==ring_stamp; }
+			});
+			return common==shared;
+		}
+
+		void simplifier::evaluate(unsigned int u)
+		{
+			queue.remove(u);
+			outdated[u] = 0;
+			if(removed[u] || locked[u] || head[u]<0)
+				return;
+
+			ring_neighbors(u, targets);
+			costs.resize(targets.size());
+			for(size_t k=0; k<targets.size(); ++k)
+				costs[k] = float(error(quadrics[u], quadrics[targets[k]], position[targets[k]]));
+
+			// Cheapest valid target
+			for(size_t tries=0; tries<targets.size(); ++tries) {
+				size_t const best = std::min_element(costs.begin(), costs.end()) - costs.begin();
+				if(costs[best]==std::numeric_limits<float>::infinity())
+					return;
+				if(valid(u, targets[best])) {
+					target[u] = targets[best];
+					queue.update(u, std::max(costs[best], 0.0f));
+					return;
+				}
+				costs[best] = std::numeric_limits<float>::infinity();
+			}
+		}
+
+		void simplifier::collapse(unsigned int u, unsigned int v)
+		{
+			int tail = -1;
+			for_each_face(u, [&](int face, int j) {
+				uint3& t = triangles[face];
+				if(t.x==v || t.y==v || t.z==v) {
+					face_alive[face] = 0;
+					alive_count--;
+				}
+				else
+					(&t.x)[j] = v;
+			});
+			// Splice the corners of u in front of the list of v (dead corners are dropped later)
+			for(int c=head[u]; c>=0; c=next_corner[c])
+				tail = c;
+			if(tail>=0) {
+				next_corner[tail] = head[v];
+				head[v] = head[u];
+			}
+			head[u] = -1;
+			removed[u] = 1;
+			queue.remove(u);
+			quadrics[v].add(quadrics[u]);
+
+			// New candidate for v. The candidates of its neighbors are re-evaluated lazily when they reach the top of the queue
+			//  (their cost can only increase, except for the new edges to v), or now if they had no valid collapse.
+			ring_neighbors(v, ring);
+			evaluate(v);
+			for(size_t k=0; k<ring.size(); ++k) {
+				unsigned int const w = ring[k];
+				if(queue.contains(w))
+					outdated[w] = 1;
+				else
+					evaluate(w);
+			}
+		}
+
+		bool simplifier::run(size_t target_count)
+		{
+			while(alive_count>target_count) {
+				if(queue.empty())
+					return false;
+				unsigned int const u = queue.top();
+				unsigned int const v = target[u];
+				if(outdated[u]) {
+					evaluate(u);
+					continue;
+				}
+				ring_neighbors(u, targets);
+				if(removed[v] || !valid(u, v)) {
+					evaluate(u);
+					continue;
+				}
+				collapse(u, v);
+			}
+			return true;
+		}
+
+		mesh simplifier::extract(mesh const& m) const
+		{
+			size_t const N_vertex = m.position.size();
+			std::vector<int> index(N_vertex, -1);
+			for(size_t f=0; f<triangles.size(); ++f)
+				if(face_alive[f])
+					for(int j=0; j<3; ++j)
+						index[(&triangles[f].x)[j]] = 0;
+
+			mesh result;
+			bool const has_normal = m.normal.size()==N_vertex;
+			bool const has_color = m.color.size()==N_vertex;
+			bool const has_uv = m.uv.size()==N_vertex;
+			int count = 0;
+			for(size_t v=0; v<N_vertex; ++v) {
+				if(index[v]<0)
+					continue;
+				index[v] = count++;
+				result.position.push_back(m.position.data[v]);
+				if(has_normal) result.normal.push_back(m.normal.data[v]);
+				if(has_color) result.color.push_back(m.color.data[v]);
+				if(has_uv) result.uv.push_back(m.uv.data[v]);
+			}
+
+			result.connectivity.resize(alive_count);
+			size_t k = 0;
+			for(size_t f=0; f<triangles.size(); ++f) {
+				if(!face_alive[f])
+					continue;
+				uint3 const& t = triangles[f];
+				result.connectivity.data[k++] = { unsigned(index[t.x]), unsigned(index[t.y]), unsigned(index[t.z]) };
+			}
+			return result;
+		}
+	}
+
+	mesh mesh_simplify(mesh const& m, size_t target_triangle_count)
+	{
+		buffer<size_t> targets;
+		targets.push_back(target_triangle_count);
+		return mesh_simplify_lod(m, targets)[0];
+	}
+
+	buffer<mesh> mesh_simplify_lod(mesh const& m, buffer<size_t> const& target_triangle_counts)
+	{
+		profile_zone_cgp("mesh simplify");
+
+		for(size_t k=1; k<target_triangle_counts.size(); ++k)
+			assert_cgp(target_triangle_counts[k]<=target_triangle_counts[k-1], "Target triangle counts of the levels of detail must be given in decreasing order");
+
+		buffer<mesh> levels;
+		simplifier state;
+		state.initialize(m);
+		for(size_t k=0; k<target_triangle_counts.size(); ++k) {
+			if(!state.run(target_triangle_counts[k]))
+				warning_cgp("mesh_simplify: no valid collapse remains before reaching the target triangle count.", "Target: "+str(target_triangle_counts[k])+" triangles, reached: "+str(state.alive_count)+" triangles");
+			levels.push_back(state.extract(m));
+		}
+		return levels;
+	}
+}
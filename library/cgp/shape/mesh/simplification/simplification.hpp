@@ -0,0 +1,19 @@
+#pragma once
+
+#include "../structure/mesh.hpp"
+
+namespace cgp
+{
+	/** Simplify a mesh down to target_triangle_count triangles with quadric error metrics (Garland & Heckbert)
+	* Notes:
+	*  - Half-edge collapses u->v are used: the remaining vertices are a subset of the original ones and keep their attributes (normal, uv, color)
+	*  - Candidates (the best collapse of each vertex) are stored in a priority queue updated around each collapse
+	*  - Collapses changing the topology (link condition), flipping faces, or moving a boundary vertex inside the surface are rejected
+	*  - Boundary vertices duplicated at the same position (uv or normal seams) are kept to avoid cracks
+	*  - The simplification stops before the target if no valid collapse remains (a warning is displayed) */
+	mesh mesh_simplify(mesh const& m, size_t target_triangle_count);
+
+	/** Chain of levels of detail simplified with mesh_simplify, one mesh per target triangle count (given in decreasing order)
+	* All the levels are extracted during a single simplification pass. */
+	buffer<mesh> mesh_simplify_lod(mesh const& m, buffer<size_t> const& target_triangle_counts);
+}
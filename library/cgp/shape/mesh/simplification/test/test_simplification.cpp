@@ -0,0 +1,99 @@
+#include "test_simplification.hpp"
+
+#include "cgp/base/base.hpp"
+#include "../simplification.hpp"
+#include "cgp/shape/mesh/topology/topology.hpp"
+#include "cgp/shape/mesh/primitive/mesh_primitive.hpp"
+
+#include <cmath>
+
+namespace cgp_test
+{
+	namespace {
+		bool is_valid_connectivity(cgp::mesh const& m)
+		{
+			for(cgp::uint3 const& f : m.connectivity)
+				if(f.x>=m.position.size() || f.y>=m.position.size() || f.z>=m.position.size() || f.x==f.y || f.y==f.z || f.x==f.z)
+					return false;
+			return true;
+		}
+
+		// Torus without duplicated seam vertices (the primitive repeats them for the texture coordinates)
+		cgp::mesh closed_torus(int Nu, int Nv)
+		{
+			using namespace cgp;
+			mesh m;
+			for(int ku=0; ku<Nu; ++ku) {
+				for(int kv=0; kv<Nv; ++kv) {
+					float const u = 2*pi*ku/float(Nu), v = 2*pi*kv/float(Nv);
+					m.position.push_back({ (1.0f+0.3f*std::cos(v))*std::cos(u), (1.0f+0.3f*std::cos(v))*std::sin(u), 0.3f*std::sin(v) });
+				}
+			}
+			for(int ku=0; ku<Nu; ++ku) {
+				for(int kv=0; kv<Nv; ++kv) {
+					unsigned int const a = ku*Nv+kv, b = ((ku+1)%Nu)*Nv+kv, c = ((ku+1)%Nu)*Nv+(kv+1)%Nv, d = ku*Nv+(kv+1)%Nv;
+					m.connectivity.push_back({a,b,c});
+					m.connectivity.push_back({a,c,d});
+				}
+			}
+			return m.fill_empty_field();
+		}
+
+		bool has_position(cgp::mesh const& m, cgp::vec3 const& p)
+		{
+			for(cgp::vec3 const& q : m.position)
+				if(cgp::norm(q-p)<1e-6f)
+					return true;
+			return false;
+		}
+	}
+
+	void test_simplification()
+	{
+		using namespace cgp;
+
+		// Closed surface: each level keeps the topology of the torus (Euler characteristic 0)
+		{
+			mesh const m = closed_torus(40, 20);
+			mesh_topology topology;
+			topology.build(m.connectivity, m.position.size());
+			assert_cgp_no_msg(topology.is_closed_manifold());
+
+			buffer<size_t> const targets = { 1000, 300, 100 };
+			buffer<mesh> const lods = mesh_simplify_lod(m, targets);
+			assert_cgp_no_msg(lods.size()==3);
+			for(size_t k=0; k<lods.size(); ++k) {
+				mesh const& level = lods[k];
+				assert_cgp_no_msg(level.connectivity.size()<=targets[k]);
+				assert_cgp_no_msg(k==0 || level.connectivity.size()<=lods[k-1].connectivity.size());
+				assert_cgp_no_msg(is_valid_connectivity(level));
+				assert_cgp_no_msg(level.normal.size()==level.position.size() && level.uv.size()==level.position.size());
+
+				topology.build(level.connectivity, level.position.size());
+				assert_cgp_no_msg(topology.is_closed_manifold());
+				assert_cgp_no_msg(2*level.position.size()==level.connectivity.size());
+			}
+		}
+
+		// Open surface: the boundary stays a single loop and the corners are kept
+		{
+			mesh const m = mesh_primitive_grid({0,0,0}, {1,0,0}, {1,1,0}, {0,1,0}, 30, 30);
+			mesh const simplified = mesh_simplify(m, 200);
+			assert_cgp_no_msg(simplified.connectivity.size()<=200);
+			assert_cgp_no_msg(is_valid_connectivity(simplified));
+
+			mesh_topology topology;
+			topology.build(simplified.connectivity, simplified.position.size());
+			assert_cgp_no_msg(topology.boundary_loops.size()==1);
+			assert_cgp_no_msg(topology.non_manifold_edge_count==0 && topology.non_manifold_vertex_count==0);
+			assert_cgp_no_msg(has_position(simplified,{0,0,0}) && has_position(simplified,{1,0,0}) && has_position(simplified,{1,1,0}) && has_position(simplified,{0,1,0}));
+		}
+
+		// A target above the current number of triangles leaves the mesh unchanged
+		{
+			mesh const m = mesh_primitive_grid({0,0,0}, {1,0,0}, {1,1,0}, {0,1,0}, 5, 5);
+			mesh const same = mesh_simplify(m, m.connectivity.size()+10);
+			assert_cgp_no_msg(same.connectivity.size()==m.connectivity.size() && same.position.size()==m.position.size());
+		}
+	}
+}
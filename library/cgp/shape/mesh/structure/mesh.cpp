@@ -1,6 +1,8 @@
 #include "mesh.hpp"
+#include "../adjacency/adjacency.hpp"
 
-#include <set>
+#include <atomic>
+#include <sstream>
 
 namespace cgp
 {
@@ -43,65 +45,197 @@ namespace cgp
 	}
 
 
-	void normal_per_vertex(buffer<vec3> const& position, buffer<uint3> const& connectivity, buffer<vec3>& normals, bool invert)
+	// Normals of the faces [first,last) of the list (or of the connectivity if faces is nullptr), stored at face_normal[face index]
+	//  Unit normals are zero for degenerated triangles (norm of edges=0 or edges aligned), AREA gives the cross product of the edges.
+	//  The positions of a block of faces are first gathered as structure of arrays, the arithmetic on the block has then no
+	//  indirection nor branch and is vectorized by the compiler.
+	template <bool AREA>
+	static void face_normal_block(vec3 const* position, uint3 const* connectivity, unsigned int const* faces, int first, int last, vec3* face_normal)
 	{
-		size_t const N = position.size();
-		if(normals.size()!=N)
-			normals.resize(N);
-		else
-			normals.fill(vec3{0,0,0});
-
-		size_t const N_tri = connectivity.size();
-		for (size_t k_tri = 0; k_tri < N_tri; ++k_tri)
+		int const block = 16;
+		float e1[3][block], e2[3][block], n[3][block];
+		for(int b=first; b<last; b+=block)
 		{
-			uint3 const& face = connectivity[k_tri];
-
-			//sanity check
-			assert_cgp_no_msg(get<0>(face)<N);
-			assert_cgp_no_msg(get<1>(face)<N);
-			assert_cgp_no_msg(get<2>(face)<N);
-
-			vec3 const& p0 = position[get<0>(face)];
-			vec3 const& p1 = position[get<1>(face)];
-			vec3 const& p2 = position[get<2>(face)];
-
-			// compute normal of the triangle
-			vec3 const p10 = p1-p0;
-			vec3 const p20 = p2-p0;
-
-			float const L10 = norm(p10);
-			float const L20 = norm(p20);
-
-			// Add the normal direction to all vertices of this triangle
-			//  (only if the triangle is not degenerated: norm of edges>0, edges not aligned)
-			if (L10 > 1e-6f && L20 > 1e-6f)
-			{
-				vec3 const n = cross(p10/L10, p20/L20);
-				float const Ln = norm(n);
-
-				if (Ln > 1e-6f)
-				{
-					vec3 const n_unit = n/Ln;
-					for(unsigned int idx : face)
-						normals[idx] += n_unit;
+			int const N = std::min(block, last-b);
+			for(int k=0; k<N; ++k) {
+				uint3 const& face = connectivity[faces!=nullptr ? faces[b+k] : b+k];
+				vec3 const& p0 = position[face.x];
+				vec3 const& p1 = position[face.y];
+				vec3 const& p2 = position[face.z];
+				e1[0][k] = p1.x-p0.x; e1[1][k] = p1.y-p0.y; e1[2][k] = p1.z-p0.z;
+				e2[0][k] = p2.x-p0.x; e2[1][k] = p2.y-p0.y; e2[2][k] = p2.z-p0.z;
+			}
+			for(int k=N; k<block; ++k)
+				for(int c=0; c<3; ++c)
+					e1[c][k] = e2[c][k] = 0.0f;
+
+			for(int k=0; k<block; ++k) {
+				n[0][k] = e1[1][k]*e2[2][k] - e1[2][k]*e2[1][k];
+				n[1][k] = e1[2][k]*e2[0][k] - e1[0][k]*e2[2][k];
+				n[2][k] = e1[0][k]*e2[1][k] - e1[1][k]*e2[0][k];
+				if(!AREA) {
+					float const L1 = e1[0][k]*e1[0][k] + e1[1][k]*e1[1][k] + e1[2][k]*e1[2][k];
+					float const L2 = e2[0][k]*e2[0][k] + e2[1][k]*e2[1][k] + e2[2][k]*e2[2][k];
+					float const Ln = n[0][k]*n[0][k] + n[1][k]*n[1][k] + n[2][k]*n[2][k];
+					// |e1|>1e-6, |e2|>1e-6 and |sin(e1,e2)|>1e-6
+					bool const valid = L1>1e-12f && L2>1e-12f && Ln>1e-12f*L1*L2;
+					float const scale = valid ? 1.0f/std::sqrt(Ln) : 0.0f;
+					n[0][k] *= scale;
+					n[1][k] *= scale;
+					n[2][k] *= scale;
 				}
 			}
+
+			for(int k=0; k<N; ++k)
+				face_normal[faces!=nullptr ? faces[b+k] : b+k] = vec3{n[0][k], n[1][k], n[2][k]};
+		}
+	}
+
+	static void face_normals(vec3 const* position, uint3 const* connectivity, unsigned int const* faces, int N_face, bool area_weighted, vec3* face_normal)
+	{
+		parallel_for_range(0, N_face, [&](int first, int last) {
+			if(area_weighted)
+				face_normal_block<true>(position, connectivity, faces, first, last, face_normal);
+			else
+				face_normal_block<false>(position, connectivity, faces, first, last, face_normal);
+		});
+	}
+
+	// Normalize a sum of face normals, and invert it if asked (written component-wise: this is in the inner loops)
+	static vec3 normalize_vertex_normal(float x, float y, float z, float sign)
+	{
+		float const L2 = x*x + y*y + z*z;
+		float const scale = L2>1e-12f ? sign/std::sqrt(L2) : sign;
+		return vec3{x*scale, y*scale, z*scale};
+	}
+
+	// Normal of the vertex v: normalized sum of the normals of its faces
+	static void gather_vertex_normal(unsigned int v, unsigned int const* offset, unsigned int const* faces, vec3 const* face_normal, float sign, vec3* normal)
+	{
+		float x = 0.0f, y = 0.0f, z = 0.0f;
+		for(unsigned int k=offset[v]; k<offset[v+1]; ++k) {
+			vec3 const& n = face_normal[faces[k]];
+			x += n.x;
+			y += n.y;
+			z += n.z;
+		}
+		normal[v] = normalize_vertex_normal(x, y, z, sign);
+	}
+
+	void normal_per_vertex(buffer<vec3> const& position, buffer<uint3> const& connectivity, buffer<vec3>& normals, bool invert)
+	{
+		profile_zone_cgp("normal_per_vertex");
+
+		size_t const N = position.size();
+		normals.resize(N);
+		normals.fill(vec3{0,0,0});
+
+		int const N_tri = connectivity.size();
+		for(uint3 const& face : connectivity)
+			assert_cgp(face.x<N && face.y<N && face.z<N, "Vertex index of face "+str(face)+" is larger than the number of vertices "+str(N));
+
+		// Unit normal of each triangle, computed in parallel
+		buffer<vec3> face_normal(N_tri);
+		face_normals(position.data.data(), connectivity.data.data(), nullptr, N_tri, false, face_normal.data.data());
+
+		// Add the normal direction to all vertices of each triangle (vertices are shared: serial accumulation)
+		//  A mesh_normal_updater avoids this scatter when the normals are recomputed for the same connectivity
+		vec3* normal = normals.data.data();
+		for (int k_tri = 0; k_tri < N_tri; ++k_tri) {
+			vec3 const& n = face_normal.data[k_tri];
+			for(unsigned int idx : connectivity.data[k_tri]) {
+				normal[idx].x += n.x;
+				normal[idx].y += n.y;
+				normal[idx].z += n.z;
+			}
 		}
 
-		// Normalize all normals
-		for (size_t k = 0; k < N; ++k)
+		// Normalize all normals, and invert them if asked
+		float const sign = invert ? -1.0f : 1.0f;
+		parallel_for(0, int(N), [&](int k)
 		{
-			vec3& n = normals[k];
-			float const L = norm(n);
-			if(L>1e-6f)
-				n /= L;
+			normal[k] = normalize_vertex_normal(normal[k].x, normal[k].y, normal[k].z, sign);
+		});
+	}
+
+	void mesh_normal_updater::initialize(buffer<uint3> const& connectivity_arg, size_t N_vertex)
+	{
+		connectivity = connectivity_arg;
+		vertex_to_face = mesh_vertex_to_face(connectivity, N_vertex);
+		face_normal.clear();
+		face_stamp.assign(connectivity.size(), 0);
+		vertex_stamp.assign(N_vertex, 0);
+		stamp = 0;
+	}
+
+	void mesh_normal_updater::update(buffer<vec3> const& position, buffer<vec3>& normals)
+	{
+		assert_cgp(position.size()==vertex_to_face.size(), "Number of positions ("+str(position.size())+") differs from the number of vertices given to initialize ("+str(vertex_to_face.size())+")");
+		update(position.data.data(), normals);
+	}
+
+	void mesh_normal_updater::update(vec3 const* position, buffer<vec3>& normals)
+	{
+		profile_zone_cgp("normal update");
+
+		int const N_vertex = int(vertex_to_face.size());
+		int const N_tri = connectivity.size();
+		face_normal.resize(N_tri);
+		normals.resize(N_vertex);
+		face_normals(position, connectivity.data.data(), nullptr, N_tri, area_weighted, face_normal.data.data());
+
+		float const sign = invert ? -1.0f : 1.0f;
+		unsigned int const* offset = vertex_to_face.offset.data.data();
+		unsigned int const* faces_of_vertex = vertex_to_face.index.data.data();
+		vec3 const* face = face_normal.data.data();
+		vec3* normal = normals.data.data();
+		parallel_for(0, N_vertex, [&](int v) {
+			gather_vertex_normal(v, offset, faces_of_vertex, face, sign, normal);
+		});
+	}
+
+	void mesh_normal_updater::update_moved(buffer<vec3> const& position, buffer<unsigned int> const& moved, buffer<vec3>& normals)
+	{
+		if(face_normal.size()!=connectivity.size() || normals.size()!=vertex_to_face.size()) {
+			update(position, normals);
+			return;
 		}
+		profile_zone_cgp("normal update moved");
 
-		// Invert normals if asked
-		if(invert) for(auto& n : normals) n = -n;
+		// Stamps identify the elements already collected by this call (reset when the counter wraps)
+		if(++stamp==0) {
+			std::fill(face_stamp.begin(), face_stamp.end(), 0);
+			std::fill(vertex_stamp.begin(), vertex_stamp.end(), 0);
+			stamp = 1;
+		}
 
-			
+		faces.clear();
+		for(unsigned int v : moved)
+			for(unsigned int const* f=vertex_to_face.begin(v); f!=vertex_to_face.end(v); ++f)
+				if(face_stamp[*f]!=stamp) {
+					face_stamp[*f] = stamp;
+					faces.push_back(*f);
+				}
+		face_normals(position.data.data(), connectivity.data.data(), faces.data(), int(faces.size()), area_weighted, face_normal.data.data());
+
+		vertices.clear();
+		for(unsigned int f : faces)
+			for(unsigned int v : connectivity.data[f])
+				if(vertex_stamp[v]!=stamp) {
+					vertex_stamp[v] = stamp;
+					vertices.push_back(v);
+				}
+
+		float const sign = invert ? -1.0f : 1.0f;
+		unsigned int const* offset = vertex_to_face.offset.data.data();
+		unsigned int const* faces_of_vertex = vertex_to_face.index.data.data();
+		vec3 const* face = face_normal.data.data();
+		vec3* normal = normals.data.data();
+		parallel_for(0, int(vertices.size()), [&](int k) {
+			gather_vertex_normal(vertices[k], offset, faces_of_vertex, face, sign, normal);
+		});
 	}
+
 	buffer<vec3> normal_per_vertex(buffer<vec3> const& position, buffer<uint3> const& connectivity, bool invert)
 	{
 		buffer<vec3> normals;
@@ -109,83 +243,121 @@ namespace cgp
 		return normals;
 	}
 
-	bool mesh_check(mesh const& m)
+	bool mesh_check_result::valid() const
 	{
-		bool ok = true;
-		std::string const warning = "Warning [mesh_check]: ";
+		return N_vertex>0 && N_vertex<=10000000 && N_triangle>0 && N_triangle<=10000000
+			&& !incoherent_normal && !incoherent_uv && !incoherent_color && invalid_index_count==0;
+	}
 
+	mesh_check_result mesh_validate(mesh const& m, int max_reported)
+	{
+		profile_zone_cgp("mesh_validate");
+
+		mesh_check_result result;
 		size_t const N = m.position.size();
-		if (N == 0)
-		{std::cout<<warning+"Current mesh has 0 position"<<std::endl; ok =false;}
-		if (N>10000000)
-		{std::cout<<warning+"Current mesh has more than 10 millions positions"<<std::endl; ok=false;}
-
-		if (m.normal.size()==0)
-		{std::cout<<warning+"Mesh doesn't have any per-vertex normal defined"<<std::endl; ok=false;}
-		if (m.normal.size()!=N)
-		{std::cout<<warning+"Mesh has incoherent size of per-vertex normal"<<std::endl; ok=false;}
-
-		if(m.uv.size()==0)
-		{std::cout<<warning+"Mesh doesn't have any per-vertex uv defined"<<std::endl; ok=false;}
-		if(m.uv.size()!=N)
-		{std::cout<<warning+"Mesh has incoherent size of per-vertex uv"<<std::endl; ok=false;}
-		
-		if(m.color.size()==0)
-		{std::cout<<warning+"Mesh doesn't have any per-vertex color defined"<<std::endl; ok=false;}
-		if(m.color.size()!=N)
-		{std::cout<<warning+"Mesh has incoherent size of per-vertex color"<<std::endl; ok=false;}
-
-		size_t const N_triangle = m.connectivity.size();
-		if (N_triangle == 0)
-		{std::cout<<warning+"Current mesh has no connectivity"<<std::endl; ok=false;}
-		if (N_triangle>10000000)
-		{std::cout<<warning+"Current mesh has more than 10 millions triangles"<<std::endl; ok=false;}
-
-		// Check triangles
-		for (size_t kt = 0; kt < N_triangle; ++kt) {
-			uint3 const& face = m.connectivity[kt];
-			unsigned int f0 = face[0];
-			unsigned int f1 = face[1];
-			unsigned int f2 = face[2];
-
-			if (f0 > N || f1 > N || f2 > N)
-			{
-				std::cout<<warning+"Triangle "<<str(kt)<<" has index triplet ("<<str(f0)<<","<<str(f1)<<","<<str(f2)<<") exceeding the size of the position ["<<str(N)<<"]"<<std::endl;
-				return false; // critical error
+		int const N_triangle = m.connectivity.size();
+		result.N_vertex = N;
+		result.N_triangle = N_triangle;
+		result.incoherent_normal = m.normal.size()!=N;
+		result.incoherent_uv = m.uv.size()!=N;
+		result.incoherent_color = m.color.size()!=N;
+
+		// Triangles are checked by ranges in parallel, the results of the ranges are merged in order
+		struct range_result {
+			size_t invalid_index_count = 0;
+			size_t zero_length_edge_count = 0;
+			std::vector<unsigned int> invalid_index;
+			std::vector<uint2> zero_length_edge;
+		};
+		int const N_range = std::max(1, std::min(4*parallel_thread_count(), N_triangle/4096));
+		std::vector<range_result> ranges(N_range);
+
+		// referenced[k] is set by any triangle using k (the same value may be written concurrently: relaxed atomic stores)
+		std::vector<std::atomic<unsigned char> > referenced(N);
+		for(auto& r : referenced) r.store(0, std::memory_order_relaxed);
+
+		vec3 const* position = m.position.data.data();
+		uint3 const* connectivity = m.connectivity.data.data();
+		parallel_for(0, N_range, [&](int r) {
+			range_result& range = ranges[r];
+			int const first = int(int64_t(N_triangle)*r/N_range);
+			int const last = int(int64_t(N_triangle)*(r+1)/N_range);
+			for(int kt=first; kt<last; ++kt) {
+				uint3 const& face = connectivity[kt];
+				if(face.x>=N || face.y>=N || face.z>=N) {
+					if(range.invalid_index_count++ < size_t(max_reported))
+						range.invalid_index.push_back(kt);
+					continue;
+				}
+				for(int j=0; j<3; ++j) {
+					unsigned int const a = (&face.x)[j];
+					unsigned int const b = (&face.x)[(j+1)%3];
+					referenced[a].store(1, std::memory_order_relaxed);
+					float const dx = position[b].x-position[a].x;
+					float const dy = position[b].y-position[a].y;
+					float const dz = position[b].z-position[a].z;
+					if(dx*dx+dy*dy+dz*dz < 1e-12f) {
+						if(range.zero_length_edge_count++ < size_t(max_reported))
+							range.zero_length_edge.push_back(uint2(a, b));
+					}
+				}
 			}
+		}, 1);
+
+		for(range_result const& range : ranges) {
+			result.invalid_index_count += range.invalid_index_count;
+			result.zero_length_edge_count += range.zero_length_edge_count;
+			for(unsigned int kt : range.invalid_index)
+				if(result.invalid_index.size()<size_t(max_reported)) result.invalid_index.push_back(kt);
+			for(uint2 const& e : range.zero_length_edge)
+				if(result.zero_length_edge.size()<size_t(max_reported)) result.zero_length_edge.push_back(e);
+		}
 
-			vec3 const& p0 = m.position[f0];
-			vec3 const& p1 = m.position[f1];
-			vec3 const& p2 = m.position[f2];
-
-			// Check edge length
-			if (norm(p1 - p0) < 1e-6f) {
-				std::cout<<warning+"Edge ("+str(f0)+","+str(f1)+") has zero length. position["+str(f0)+"]="+str(p0)+", position["+str(f1)+"]="+str(p1)+"; L_edge = "<<str(norm(p1-p0))<<std::endl;
-			}
-			if (norm(p2 - p1) < 1e-6f) {
-				std::cout<<warning+"Edge ("+str(f2)+","+str(f1)+") has zero length. position["+str(f2)+"]="+str(p2)+", position["+str(f1)+"]="+str(p1)+"; L_edge = "<<str(norm(p2-p1))<<std::endl;
-			}
-			if (norm(p2 - p0) < 1e-6f) {
-				std::cout<<warning+"Edge ("+str(f2)+","+str(f0)+") has zero length. position["+str(f2)+"]="+str(p2)+", position["+str(f0)+"]="+str(p0)+"; L_edge = "<<str(norm(p2-p0))<<std::endl;
+		for(size_t k=0; k<N; ++k) {
+			if(referenced[k].load(std::memory_order_relaxed)==0) {
+				if(result.unreferenced_vertex_count++ < size_t(max_reported))
+					result.unreferenced_vertex.push_back((unsigned int)k);
 			}
 		}
 
+		return result;
+	}
 
-		// Check that vertices are indexed
-		if(N<6000){ // only check for small meshes (slow)
-			for (size_t k = 0; k < N; ++k)
-			{
-				bool found_vertex = false;
-				for (size_t kt = 0; found_vertex==false && kt < N_triangle; ++kt) {
-					uint3 const& face = m.connectivity[kt];
-					if(k==face[0] || k==face[1] || k==face[2])
-						found_vertex = true;
-				}
-				if (found_vertex == false)
-					std::cout<<warning+"Vertex "+str(k)+" at position "+str(m.position[k])+" is not indexed in the connectivity"<<std::endl;
-			}
-		}
+	std::string str(mesh_check_result const& result)
+	{
+		std::string s;
+		if(result.N_vertex==0)
+			s += "Current mesh has 0 position\n";
+		if(result.N_vertex>10000000)
+			s += "Current mesh has more than 10 millions positions\n";
+		if(result.N_triangle==0)
+			s += "Current mesh has no connectivity\n";
+		if(result.N_triangle>10000000)
+			s += "Current mesh has more than 10 millions triangles\n";
+		if(result.incoherent_normal)
+			s += "Mesh has incoherent size of per-vertex normal\n";
+		if(result.incoherent_uv)
+			s += "Mesh has incoherent size of per-vertex uv\n";
+		if(result.incoherent_color)
+			s += "Mesh has incoherent size of per-vertex color\n";
+		if(result.invalid_index_count>0)
+			s += str(result.invalid_index_count)+" triangles have an index exceeding the size of the position ["+str(result.N_vertex)+"], ex. triangles "+str(result.invalid_index)+"\n";
+		if(result.zero_length_edge_count>0)
+			s += str(result.zero_length_edge_count)+" edges have zero length, ex. edges "+str(result.zero_length_edge)+"\n";
+		if(result.unreferenced_vertex_count>0)
+			s += str(result.unreferenced_vertex_count)+" vertices are not indexed in the connectivity, ex. vertices "+str(result.unreferenced_vertex)+"\n";
+		return s;
+	}
 
+	bool mesh_check(mesh const& m)
+	{
+		mesh_check_result const result = mesh_validate(m);
+		std::istringstream report(str(result));
+		std::string line;
+		while(std::getline(report, line))
+			std::cout<<"Warning [mesh_check]: "<<line<<std::endl;
+
+		bool const ok = result.valid();
 		if (ok == false)
 		{
 			std::cout<<"\nYou mesh seem to have issues - you should correct it before being able to display it\n"<<std::endl;
@@ -225,27 +397,18 @@ namespace cgp
 
 	buffer<buffer<unsigned int> > connectivity_one_ring(buffer<uint3> const& connectivity)
 	{
-		size_t const N = connectivity.size();
-		buffer<std::set<unsigned int> > one_ring;
-		one_ring.resize(N);
-		for (size_t k = 0; k < N; ++k)
-		{
-			uint3 const& tri = connectivity[k];
-			one_ring[ get<0>(tri) ].insert( get<1>(tri) );
-			one_ring[ get<0>(tri) ].insert( get<2>(tri) );
-
-			one_ring[ get<1>(tri) ].insert( get<0>(tri) );
-			one_ring[ get<1>(tri) ].insert( get<2>(tri) );
+		return connectivity_one_ring(connectivity, connectivity_vertex_count(connectivity));
+	}
 
-			one_ring[ get<2>(tri) ].insert( get<0>(tri) );
-			one_ring[ get<2>(tri) ].insert( get<1>(tri) );
-		}
+	buffer<buffer<unsigned int> > connectivity_one_ring(buffer<uint3> const& connectivity, size_t N_vertex)
+	{
+		csr_adjacency const one_ring = mesh_vertex_one_ring(connectivity, N_vertex);
 
 		buffer<buffer<unsigned int> > one_ring_buffer;
-		one_ring_buffer.resize(N);
-		for(size_t k=0; k<N; ++k)
-			for(unsigned int idx : one_ring[k])
-				one_ring_buffer[k].push_back(idx);
+		one_ring_buffer.resize(int(N_vertex));
+		parallel_for(0, int(N_vertex), [&](int k) {
+			one_ring_buffer[k].data.assign(one_ring.begin(k), one_ring.end(k));
+		});
 		return one_ring_buffer;
 	}
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "cgp/containers/containers.hpp"
+#include "../adjacency/adjacency.hpp"
 
 namespace cgp
 {
@@ -31,11 +32,71 @@ namespace cgp
 	/** Compute automaticaly a per-vertex normal given a set of positions and their connectivity */
 	buffer<vec3> normal_per_vertex(buffer<vec3> const& position, buffer<uint3> const& connectivity, bool invert=false);
 
-	/** Check if the mesh looks coherent (correct indexing and size of buffer, no degenerate triangle, etc) */
+	/** Per-vertex normals of a deforming mesh with a fixed connectivity, recomputed at each frame
+	* The vertex to face adjacency is built once by initialize(). An update computes the face normals in parallel (by blocks of
+	*  faces stored as structure of arrays to let the compiler vectorize the arithmetic), then gathers the normals of its faces
+	*  for each vertex in parallel (no scatter, no atomics).
+	* update_moved() only recomputes the faces around the given vertices and the normals of the vertices of these faces.
+	* Face normals are unit vectors (same result as normal_per_vertex), or cross products if area_weighted is true. */
+	struct mesh_normal_updater
+	{
+		bool area_weighted = false;
+		bool invert = false;
+
+		buffer<uint3> connectivity;
+		csr_adjacency vertex_to_face;
+		buffer<vec3> face_normal;
+
+		void initialize(buffer<uint3> const& connectivity, size_t N_vertex);
+		void update(buffer<vec3> const& position, buffer<vec3>& normals);
+		void update(vec3 const* position, buffer<vec3>& normals);
+		/** Recompute the normals around the moved vertices (a full update is done if the face normals are not computed yet) */
+		void update_moved(buffer<vec3> const& position, buffer<unsigned int> const& moved, buffer<vec3>& normals);
+
+	private:
+		std::vector<unsigned int> face_stamp, vertex_stamp; // faces/vertices already collected by the current update_moved
+		unsigned int stamp = 0;
+		std::vector<unsigned int> faces, vertices;
+	};
+
+	/** Problems found by mesh_validate
+	* Each kind of problem is counted, and the first elements concerned (in the order of the buffers) are listed */
+	struct mesh_check_result
+	{
+		size_t N_vertex = 0;
+		size_t N_triangle = 0;
+
+		// Per-vertex buffers whose size differs from the number of positions
+		bool incoherent_normal = false;
+		bool incoherent_uv = false;
+		bool incoherent_color = false;
+
+		size_t invalid_index_count = 0;           // triangles with an index larger than the number of positions
+		buffer<unsigned int> invalid_index;       // first triangles concerned
+		size_t zero_length_edge_count = 0;        // edges of the triangles shorter than 1e-6
+		buffer<uint2> zero_length_edge;           // first edges concerned (vertex indices)
+		size_t unreferenced_vertex_count = 0;     // vertices not used by any triangle
+		buffer<unsigned int> unreferenced_vertex; // first vertices concerned
+
+		/** The mesh can be displayed: non empty, less than 10 millions vertices and triangles, coherent buffer sizes and valid indices
+		* (zero length edges and unreferenced vertices are reported but accepted) */
+		bool valid() const;
+	};
+
+	/** Check the mesh in O(N+T): triangles are checked in parallel, and referenced vertices are marked in a table
+	* max_reported bounds the number of elements listed for each kind of problem */
+	mesh_check_result mesh_validate(mesh const& m, int max_reported = 8);
+
+	/** Check if the mesh looks coherent (correct indexing and size of buffer, no degenerate triangle, etc)
+	* Prints a summary of the problems found by mesh_validate and returns its valid() */
 	bool mesh_check(mesh const& m);
+	std::string str(mesh_check_result const& result);
 
 
+	/** Neighbors of each vertex (sorted), the number of vertices is deduced from the largest index of the connectivity
+	* Use the csr_adjacency of mesh_vertex_one_ring to avoid one allocation per vertex */
 	buffer<buffer<unsigned int> > connectivity_one_ring(buffer<uint3> const& connectivity);
+	buffer<buffer<unsigned int> > connectivity_one_ring(buffer<uint3> const& connectivity, size_t N_vertex);
 
 	std::string str(mesh const& m);
 	std::string type_str(mesh const&);
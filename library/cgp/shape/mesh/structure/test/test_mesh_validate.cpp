@@ -0,0 +1,69 @@
+#include "test_mesh_validate.hpp"
+
+#include "cgp/base/base.hpp"
+#include "../mesh.hpp"
+#include "cgp/shape/mesh/primitive/mesh_primitive.hpp"
+
+namespace cgp_test
+{
+	void test_mesh_validate()
+	{
+		using namespace cgp;
+
+		// Valid mesh
+		{
+			mesh const m = mesh_primitive_grid({0,0,0}, {1,0,0}, {1,1,0}, {0,1,0}, 10, 10);
+			mesh_check_result const r = mesh_validate(m);
+			assert_cgp_no_msg(r.valid());
+			assert_cgp_no_msg(r.N_vertex==m.position.size() && r.N_triangle==m.connectivity.size());
+			assert_cgp_no_msg(!r.incoherent_normal && !r.incoherent_uv && !r.incoherent_color);
+			assert_cgp_no_msg(r.invalid_index_count==0 && r.zero_length_edge_count==0 && r.unreferenced_vertex_count==0);
+		}
+
+		// Empty mesh
+		{
+			mesh const m;
+			assert_cgp_no_msg(!mesh_validate(m).valid());
+		}
+
+		// Incoherent per-vertex buffers
+		{
+			mesh m = mesh_primitive_grid({0,0,0}, {1,0,0}, {1,1,0}, {0,1,0}, 4, 4);
+			m.uv.resize(m.uv.size()-1);
+			m.color.clear();
+			mesh_check_result const r = mesh_validate(m);
+			assert_cgp_no_msg(!r.valid());
+			assert_cgp_no_msg(!r.incoherent_normal && r.incoherent_uv && r.incoherent_color);
+		}
+
+		// Invalid indices, zero length edges and unreferenced vertices
+		{
+			mesh m;
+			m.position = { vec3(0,0,0), vec3(1,0,0), vec3(0,1,0), vec3(0,1,0), vec3(5,5,5) };
+			m.connectivity = { uint3(0,1,2), uint3(1,3,2), uint3(0,1,7) };
+			m.normal.resize(5);
+			m.uv.resize(5);
+			m.color.resize(5);
+			mesh_check_result const r = mesh_validate(m);
+			assert_cgp_no_msg(!r.valid());
+			assert_cgp_no_msg(r.invalid_index_count==1 && r.invalid_index.size()==1 && r.invalid_index[0]==2);
+			assert_cgp_no_msg(r.zero_length_edge_count==1 && is_equal(r.zero_length_edge[0], uint2(3,2)));
+			assert_cgp_no_msg(r.unreferenced_vertex_count==1 && r.unreferenced_vertex[0]==4);
+
+			// Zero length edges and unreferenced vertices alone are accepted
+			m.connectivity.resize(2);
+			assert_cgp_no_msg(mesh_validate(m).valid());
+		}
+
+		// Reported elements are bounded and listed in order (triangles checked by parallel ranges)
+		{
+			mesh m = mesh_primitive_grid({0,0,0}, {1,0,0}, {1,1,0}, {0,1,0}, 150, 150);
+			size_t const N = m.position.size();
+			for(int k=0; k<m.connectivity.size(); k+=100)
+				m.connectivity[k].y = unsigned(N+k);
+			mesh_check_result const r = mesh_validate(m, 3);
+			assert_cgp_no_msg(r.invalid_index_count==(m.connectivity.size()+99)/100);
+			assert_cgp_no_msg(r.invalid_index.size()==3 && r.invalid_index[0]==0 && r.invalid_index[1]==100 && r.invalid_index[2]==200);
+		}
+	}
+}
@@ -0,0 +1,123 @@
+#include "test_topology.hpp"
+
+#include "cgp/base/base.hpp"
+#include "../topology.hpp"
+#include "cgp/shape/mesh/primitive/mesh_primitive.hpp"
+
+namespace cgp_test
+{
+	namespace {
+		// Opposite half-edges are paired and join the same vertices in reverse order
+		bool is_coherent_opposite(cgp::mesh_topology const& t)
+		{
+			for(int h=0; h<int(t.half_edge_count()); ++h) {
+				int const o = t.opposite[h];
+				if(o>=0 && (t.opposite[o]!=h || t.origin(o)!=t.target(h) || t.target(o)!=t.origin(h)))
+					return false;
+			}
+			return true;
+		}
+	}
+
+	void test_topology()
+	{
+		using namespace cgp;
+
+		// Closed surface: tetrahedron
+		{
+			buffer<uint3> const connectivity = { uint3(0,2,1), uint3(0,1,3), uint3(0,3,2), uint3(1,2,3) };
+			mesh_topology t;
+			t.build(connectivity, 4);
+			assert_cgp_no_msg(t.half_edge_count()==12);
+			assert_cgp_no_msg(t.is_closed_manifold());
+			assert_cgp_no_msg(is_coherent_opposite(t));
+			for(int h=0; h<12; ++h)
+				assert_cgp_no_msg(t.opposite[h]>=0 && t.origin(t.vertex_half_edge[t.origin(h)])==t.origin(h));
+
+			buffer<unsigned int> ring, faces;
+			t.one_ring(0, ring);
+			t.vertex_faces(0, faces);
+			assert_cgp_no_msg(ring.size()==3 && faces.size()==3);
+
+			int3 const n = t.face_neighbors(3);
+			assert_cgp_no_msg(n[0]>=0 && n[1]>=0 && n[2]>=0 && n[0]!=n[1] && n[1]!=n[2] && n[0]!=n[2]);
+		}
+
+		// Open surface: grid with one boundary loop
+		{
+			int const Nu = 7, Nv = 5;
+			mesh const m = mesh_primitive_grid({0,0,0}, {1,0,0}, {1,1,0}, {0,1,0}, Nu, Nv);
+			mesh_topology t;
+			t.build(m.connectivity, m.position.size());
+			assert_cgp_no_msg(!t.is_closed_manifold());
+			assert_cgp_no_msg(is_coherent_opposite(t));
+			assert_cgp_no_msg(t.non_manifold_edge_count==0 && t.non_manifold_vertex_count==0);
+			assert_cgp_no_msg(t.boundary_loops.size()==1);
+			assert_cgp_no_msg(t.boundary_loops.degree(0)==2*(Nu-1)+2*(Nv-1));
+
+			// The loop is a chain of consecutive boundary half-edges
+			bool chained = true;
+			for(unsigned int const* it=t.boundary_loops.begin(0); it!=t.boundary_loops.end(0); ++it) {
+				int const h = int(*it);
+				int const h_next = t.boundary_next[h];
+				chained = chained && t.is_boundary_edge(h) && t.is_boundary_vertex(t.origin(h)) && h_next>=0 && t.origin(h_next)==t.target(h);
+			}
+			assert_cgp_no_msg(chained);
+
+			// Boundary vertices start their one ring on the boundary
+			size_t boundary_vertex = 0;
+			for(unsigned int v=0; v<m.position.size(); ++v) {
+				if(t.is_boundary_vertex(v)) {
+					boundary_vertex++;
+					assert_cgp_no_msg(t.is_boundary_edge(t.vertex_half_edge[v]));
+				}
+			}
+			assert_cgp_no_msg(boundary_vertex==t.boundary_loops.degree(0));
+
+			// Interior vertex: the rotation around it closes and the ring and faces have the same size
+			unsigned int const v = 2*Nv+2;
+			assert_cgp_no_msg(!t.is_boundary_vertex(v));
+			int const start = t.vertex_half_edge[v];
+			int h = start, count = 0;
+			do { h = t.rotate_ccw(h); count++; } while(h>=0 && h!=start && count<100);
+			assert_cgp_no_msg(h==start);
+			buffer<unsigned int> ring, faces;
+			t.one_ring(v, ring);
+			t.vertex_faces(v, faces);
+			assert_cgp_no_msg(int(ring.size())==count && int(faces.size())==count);
+		}
+
+		// Fan around a vertex of high valence: every spoke is paired, the rim is the boundary
+		{
+			int const N = 30000;
+			buffer<uint3> fan;
+			for(int k=0; k<N; ++k)
+				fan.push_back(uint3(0, k+1, (k+1)%N+1));
+			mesh_topology t;
+			t.build(fan, N+1);
+			assert_cgp_no_msg(is_coherent_opposite(t));
+			assert_cgp_no_msg(t.non_manifold_edge_count==0 && t.non_manifold_vertex_count==0);
+			assert_cgp_no_msg(t.boundary_loops.size()==1 && t.boundary_loops.degree(0)==unsigned(N));
+			assert_cgp_no_msg(!t.is_boundary_vertex(0));
+			buffer<unsigned int> ring;
+			t.one_ring(0, ring);
+			assert_cgp_no_msg(ring.size()==size_t(N));
+		}
+
+		// Non-manifold configurations
+		{
+			// Three faces sharing the edge (0,1)
+			buffer<uint3> const fin = { uint3(0,1,2), uint3(1,0,3), uint3(0,1,4) };
+			mesh_topology t;
+			t.build(fin, 5);
+			assert_cgp_no_msg(t.non_manifold_edge_count>0 && !t.is_closed_manifold());
+			assert_cgp_no_msg(is_coherent_opposite(t));
+
+			// Two triangles touching at vertex 0 only
+			buffer<uint3> const bowtie = { uint3(0,1,2), uint3(0,3,4) };
+			t.build(bowtie, 5);
+			assert_cgp_no_msg(t.non_manifold_vertex_count==1 && t.non_manifold_edge_count==0);
+			assert_cgp_no_msg(t.boundary_loops.size()==2);
+		}
+	}
+}
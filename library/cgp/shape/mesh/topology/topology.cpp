@@ -0,0 +1,227 @@
+#include "topology.hpp"
+
+#include "cgp/base/base.hpp"
+
+#include <vector>
+
+namespace cgp
+{
+	namespace
+	{
+		// Corner of the vertex v in the triangle t (the first one for degenerate triangles)
+		inline int corner_of(uint3 const& t, unsigned int v)
+		{
+			return t.x==v ? 0 : (t.y==v ? 1 : 2);
+		}
+	}
+
+	size_t mesh_topology::half_edge_count() const { return 3*connectivity.size(); }
+	int mesh_topology::next(int h) { return h%3==2 ? h-2 : h+1; }
+	int mesh_topology::previous(int h) { return h%3==0 ? h+2 : h-1; }
+	int mesh_topology::face(int h) { return h/3; }
+	unsigned int mesh_topology::origin(int h) const { return connectivity.data[h/3][h%3]; }
+	unsigned int mesh_topology::target(int h) const { return origin(next(h)); }
+
+	bool mesh_topology::is_boundary_edge(int h) const { return opposite.data[h]<0; }
+
+	bool mesh_topology::is_boundary_vertex(unsigned int v) const
+	{
+		int const h = vertex_half_edge.data[v];
+		return h>=0 && opposite.data[h]<0;
+	}
+
+	bool mesh_topology::is_closed_manifold() const
+	{
+		return boundary_loops.size()==0 && non_manifold_edge_count==0 && non_manifold_vertex_count==0;
+	}
+
+	int mesh_topology::rotate_ccw(int h) const
+	{
+		return opposite.data[previous(h)];
+	}
+
+	int mesh_topology::rotate_cw(int h) const
+	{
+		int const o = opposite.data[h];
+		return o<0 ? -1 : next(o);
+	}
+
+	void mesh_topology::one_ring(unsigned int v, buffer<unsigned int>& neighbors) const
+	{
+		neighbors.clear();
+		int const start = vertex_half_edge.data[v];
+		if(start<0)
+			return;
+
+		// Rotation from the start until coming back to it, or until the boundary (the start is then the first boundary half-edge)
+		int h = start;
+		int last = start;
+		do {
+			neighbors.push_back(target(h));
+			last = h;
+			h = rotate_ccw(h);
+		} while(h>=0 && h!=start);
+		if(h<0)
+			neighbors.push_back(origin(previous(last)));
+	}
+
+	void mesh_topology::vertex_faces(unsigned int v, buffer<unsigned int>& faces) const
+	{
+		faces.clear();
+		int const start = vertex_half_edge.data[v];
+		if(start<0)
+			return;
+		int h = start;
+		do {
+			faces.push_back(face(h));
+			h = rotate_ccw(h);
+		} while(h>=0 && h!=start);
+	}
+
+	int3 mesh_topology::face_neighbors(int f) const
+	{
+		int3 neighbors;
+		for(int j=0; j<3; ++j) {
+			int const o = opposite.data[3*f+j];
+			neighbors[j] = o<0 ? -1 : face(o);
+		}
+		return neighbors;
+	}
+
+	void mesh_topology::build(buffer<uint3> const& connectivity_arg, size_t N_vertex)
+	{
+		profile_zone_cgp("mesh topology");
+
+		connectivity = connectivity_arg;
+		int const N_half_edge = int(3*connectivity.size());
+		uint3 const* tri = connectivity.data.data();
+		auto vertex = [tri](int h) { return (&tri[h/3].x)[h%3]; };
+
+		opposite.resize(N_half_edge);
+		opposite.fill(-1);
+		boundary_next.resize(N_half_edge);
+		boundary_next.fill(-1);
+		vertex_half_edge.resize(int(N_vertex));
+		vertex_half_edge.fill(-1);
+
+		// Each half-edge is matched in the group of the smallest vertex of its edge: the faces around a give the half-edges
+		//  touching a, the groups are processed in parallel without conflicting writes.
+		csr_adjacency const vertex_to_face = mesh_vertex_to_face(connectivity, N_vertex);
+		std::vector<unsigned int> non_manifold_edge(N_vertex, 0);
+		std::vector<unsigned int> non_manifold_vertex(N_vertex, 0);
+		int* const opposite_of = opposite.data.data();
+		parallel_for(0, int(N_vertex), [&](int a) {
+
+			// Half-edges of the group (twice the valence of a), with the number of half-edges of their edge and the last one
+			struct group_entry { unsigned int other; int h; unsigned int count; unsigned int last; };
+			thread_local std::vector<group_entry> local_group;
+			// first[w]: entry of the group where the edge (a,w) is seen first, -1 otherwise (reset after each group)
+			thread_local std::vector<int> local_first;
+			std::vector<group_entry>& group = local_group;
+			std::vector<int>& first = local_first;
+			if(first.size()<N_vertex)
+				first.assign(N_vertex, -1);
+
+			group.clear();
+			for(unsigned int const* f=vertex_to_face.begin(a); f!=vertex_to_face.end(a); ++f) {
+				uint3 const& t = tri[*f];
+				int const j = corner_of(t, unsigned(a));
+				int const h_out = int(3*(*f))+j;     // a -> w
+				int const h_in = previous(h_out);    // u -> a
+				unsigned int const w = (&t.x)[next(j)], u = (&t.x)[previous(j)];
+				if(w>unsigned(a)) group.push_back({w, h_out, 0, 0});
+				if(u>unsigned(a)) group.push_back({u, h_in, 0, 0});
+			}
+
+			// Half-edges of the same edge are gathered on the first one in O(1) each
+			unsigned int const N_group = unsigned(group.size());
+			for(unsigned int k=0; k<N_group; ++k) {
+				int& k_first = first[group[k].other];
+				if(k_first<0)
+					k_first = int(k);
+				group[k_first].count++;
+				group[k_first].last = k;
+			}
+
+			for(unsigned int k=0; k<N_group; ++k) {
+				group_entry const& e = group[k];
+				if(first[e.other]!=int(k))
+					continue;
+				first[e.other] = -1;
+				int const h0 = e.h, h1 = group[e.last].h;
+				if(e.count==2 && vertex(h0)!=vertex(h1)) {
+					opposite_of[h0] = h1;
+					opposite_of[h1] = h0;
+				}
+				else if(e.count>1)
+					non_manifold_edge[a] += e.count;
+			}
+		});
+
+		// Outgoing half-edge of each vertex, a boundary one if any
+		int* const half_edge_of = vertex_half_edge.data.data();
+		parallel_for(0, int(N_vertex), [&](int v) {
+			for(unsigned int const* f=vertex_to_face.begin(v); f!=vertex_to_face.end(v); ++f) {
+				int const h = int(3*(*f))+corner_of(tri[*f], unsigned(v));
+				if(half_edge_of[v]<0 || opposite_of[h]<0)
+					half_edge_of[v] = h;
+				if(opposite_of[h]<0)
+					return;
+			}
+		});
+
+		// Non-manifold vertices: the fan reached by rotation doesn't contain all the faces of the vertex
+		parallel_for(0, int(N_vertex), [&](int v) {
+			int const start = half_edge_of[v];
+			if(start<0)
+				return;
+			unsigned int const degree = vertex_to_face.degree(v);
+			unsigned int fan = 0;
+			int h = start;
+			do {
+				fan++;
+				h = opposite_of[previous(h)];
+			} while(h>=0 && h!=start && fan<=degree);
+			if(fan!=degree)
+				non_manifold_vertex[v] = 1;
+		});
+
+		non_manifold_edge_count = 0;
+		non_manifold_vertex_count = 0;
+		for(size_t v=0; v<N_vertex; ++v) {
+			non_manifold_edge_count += non_manifold_edge[v];
+			non_manifold_vertex_count += non_manifold_vertex[v];
+		}
+
+		// Next boundary half-edge: the boundary half-edge leaving the target, found by rotating clockwise from next(h)
+		int* const boundary_next_of = boundary_next.data.data();
+		parallel_for(0, N_half_edge, [&](int h) {
+			if(opposite_of[h]>=0 || vertex(h)==vertex(next(h)))
+				return;
+			int g = next(h);
+			for(unsigned int step=0; opposite_of[g]>=0 && step<=vertex_to_face.degree(vertex(g)); ++step)
+				g = next(opposite_of[g]);
+			if(opposite_of[g]<0)
+				boundary_next_of[h] = g;
+		});
+
+		// Boundary loops
+		boundary_loops.offset.clear();
+		boundary_loops.index.clear();
+		boundary_loops.offset.push_back(0);
+		std::vector<unsigned char> visited(N_half_edge, 0);
+		for(int h=0; h<N_half_edge; ++h) {
+			if(boundary_next_of[h]<0 || visited[h])
+				continue;
+			int g = h;
+			while(g>=0 && !visited[g]) {
+				visited[g] = 1;
+				boundary_loops.index.push_back(unsigned(g));
+				g = boundary_next_of[g];
+			}
+			boundary_loops.offset.push_back(boundary_loops.index.size());
+		}
+		if(boundary_loops.offset.size()==1)
+			boundary_loops.offset.clear();
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "cgp/containers/containers.hpp"
+#include "../adjacency/adjacency.hpp"
+
+namespace cgp
+{
+	/** Directed-edge topology of a triangle mesh (compact half-edge structure stored in flat arrays)
+	* The half-edge h=3f+j goes from the corner j to the corner j+1 of the face f, so that next, previous, face and origin are
+	*  computed from h and the connectivity, and only the opposite half-edges are stored.
+	* Faces are expected to be oriented consistently (counter-clockwise): two half-edges are opposite if they join the same
+	*  vertices in opposite directions. Edges shared by more than two faces, or by two faces with the same direction, are
+	*  non-manifold: their half-edges are treated as boundaries.
+	* build() is linear in the number of triangles whatever the valences (parallel over the vertices, with a table of N_vertex
+	*  indices per thread to pair the half-edges), the queries below are O(1) except the ones
+	*  iterating on a one ring or a loop, which are O(1) per step. */
+	struct mesh_topology
+	{
+		buffer<uint3> connectivity;
+		/** Opposite half-edge of each half-edge, -1 on a boundary (or non-manifold) edge */
+		buffer<int> opposite;
+		/** One outgoing half-edge of each vertex, -1 if the vertex is not used. A boundary half-edge is chosen for boundary vertices. */
+		buffer<int> vertex_half_edge;
+		/** Next half-edge along the boundary loop for boundary half-edges, -1 for the others */
+		buffer<int> boundary_next;
+		/** Boundary loops given as lists of consecutive boundary half-edges */
+		csr_adjacency boundary_loops;
+
+		size_t non_manifold_edge_count = 0;   // number of half-edges left without opposite because their edge is not manifold
+		size_t non_manifold_vertex_count = 0; // vertices whose faces don't form a single fan
+
+		/** Build the topology of the connectivity with N_vertex vertices */
+		void build(buffer<uint3> const& connectivity, size_t N_vertex);
+
+		size_t half_edge_count() const;
+		static int next(int h);
+		static int previous(int h);
+		static int face(int h);
+		unsigned int origin(int h) const;
+		unsigned int target(int h) const;
+
+		bool is_boundary_edge(int h) const;
+		bool is_boundary_vertex(unsigned int v) const;
+		/** Closed 2-manifold surface: no boundary and no non-manifold edge or vertex */
+		bool is_closed_manifold() const;
+
+		/** Next outgoing half-edge around the origin of h in counter-clockwise (resp. clockwise) order, -1 when crossing a boundary */
+		int rotate_ccw(int h) const;
+		int rotate_cw(int h) const;
+
+		/** Neighbors of v in counter-clockwise order (the fan of vertex_half_edge[v] for non-manifold vertices) */
+		void one_ring(unsigned int v, buffer<unsigned int>& neighbors) const;
+		/** Faces around v in counter-clockwise order */
+		void vertex_faces(unsigned int v, buffer<unsigned int>& faces) const;
+		/** Faces adjacent to the face f through its three edges (-1 on boundaries) */
+		int3 face_neighbors(int f) const;
+	};
+}
@@ -0,0 +1,97 @@
+#include "test_vertex_cache.hpp"
+
+#include "cgp/base/base.hpp"
+#include "../vertex_cache.hpp"
+#include "cgp/shape/mesh/primitive/mesh_primitive.hpp"
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+namespace cgp_test
+{
+	namespace {
+		// Triangle rotated to start with its smallest index (keeps the orientation)
+		cgp::uint3 canonical(cgp::uint3 const& t)
+		{
+			if(t.x<=t.y && t.x<=t.z) return t;
+			if(t.y<=t.x && t.y<=t.z) return cgp::uint3(t.y, t.z, t.x);
+			return cgp::uint3(t.z, t.x, t.y);
+		}
+
+		std::vector<std::array<unsigned int,3> > sorted_triangles(cgp::buffer<cgp::uint3> const& connectivity)
+		{
+			std::vector<std::array<unsigned int,3> > triangles;
+			for(cgp::uint3 const& t : connectivity) {
+				cgp::uint3 const c = canonical(t);
+				triangles.push_back({ c.x, c.y, c.z });
+			}
+			std::sort(triangles.begin(), triangles.end());
+			return triangles;
+		}
+	}
+
+	void test_vertex_cache()
+	{
+		using namespace cgp;
+
+		mesh m = mesh_primitive_grid({0,0,0}, {1,0,0}, {1,1,0}, {0,1,0}, 60, 60);
+		std::mt19937 generator(5);
+		std::shuffle(m.connectivity.begin(), m.connectivity.end(), generator);
+		size_t const N = m.position.size();
+		float const acmr_shuffled = mesh_acmr(m.connectivity, N);
+
+		// Triangle order: same triangles with the same orientation, far fewer cache misses
+		{
+			buffer<uint3> const ordered = mesh_vertex_cache_order(m.connectivity, N);
+			assert_cgp_no_msg(ordered.size()==m.connectivity.size());
+			assert_cgp_no_msg(sorted_triangles(ordered)==sorted_triangles(m.connectivity));
+			float const acmr_ordered = mesh_acmr(ordered, N);
+			assert_cgp_no_msg(acmr_shuffled>2.0f);
+			assert_cgp_no_msg(acmr_ordered<0.9f);
+		}
+
+		// Vertex order: permutation following the first use of the vertices
+		{
+			buffer<uint3> connectivity = m.connectivity;
+			buffer<unsigned int> const order = mesh_vertex_fetch_order(connectivity, N);
+			assert_cgp_no_msg(order.size()==N);
+			std::vector<unsigned int> sorted(order.begin(), order.end());
+			std::sort(sorted.begin(), sorted.end());
+			bool permutation = true;
+			for(size_t k=0; k<N; ++k)
+				permutation = permutation && sorted[k]==k;
+			assert_cgp_no_msg(permutation);
+
+			bool same = true;
+			unsigned int next_new = 0;
+			for(int f=0; f<connectivity.size(); ++f) {
+				for(int j=0; j<3; ++j) {
+					unsigned int const v = connectivity[f][j];
+					same = same && order[v]==m.connectivity[f][j];
+					if(v==next_new) next_new++;
+					same = same && v<next_new;
+				}
+			}
+			assert_cgp_no_msg(same);
+		}
+
+		// Whole mesh: attributes follow their vertices
+		{
+			mesh optimized = m;
+			buffer<unsigned int> const order = mesh_optimize_vertex_cache(optimized);
+			assert_cgp_no_msg(optimized.position.size()==N && optimized.connectivity.size()==m.connectivity.size());
+			bool coherent = true;
+			for(size_t k=0; k<N; ++k)
+				coherent = coherent && is_equal(optimized.position[k], m.position[order[k]]) && is_equal(optimized.uv[k], m.uv[order[k]]);
+			assert_cgp_no_msg(coherent);
+
+			buffer<uint3> original;
+			for(uint3 const& t : optimized.connectivity)
+				original.push_back(uint3(order[t.x], order[t.y], order[t.z]));
+			assert_cgp_no_msg(sorted_triangles(original)==sorted_triangles(m.connectivity));
+			assert_cgp_no_msg(mesh_acmr(optimized.connectivity, N)<0.9f);
+		}
+	}
+}
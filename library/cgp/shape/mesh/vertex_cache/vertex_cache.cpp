@@ -0,0 +1,207 @@
+#include "vertex_cache.hpp"
+
+#include "cgp/base/base.hpp"
+#include "../adjacency/adjacency.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace cgp
+{
+	namespace
+	{
+		// Score of a vertex given its position in the LRU cache (-1 if not in the cache) and its number of remaining triangles
+		struct vertex_score_table
+		{
+			std::vector<float> cache;     // cache[position]
+			std::vector<float> valence;   // valence[remaining triangles], up to max_valence
+
+			static constexpr int max_valence = 32;
+
+			explicit vertex_score_table(int cache_size)
+			{
+				float const cache_decay_power = 1.5f;
+				float const last_triangle_score = 0.75f;
+				float const valence_boost_scale = 2.0f;
+				float const valence_boost_power = 0.5f;
+
+				cache.resize(cache_size);
+				for (int k = 0; k < cache_size; ++k) {
+					// The 3 vertices of the last triangle have a fixed score to avoid favoring one of its edges
+					if (k < 3)
+						cache[k] = last_triangle_score;
+					else
+						cache[k] = std::pow(1.0f - float(k - 3) / float(cache_size - 3), cache_decay_power);
+				}
+				valence.resize(max_valence + 1);
+				valence[0] = 0.0f;
+				for (int k = 1; k <= max_valence; ++k)
+					valence[k] = valence_boost_scale * std::pow(float(k), -valence_boost_power);
+			}
+
+			float operator()(int cache_position, unsigned int remaining) const
+			{
+				if (remaining == 0)
+					return -1.0f; // no triangle left
+				float const score_valence = remaining <= unsigned(max_valence) ? valence[remaining] : 2.0f / std::sqrt(float(remaining));
+				return (cache_position < 0 ? 0.0f : cache[cache_position]) + score_valence;
+			}
+		};
+	}
+
+	buffer<uint3> mesh_vertex_cache_order(buffer<uint3> const& connectivity, size_t N_vertex, int cache_size)
+	{
+		profile_zone_cgp("vertex cache order");
+		assert_cgp(cache_size > 3, "Vertex cache size must be larger than 3");
+
+		int const N_triangle = int(connectivity.size());
+		uint3 const* tri = connectivity.data.data();
+		vertex_score_table const score_of(cache_size);
+
+		// Remaining triangles of each vertex: the first remaining[v] entries of its list in vertex_to_face
+		csr_adjacency vertex_to_face = mesh_vertex_to_face(connectivity, N_vertex);
+		unsigned int const* offset = vertex_to_face.offset.data.data();
+		unsigned int* faces = vertex_to_face.index.data.data();
+		std::vector<unsigned int> remaining(N_vertex);
+		std::vector<int> cache_position(N_vertex, -1);
+		std::vector<float> vertex_score(N_vertex);
+		for (size_t v = 0; v < N_vertex; ++v) {
+			remaining[v] = offset[v+1] - offset[v];
+			vertex_score[v] = score_of(-1, remaining[v]);
+		}
+
+		std::vector<float> triangle_score(N_triangle);
+		std::vector<unsigned char> emitted(N_triangle, 0);
+		for (int f = 0; f < N_triangle; ++f)
+			triangle_score[f] = vertex_score[tri[f].x] + vertex_score[tri[f].y] + vertex_score[tri[f].z];
+
+		std::vector<unsigned int> cache, next_cache;
+		cache.reserve(cache_size + 3);
+		next_cache.reserve(cache_size + 3);
+
+		buffer<uint3> result;
+		result.resize(N_triangle);
+		int best = -1;
+		int cursor = 0; // triangles before the cursor are already emitted
+		for (int k = 0; k < N_triangle; ++k) {
+
+			// No candidate around the cache: take the next triangle in the input order
+			if (best < 0) {
+				while (emitted[cursor]) ++cursor;
+				best = cursor;
+			}
+
+			uint3 const& t = tri[best];
+			result.data[k] = t;
+			emitted[best] = 1;
+
+			// Remove the triangle from the lists of its vertices, and move them to the front of the cache
+			next_cache.clear();
+			for (int j = 0; j < 3; ++j) {
+				unsigned int const v = (&t.x)[j];
+				if (std::find(next_cache.begin(), next_cache.end(), v) != next_cache.end())
+					continue;
+				unsigned int* const list = faces + offset[v];
+				unsigned int* const last = list + remaining[v] - 1;
+				*std::find(list, last, unsigned(best)) = *last;
+				*last = unsigned(best);
+				remaining[v]--;
+				next_cache.push_back(v);
+			}
+			for (unsigned int v : cache)
+				if (v != t.x && v != t.y && v != t.z)
+					next_cache.push_back(v);
+
+			// Update the scores of the vertices whose cache position or valence changed (the ones evicted from the cache included)
+			for (size_t i = 0; i < next_cache.size(); ++i) {
+				unsigned int const v = next_cache[i];
+				cache_position[v] = i < size_t(cache_size) ? int(i) : -1;
+				float const score = score_of(cache_position[v], remaining[v]);
+				float const delta = score - vertex_score[v];
+				vertex_score[v] = score;
+				for (unsigned int const* f = faces + offset[v]; f != faces + offset[v] + remaining[v]; ++f)
+					triangle_score[*f] += delta;
+			}
+			if (next_cache.size() > size_t(cache_size))
+				next_cache.resize(cache_size);
+			std::swap(cache, next_cache);
+
+			// Best triangle around the cache
+			best = -1;
+			float best_score = -1.0f;
+			for (unsigned int v : cache) {
+				for (unsigned int const* f = faces + offset[v]; f != faces + offset[v] + remaining[v]; ++f) {
+					if (triangle_score[*f] > best_score) {
+						best_score = triangle_score[*f];
+						best = int(*f);
+					}
+				}
+			}
+		}
+		return result;
+	}
+
+	buffer<unsigned int> mesh_vertex_fetch_order(buffer<uint3>& connectivity, size_t N_vertex)
+	{
+		std::vector<int> index(N_vertex, -1);
+		buffer<unsigned int> order;
+		order.resize(N_vertex);
+		unsigned int count = 0;
+		for (uint3& t : connectivity) {
+			for (int j = 0; j < 3; ++j) {
+				unsigned int& v = (&t.x)[j];
+				if (index[v] < 0) {
+					index[v] = int(count);
+					order.data[count++] = v;
+				}
+				v = unsigned(index[v]);
+			}
+		}
+		for (size_t v = 0; v < N_vertex; ++v)
+			if (index[v] < 0)
+				order.data[count++] = unsigned(v);
+		return order;
+	}
+
+	buffer<unsigned int> mesh_optimize_vertex_cache(mesh& m, int cache_size)
+	{
+		size_t const N_vertex = m.position.size();
+		m.connectivity = mesh_vertex_cache_order(m.connectivity, N_vertex, cache_size);
+		buffer<unsigned int> const order = mesh_vertex_fetch_order(m.connectivity, N_vertex);
+
+		auto reorder = [&order, N_vertex](auto& attribute) {
+			if (attribute.size() != N_vertex)
+				return;
+			auto const previous = attribute;
+			for (size_t k = 0; k < N_vertex; ++k)
+				attribute.data[k] = previous.data[order.data[k]];
+		};
+		reorder(m.position);
+		reorder(m.normal);
+		reorder(m.color);
+		reorder(m.uv);
+
+		return order;
+	}
+
+	float mesh_acmr(buffer<uint3> const& connectivity, size_t N_vertex, int cache_size)
+	{
+		if (connectivity.size() == 0)
+			return 0.0f;
+
+		// FIFO cache: a vertex is in the cache if less than cache_size misses happened since it was loaded
+		std::vector<size_t> loaded(N_vertex, 0);
+		size_t misses = 0;
+		for (uint3 const& t : connectivity) {
+			for (int j = 0; j < 3; ++j) {
+				unsigned int const v = (&t.x)[j];
+				if (loaded[v] == 0 || misses - loaded[v] >= size_t(cache_size)) {
+					misses++;
+					loaded[v] = misses;
+				}
+			}
+		}
+		return float(misses) / float(connectivity.size());
+	}
+}
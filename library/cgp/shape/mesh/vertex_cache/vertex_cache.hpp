@@ -0,0 +1,24 @@
+#pragma once
+
+#include "../structure/mesh.hpp"
+
+namespace cgp
+{
+	/** Reorder the triangles to reuse the vertices already processed by the GPU (post-transform vertex cache)
+	* Greedy ordering of Tom Forsyth ("Linear-speed vertex cache optimisation"): the next triangle is the one with the best score
+	*  among the triangles of the vertices in a simulated LRU cache of cache_size vertices. The score of a vertex favors the recently
+	*  used vertices and the vertices with few remaining triangles. The vertex indices are not modified. */
+	buffer<uint3> mesh_vertex_cache_order(buffer<uint3> const& connectivity, size_t N_vertex, int cache_size = 32);
+
+	/** Renumber the vertices in the order of their first use by the triangles (unused vertices are placed at the end)
+	* The connectivity is modified in place, returns the order of the vertices: order[new index] = old index */
+	buffer<unsigned int> mesh_vertex_fetch_order(buffer<uint3>& connectivity, size_t N_vertex);
+
+	/** Reorder the triangles for the vertex cache, then the vertices (and all their attributes) for the vertex fetch
+	* Returns the order of the vertices (order[new index] = old index) to reorder data computed for the original mesh. */
+	buffer<unsigned int> mesh_optimize_vertex_cache(mesh& m, int cache_size = 32);
+
+	/** Average cache miss ratio: number of vertices processed per triangle with a FIFO vertex cache of cache_size entries
+	* (between 0.5 for a perfect order on a large regular mesh, and 3) */
+	float mesh_acmr(buffer<uint3> const& connectivity, size_t N_vertex, int cache_size = 16);
+}
@@ -0,0 +1,13 @@
+#include "adaptive_timestep.hpp"
+
+using namespace cgp;
+
+float max_position_distance(simulation_state const& a, simulation_state const& b) {
+
+	assert_cgp_no_msg(a.pos.size() == b.pos.size());
+
+	float d = 0.0f;
+	for(size_t k = 0; k < a.pos.size(); k++)
+		d = std::max(d, norm(a.pos[k] - b.pos[k]));
+	return d;
+}
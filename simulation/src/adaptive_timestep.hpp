@@ -0,0 +1,131 @@
+#pragma once
+
+#include "cgp/cgp.hpp"
+
+// Snapshot of the particles used to roll back a rejected step
+struct simulation_state {
+
+	std::vector<cgp::vec3> pos;
+	std::vector<cgp::vec3> vel;
+};
+
+// Largest distance between the positions of two states
+float max_position_distance(simulation_state const& a, simulation_state const& b);
+
+enum adaptive_error_type {
+	adaptive_error_cfl = 0,				// dt bounded by the spring CFL condition and the particle speeds
+	adaptive_error_step_doubling = 1	// local error estimated by comparing one step of h with two steps of h/2
+};
+
+// Statistics of the steps taken during the last call to advance()
+struct adaptive_timestep_statistics {
+
+	int accepted = 0;
+	int rejected = 0;
+	float dtMin = 0.0f;
+	float dtMax = 0.0f;
+	float dtLast = 0.0f;
+	float errorLast = 0.0f;
+	float truncated = 0.0f;		// duration left when maxSubsteps is reached (not simulated)
+};
+
+// Adaptive time step controller: splits a frame duration in substeps whose size grows during calm periods and
+//  shrinks during impacts. Unstable steps (or steps with an error above tolerance) are rolled back and retried.
+struct adaptive_timestep {
+
+	int errorType = adaptive_error_cfl;
+	float dtMin = 1e-4f;
+	float dtMax = 0.02f;
+	float tolerance = 1e-3f;	// maximal local position error (step doubling)
+	float cfl = 0.5f;			// fraction of the stability bound used (CFL)
+	float grow = 1.5f;			// maximal growth of dt between two steps
+	float shrink = 0.5f;		// reduction of dt after a rejected step
+	int maxSubsteps = 200;		// hard limit of substeps per frame
+	bool quantize = false;		// restrict the steps to duration/2^k, for solvers caching a factorization per step size
+
+	float dt = 0.01f;			// current step size, kept between frames
+	adaptive_timestep_statistics stats;
+
+	// Advance the system by the given duration and return the time actually simulated, shorter than the duration
+	//  when maxSubsteps is reached (the remainder is reported in stats.truncated). SYSTEM must provide:
+	//  void save_state(simulation_state&) const; void restore_state(simulation_state const&);
+	//  void simulation_integrate(float dt); bool is_stable() const; float stable_timestep() const;
+	//  void simulation_accept(float dt), called once per accepted step to update the state that must not
+	//  see the rejected or trial integrations (sleeping islands).
+	template <typename SYSTEM>
+	float advance(SYSTEM& system, float duration);
+
+private:
+	simulation_state start, coarse, fine;
+};
+
+
+template <typename SYSTEM>
+float adaptive_timestep::advance(SYSTEM& system, float duration) {
+
+	stats = adaptive_timestep_statistics();
+	stats.dtMin = dtMax;
+
+	float remaining = duration;
+	while(remaining > 1e-7f && stats.accepted < maxSubsteps) {
+
+		if(errorType == adaptive_error_cfl)
+			dt = std::min(dt, cfl * system.stable_timestep());
+		dt = std::max(dtMin, std::min(dt, dtMax));
+		// Remaining duration split evenly in steps no larger than dt
+		float h = remaining / std::max(1.0f, std::ceil(remaining / dt - 1e-3f));
+		if(quantize) {
+			// Nearest duration/2^k to dt (a floor would never grow back with grow < 2).
+			//  The remaining duration stays a multiple of the finest step taken.
+			h = duration;
+			while((h > 1.4142f * dt && 0.5f * h >= dtMin) || h > remaining * (1 + 1e-3f))
+				h *= 0.5f;
+		}
+
+		system.save_state(start);
+		float error = 0.0f;
+		if(errorType == adaptive_error_step_doubling) {
+
+			system.simulation_integrate(h);
+			system.save_state(coarse);
+			system.restore_state(start);
+			system.simulation_integrate(h / 2);
+			system.simulation_integrate(h / 2);
+
+			system.save_state(fine);
+			error = max_position_distance(coarse, fine);
+		}
+		else
+			system.simulation_integrate(h);
+
+		bool const unstable = !system.is_stable();
+		if((unstable || error > tolerance) && h > dtMin) {
+
+			// Roll back and retry with a smaller step
+			system.restore_state(start);
+			dt = std::max(dtMin, h * shrink);
+			stats.rejected++;
+			continue;
+		}
+
+		system.simulation_accept(h);
+		remaining -= h;
+		stats.accepted++;
+		stats.dtMin = std::min(stats.dtMin, h);
+		stats.dtMax = std::max(stats.dtMax, h);
+		stats.dtLast = h;
+		stats.errorLast = error;
+
+		// Next step size: the local error of a second order scheme scales as h^3
+		if(errorType == adaptive_error_step_doubling && error > 0)
+			dt = h * std::min(grow, 0.9f * std::cbrt(tolerance / error));
+		else
+			dt = dt * grow;
+	}
+
+	if(remaining > 1e-7f) {
+		stats.truncated = remaining;
+		return duration - remaining;
+	}
+	return duration;
+}
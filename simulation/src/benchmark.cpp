@@ -0,0 +1,172 @@
+#include "benchmark.hpp"
+#include "scene.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <iostream>
+
+using namespace cgp;
+
+// Lattice of n^3 particles linked to their 6 neighbours, created in a random order as after many
+//  topology edits (the worst case for the cache)
+static void benchmark_lattice(scene_structure& scene, int n) {
+
+	int const N = n*n*n;
+	std::vector<unsigned int> order(N);
+	for(int k = 0; k < N; k++) order[k] = k;
+	std::shuffle(order.begin(), order.end(), std::mt19937(42));
+	std::vector<unsigned int> const index = inverse_permutation(order);
+
+	float const spacing = 0.1f;
+	unsigned short const material = spring_material_index(scene.materials, 3.0f, 0.01f);
+	scene.particles.clear();
+	scene.particles.reserve(N);
+	for(int k = 0; k < N; k++) {
+
+		int const l = order[k];
+		int const x = l % n, y = (l / n) % n, z = l / (n*n);
+		scene.particles.push_back(particle(0.01f, spacing * vec3(x, y, z + 1), { 0,0,0 }));
+
+		int const neighbours[6][3] = { {-1,0,0}, {1,0,0}, {0,-1,0}, {0,1,0}, {0,0,-1}, {0,0,1} };
+		for(auto const& d : neighbours) {
+			int const xn = x + d[0], yn = y + d[1], zn = z + d[2];
+			if(xn < 0 || yn < 0 || zn < 0 || xn >= n || yn >= n || zn >= n) continue;
+			scene.particles.back().springs.push_back(spring(index[xn + n*(yn + n*zn)], material, spacing));
+		}
+	}
+	scene.topologyVersion++;
+	scene.islands_build();
+	scene.projective_dynamics_initialize();
+}
+
+// Mean distance in memory between the two endpoints of a spring, in bytes
+static double spring_stride(std::vector<particle> const& particles) {
+
+	double sum = 0;
+	size_t count = 0;
+	for(size_t i = 0; i < particles.size(); i++)
+		for(const spring& s : particles[i].springs) {
+			sum += std::abs(double(s.other) - double(i));
+			count++;
+		}
+	return count > 0 ? sum / count * sizeof(particle) : 0;
+}
+
+// Mean duration of a step in milliseconds
+static double benchmark_steps(scene_structure& scene, int steps) {
+
+	scene.simulation_step(0.005f);
+	auto const start = std::chrono::steady_clock::now();
+	for(int k = 0; k < steps; k++)
+		scene.simulation_step(0.005f);
+	auto const end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / steps;
+}
+
+// Step duration before and after reordering a shuffled lattice. The Cholesky factor of Projective Dynamics
+//  does not fit in memory for a million particles, its lattice is smaller.
+static void benchmark_reorder() {
+
+	struct configuration { int solver; int n; int steps; };
+	for(configuration const& c : { configuration{ solver_mass_spring, 100, 10 }, configuration{ solver_projective_dynamics, 30, 10 } }) {
+
+		int const solver = c.solver, n = c.n, steps = c.steps;
+		scene_structure scene;
+		scene.parameters.solver = solver;
+		scene.parameters.sleeping = false;
+		benchmark_lattice(scene, n);
+
+		double const strideBefore = spring_stride(scene.particles);
+		double const before = benchmark_steps(scene, steps);
+
+		auto const start = std::chrono::steady_clock::now();
+		scene.reorder_particles();
+		double const reorderTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		double const strideAfter = spring_stride(scene.particles);
+		double const after = benchmark_steps(scene, steps);
+
+		std::cout << "Benchmark reorder: " << (solver == solver_mass_spring ? "mass-spring" : "Projective Dynamics");
+		std::cout << ", " << n*n*n << " particles, " << steps << " steps" << std::endl;
+		std::cout << "    spring endpoint distance: " << strideBefore / 1024 << " KiB -> " << strideAfter / 1024 << " KiB" << std::endl;
+		std::cout << "    step: " << before << " ms -> " << after << " ms (x" << before / after << "), reordering took " << reorderTime << " ms" << std::endl;
+	}
+}
+
+// Bytes of positions read from memory relative to the size of the positions (1 is ideal): the vertices missing in a
+//  FIFO post-transform cache of 16 entries are read by 64 bytes lines through a FIFO cache of 64 lines
+static double fetch_overfetch(buffer<uint3> const& connectivity, size_t N) {
+
+	size_t const lineSize = 64, lineCount = 64, vertexCache = 16;
+	std::vector<size_t> vertexLoaded(N, 0), lineLoaded((N * sizeof(vec3)) / lineSize + 2, 0);
+	size_t vertexMisses = 0, lineMisses = 0;
+	for(const uint3& t : connectivity)
+		for(int j = 0; j < 3; j++) {
+			unsigned int const v = t[j];
+			if(vertexLoaded[v] != 0 && vertexMisses - vertexLoaded[v] < vertexCache) continue;
+			vertexLoaded[v] = ++vertexMisses;
+			for(size_t line = v * sizeof(vec3) / lineSize; line <= ((v + 1) * sizeof(vec3) - 1) / lineSize; line++) {
+				if(lineLoaded[line] != 0 && lineMisses - lineLoaded[line] < lineCount) continue;
+				lineLoaded[line] = ++lineMisses;
+			}
+		}
+	return N > 0 ? double(lineMisses * lineSize) / double(N * sizeof(vec3)) : 0;
+}
+
+// Average cache miss ratio (vertices processed per triangle) of a mesh produced by marching cubes and of a mesh whose
+//  triangles are in an arbitrary order (as in many OBJ files), before and after the vertex cache and fetch optimisation
+static void benchmark_vertex_cache() {
+
+	int const n = 160;
+	spatial_domain_grid_3D const domain = spatial_domain_grid_3D::from_center_length({ 0,0,0 }, { 2,2,2 }, { n,n,n });
+	grid_3D<float> field;
+	field.resize(domain.samples);
+	for(int z = 0; z < n; z++)
+		for(int y = 0; y < n; y++)
+			for(int x = 0; x < n; x++) {
+				vec3 const p = domain.position({ x,y,z });
+				field(x,y,z) = norm(p) + 0.1f * std::sin(8*p.x) * std::cos(7*p.y) * std::sin(5*p.z);
+			}
+
+	mesh shuffled = mesh_primitive_sphere(1.0f, { 0,0,0 }, 800, 400);
+	std::shuffle(shuffled.connectivity.begin(), shuffled.connectivity.end(), std::mt19937(42));
+
+	std::vector<std::pair<std::string, mesh> > const meshes = { { "marching cube", marching_cube(field, domain, 0.7f) }, { "shuffled sphere", shuffled } };
+	for(auto const& entry : meshes) {
+
+		mesh m = entry.second;
+		size_t const N = m.position.size();
+		float const before16 = mesh_acmr(m.connectivity, N, 16), before32 = mesh_acmr(m.connectivity, N, 32);
+		double const overfetchBefore = fetch_overfetch(m.connectivity, N);
+
+		auto const start = std::chrono::steady_clock::now();
+		mesh_optimize_vertex_cache(m);
+		double const optimizeTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << "Benchmark vertex cache: " << entry.first << ", " << m.connectivity.size() << " triangles, " << N << " vertices" << std::endl;
+		std::cout << "    ACMR (FIFO 16): " << before16 << " -> " << mesh_acmr(m.connectivity, N, 16) << std::endl;
+		std::cout << "    ACMR (FIFO 32): " << before32 << " -> " << mesh_acmr(m.connectivity, N, 32) << std::endl;
+		std::cout << "    position overfetch: " << overfetchBefore << " -> " << fetch_overfetch(m.connectivity, N) << ", optimisation took " << optimizeTime << " ms" << std::endl;
+	}
+}
+
+int benchmark_run(std::string const& name) {
+
+	bool found = false;
+	if(name == "reorder" || name == "all") {
+		benchmark_reorder();
+		found = true;
+	}
+	if(name == "vertex_cache" || name == "all") {
+		benchmark_vertex_cache();
+		found = true;
+	}
+
+	if(!found) {
+		std::cout << "Benchmark: unknown benchmark " << name << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+
+// Command line benchmarks, run without opening a window: simulation --benchmark [name]
+//  Available names: reorder, vertex_cache, all
+int benchmark_run(std::string const& name);
@@ -0,0 +1,212 @@
+#include "checkpoint.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+using namespace cgp;
+
+static const char checkpoint_magic[8] = { 'S','B','C','K','P','T',0,0 };
+
+static uint64_t align(uint64_t offset) {
+
+	return (offset + checkpoint_alignment - 1) / checkpoint_alignment * checkpoint_alignment;
+}
+
+// Write a section at its offset (the gap since the current position is zero-padded)
+static bool write_section(std::FILE* file, uint64_t& position, uint64_t offset, void const* data, size_t size) {
+
+	static const char padding[checkpoint_alignment] = {};
+	if(offset > position && std::fwrite(padding, 1, size_t(offset - position), file) != offset - position)
+		return false;
+	if(size > 0 && std::fwrite(data, 1, size, file) != size)
+		return false;
+	position = offset + size;
+	return true;
+}
+
+bool checkpoint_save(scene_structure const& scene, std::string const& filename) {
+
+	std::vector<particle> const& particles = scene.particles;
+	uint64_t const N = particles.size();
+
+	// Stage each section contiguously so that it is written in a single call
+	std::vector<float> masses(N);
+	std::vector<vec3> positions(N), velocities(N);
+	std::vector<uint32_t> springOffsets(N + 1);
+	std::vector<checkpoint_spring> springs;
+	springOffsets[0] = 0;
+	for(uint64_t k = 0; k < N; k++) {
+
+		particle const& p = particles[k];
+		masses[k] = p.mass;
+		positions[k] = p.pos;
+		velocities[k] = p.vel;
+		for(const spring& s : p.springs)
+			springs.push_back({ s.other, s.L0, s.material, s.isDrawn ? 1u : 0u });
+		springOffsets[k+1] = uint32_t(springs.size());
+	}
+	std::vector<uint32_t> cubes(scene.cubes.begin(), scene.cubes.end());
+
+	void const* sectionData[checkpoint_section_count] = { masses.data(), positions.data(), velocities.data(), springOffsets.data(), springs.data(), cubes.data() };
+	size_t const sectionSize[checkpoint_section_count] = {
+		N * sizeof(float), N * sizeof(vec3), N * sizeof(vec3), (N + 1) * sizeof(uint32_t), springs.size() * sizeof(checkpoint_spring), cubes.size() * sizeof(uint32_t) };
+
+	checkpoint_header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, checkpoint_magic, sizeof(header.magic));
+	header.version = checkpoint_version;
+	header.headerSize = sizeof(checkpoint_header);
+	header.particleCount = N;
+	header.springCount = springs.size();
+	header.cubeCount = cubes.size() / 8;
+
+	uint64_t offset = align(sizeof(checkpoint_header));
+	for(int s = 0; s < checkpoint_section_count; s++) {
+		header.sectionOffset[s] = offset;
+		offset = align(offset + sectionSize[s]);
+	}
+	header.materialCount = scene.materials.size();
+	header.materialOffset = offset;
+	header.fileSize = header.materialOffset + scene.materials.size() * sizeof(spring_material);
+
+	simulation_parameters const& parameters = scene.parameters;
+	header.gravity = parameters.gy;
+	header.stiffness = parameters.sK;
+	header.damping = parameters.sMu;
+	header.solver = parameters.solver;
+	header.pdIterations = parameters.pdIterations;
+	header.sleeping = parameters.sleeping;
+	header.adaptive = parameters.adaptive;
+	header.adaptiveError = parameters.adaptiveError;
+	header.adaptiveDt = scene.stepper.dt;
+	header.time = scene.simulationTime;
+	header.timeScale = parameters.timeScale;
+
+	std::FILE* file = std::fopen(filename.c_str(), "wb");
+	if(file == nullptr) {
+		std::cout << "Checkpoint: cannot open " << filename << " for writing" << std::endl;
+		return false;
+	}
+
+	bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+	uint64_t position = sizeof(header);
+	for(int s = 0; ok && s < checkpoint_section_count; s++)
+		ok = write_section(file, position, header.sectionOffset[s], sectionData[s], sectionSize[s]);
+	ok = ok && write_section(file, position, header.materialOffset, scene.materials.data(), scene.materials.size() * sizeof(spring_material));
+	ok = (std::fclose(file) == 0) && ok;
+
+	if(!ok)
+		std::cout << "Checkpoint: failed to write " << filename << std::endl;
+	return ok;
+}
+
+bool checkpoint_load(scene_structure& scene, std::string const& filename) {
+
+	mapped_file file;
+	if(!file.open(filename)) {
+		std::cout << "Checkpoint: cannot map " << filename << std::endl;
+		return false;
+	}
+
+	// Validate the header and the bounds of every section before touching the scene
+	checkpoint_header header;
+	if(file.size() < sizeof(checkpoint_header)) {
+		std::cout << "Checkpoint: " << filename << " is too small" << std::endl;
+		return false;
+	}
+	std::memcpy(&header, file.data(), sizeof(checkpoint_header));
+	if(std::memcmp(header.magic, checkpoint_magic, sizeof(header.magic)) != 0) {
+		std::cout << "Checkpoint: " << filename << " is not a checkpoint file" << std::endl;
+		return false;
+	}
+	if(header.version != checkpoint_version) {
+		std::cout << "Checkpoint: unsupported version " << header.version << " (expected " << checkpoint_version << ")" << std::endl;
+		return false;
+	}
+	if(header.headerSize != sizeof(checkpoint_header)) {
+		std::cout << "Checkpoint: " << filename << " has an invalid header" << std::endl;
+		return false;
+	}
+
+	// Counts are compared to the space left after the offset, so that no product or sum of values read from the file can wrap
+	uint64_t const N = header.particleCount;
+	uint64_t const size = file.size();
+	auto fits = [size](uint64_t offset, uint64_t count, uint64_t elementSize) {
+		return offset % checkpoint_alignment == 0 && offset <= size && count <= (size - offset) / elementSize;
+	};
+	bool valid = header.fileSize == size
+		&& fits(header.sectionOffset[checkpoint_masses], N, sizeof(float))
+		&& fits(header.sectionOffset[checkpoint_positions], N, sizeof(vec3))
+		&& fits(header.sectionOffset[checkpoint_velocities], N, sizeof(vec3))
+		&& fits(header.sectionOffset[checkpoint_spring_offsets], N + 1, sizeof(uint32_t))		// N <= size: no wrap
+		&& fits(header.sectionOffset[checkpoint_springs], header.springCount, sizeof(checkpoint_spring))
+		&& fits(header.sectionOffset[checkpoint_cubes], header.cubeCount, 8 * sizeof(uint32_t))
+		&& header.materialCount <= std::numeric_limits<unsigned short>::max() + 1u
+		&& fits(header.materialOffset, header.materialCount, sizeof(spring_material));
+	if(!valid) {
+		std::cout << "Checkpoint: " << filename << " is truncated or corrupted" << std::endl;
+		return false;
+	}
+
+	char const* data = file.data();
+	float const* masses = reinterpret_cast<float const*>(data + header.sectionOffset[checkpoint_masses]);
+	vec3 const* positions = reinterpret_cast<vec3 const*>(data + header.sectionOffset[checkpoint_positions]);
+	vec3 const* velocities = reinterpret_cast<vec3 const*>(data + header.sectionOffset[checkpoint_velocities]);
+	uint32_t const* springOffsets = reinterpret_cast<uint32_t const*>(data + header.sectionOffset[checkpoint_spring_offsets]);
+	uint32_t const* cubes = reinterpret_cast<uint32_t const*>(data + header.sectionOffset[checkpoint_cubes]);
+
+	// The counts are bounded by the size of the file from here
+	std::vector<checkpoint_spring> records(header.springCount);
+	if(header.springCount > 0)
+		std::memcpy(records.data(), data + header.sectionOffset[checkpoint_springs], header.springCount * sizeof(checkpoint_spring));
+	std::vector<spring_material> materials(header.materialCount);
+	if(header.materialCount > 0)
+		std::memcpy(materials.data(), data + header.materialOffset, header.materialCount * sizeof(spring_material));
+
+	valid = springOffsets[0] == 0 && springOffsets[N] == header.springCount;
+	for(uint64_t k = 0; valid && k < N; k++)
+		valid = springOffsets[k] <= springOffsets[k+1];
+	for(uint64_t s = 0; valid && s < header.springCount; s++)
+		valid = records[s].other < N && records[s].material < materials.size();
+	std::vector<unsigned int> corners(cubes, cubes + 8 * header.cubeCount);
+	for(unsigned int c : corners)
+		valid = valid && c < N;
+	if(!valid) {
+		std::cout << "Checkpoint: " << filename << " has an invalid spring topology" << std::endl;
+		return false;
+	}
+
+	std::vector<particle> particles;
+	particles.reserve(N);
+	for(uint64_t k = 0; k < N; k++) {
+
+		particles.push_back(particle(masses[k], positions[k], velocities[k]));
+		std::vector<spring>& particleSprings = particles.back().springs;
+		particleSprings.reserve(springOffsets[k+1] - springOffsets[k]);
+		for(uint32_t s = springOffsets[k]; s < springOffsets[k+1]; s++)
+			particleSprings.push_back(spring(records[s].other, (unsigned short)records[s].material, records[s].L0, records[s].isDrawn != 0));
+	}
+	scene.particles.swap(particles);
+	scene.materials.swap(materials);
+	scene.cubes.swap(corners);
+
+	simulation_parameters& parameters = scene.parameters;
+	parameters.gy = header.gravity;
+	parameters.sK = header.stiffness;
+	parameters.sMu = header.damping;
+	parameters.solver = header.solver;
+	parameters.pdIterations = header.pdIterations;
+	parameters.sleeping = header.sleeping != 0;
+	parameters.adaptive = header.adaptive != 0;
+	parameters.adaptiveError = header.adaptiveError;
+	parameters.timeScale = header.timeScale;
+	scene.stepper.dt = header.adaptiveDt;
+	scene.simulationTime = header.time;
+	scene.parametersVersion++;
+	scene.topologyVersion++;
+
+	scene.islands_build();
+	scene.projective_dynamics_initialize();
+	return true;
+}
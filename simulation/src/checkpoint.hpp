@@ -0,0 +1,79 @@
+#pragma once
+
+#include "scene.hpp"
+
+#include <cstdint>
+
+// Versioned binary snapshot of the particle system (particles, spring topology, parameters and timer).
+//  File layout, every section starting on a checkpoint_alignment boundary:
+//    checkpoint_header
+//    masses         float[particleCount]
+//    positions      vec3[particleCount]
+//    velocities     vec3[particleCount]
+//    springOffsets  uint32[particleCount+1]  (springs of particle i are [springOffsets[i], springOffsets[i+1]) )
+//    springs        checkpoint_spring[springCount]
+//    cubes          uint32[8*cubeCount]  (corner indices)
+//    materials      spring_material[materialCount]
+//  Sections are written with one large sequential write each and read back through a memory mapping.
+//  Only files of the current version are loaded.
+
+constexpr uint32_t checkpoint_version = 1;
+constexpr uint64_t checkpoint_alignment = 64;
+
+enum checkpoint_section {
+	checkpoint_masses = 0,
+	checkpoint_positions,
+	checkpoint_velocities,
+	checkpoint_spring_offsets,
+	checkpoint_springs,
+	checkpoint_cubes,
+	checkpoint_section_count
+};
+
+struct checkpoint_spring {
+
+	uint32_t other;
+	float L0;
+	uint32_t material;
+	uint32_t isDrawn;
+};
+
+struct checkpoint_header {
+
+	char magic[8];				// "SBCKPT" followed by zeros
+	uint32_t version;
+	uint32_t headerSize;
+	uint64_t fileSize;
+
+	uint64_t particleCount;
+	uint64_t springCount;
+	uint64_t cubeCount;
+	uint64_t sectionOffset[checkpoint_section_count];
+
+	// Parameters
+	float gravity;
+	float stiffness;
+	float damping;
+	int32_t solver;
+	int32_t pdIterations;
+	int32_t sleeping;
+	int32_t adaptive;
+	int32_t adaptiveError;
+	float adaptiveDt;
+
+	// Timer
+	float time;
+	float timeScale;
+
+	// Spring materials
+	uint64_t materialCount;
+	uint64_t materialOffset;
+};
+
+// Both functions access the particle system: while the simulation thread runs they must be sent as commands.
+
+// Write the current state of the scene. Return false if the file cannot be written.
+bool checkpoint_save(scene_structure const& scene, std::string const& filename);
+
+// Restore the scene from a checkpoint. The scene is left unchanged and false is returned if the file is invalid.
+bool checkpoint_load(scene_structure& scene, std::string const& filename);
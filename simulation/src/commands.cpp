@@ -0,0 +1,101 @@
+#include "commands.hpp"
+
+using namespace cgp;
+
+bool simulation_parameters::operator==(simulation_parameters const& other) const {
+
+	return gy == other.gy && sK == other.sK && sMu == other.sMu && solver == other.solver && pdIterations == other.pdIterations
+		&& sleeping == other.sleeping && adaptive == other.adaptive && adaptiveError == other.adaptiveError && timeScale == other.timeScale
+		&& reorder == other.reorder && reorderInterval == other.reorderInterval;
+}
+
+simulation_command simulation_command::impulse(vec3 const& velocity) {
+
+	simulation_command c;
+	c.type = command_impulse;
+	c.vector = velocity;
+	return c;
+}
+
+simulation_command simulation_command::set_parameters(simulation_parameters const& parameters) {
+
+	simulation_command c;
+	c.type = command_parameters;
+	c.parameters = parameters;
+	return c;
+}
+
+simulation_command simulation_command::update_springs(float K, float mu) {
+
+	simulation_command c;
+	c.type = command_update_springs;
+	c.K = K;
+	c.mu = mu;
+	return c;
+}
+
+simulation_command simulation_command::add_cube(vec3 const& center, float K, float mu) {
+
+	simulation_command c;
+	c.type = command_add_cube;
+	c.vector = center;
+	c.K = K;
+	c.mu = mu;
+	return c;
+}
+
+simulation_command simulation_command::pin(unsigned int particle, vec3 const& target) {
+
+	simulation_command c;
+	c.type = command_pin;
+	c.particle = particle;
+	c.vector = target;
+	return c;
+}
+
+simulation_command simulation_command::unpin(unsigned int particle) {
+
+	simulation_command c;
+	c.type = command_unpin;
+	c.particle = particle;
+	return c;
+}
+
+simulation_command simulation_command::unpin_all() {
+
+	simulation_command c;
+	c.type = command_unpin_all;
+	return c;
+}
+
+simulation_command simulation_command::checkpoint_save(std::string const& filename) {
+
+	simulation_command c;
+	c.type = command_checkpoint_save;
+	c.filename = filename;
+	return c;
+}
+
+simulation_command simulation_command::checkpoint_load(std::string const& filename) {
+
+	simulation_command c;
+	c.type = command_checkpoint_load;
+	c.filename = filename;
+	return c;
+}
+
+simulation_command simulation_command::record_start(std::string const& filename, int encoding) {
+
+	simulation_command c;
+	c.type = command_record_start;
+	c.filename = filename;
+	c.encoding = encoding;
+	return c;
+}
+
+simulation_command simulation_command::record_stop() {
+
+	simulation_command c;
+	c.type = command_record_stop;
+	return c;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "cgp/cgp.hpp"
+#include "adaptive_timestep.hpp"
+
+enum solver_type {
+	solver_mass_spring = 0,
+	solver_projective_dynamics = 1
+};
+
+// Parameters used by the solver, sent by the GUI whenever they change
+struct simulation_parameters {
+	float gy = -9.81f;
+	float sK = 3.0f;
+	float sMu = 0.01f;
+	int solver = solver_mass_spring;
+	int pdIterations = 10;
+	bool sleeping = true;
+	bool adaptive = false;
+	int adaptiveError = adaptive_error_cfl;
+	float timeScale = 1.0f;
+	bool reorder = false;			// spatial reordering of the particles (see scene_structure::reorder_particles)
+	int reorderInterval = 600;		// steps between two reorderings, 0 to only reorder after topology changes
+
+	bool operator==(simulation_parameters const& other) const;
+};
+
+enum command_type {
+	command_impulse,			// velocity added to every particle (vector)
+	command_parameters,			// new solver parameters (parameters)
+	command_update_springs,		// stiffness and damping written into the springs (K, mu)
+	command_add_cube,			// new cube body (vector: center, K, mu)
+	command_pin,				// particle held at a position (particle id, vector: target)
+	command_unpin,				// release a pinned particle (particle id)
+	command_unpin_all,
+	command_checkpoint_save,	// (filename)
+	command_checkpoint_load,	// (filename)
+	command_record_start,		// (filename, encoding)
+	command_record_stop
+};
+
+// Typed request produced by the GUI or the input events, queued into the solver and applied between two steps.
+//  Commands carry plain values only, so they can be recorded, replayed or batched by headless tools.
+struct simulation_command {
+
+	command_type type = command_impulse;
+	cgp::vec3 vector;
+	float K = 0.0f;
+	float mu = 0.0f;
+	unsigned int particle = 0;		// stable id of the particle (see scene_structure::particleId)
+	int encoding = 0;
+	simulation_parameters parameters;
+	std::string filename;
+
+	static simulation_command impulse(cgp::vec3 const& velocity);
+	static simulation_command set_parameters(simulation_parameters const& parameters);
+	static simulation_command update_springs(float K, float mu);
+	static simulation_command add_cube(cgp::vec3 const& center, float K, float mu);
+	static simulation_command pin(unsigned int particle, cgp::vec3 const& target);
+	static simulation_command unpin(unsigned int particle);
+	static simulation_command unpin_all();
+	static simulation_command checkpoint_save(std::string const& filename);
+	static simulation_command checkpoint_load(std::string const& filename);
+	static simulation_command record_start(std::string const& filename, int encoding);
+	static simulation_command record_stop();
+};
+
+// Particle held at a fixed position by a pin command
+struct pin_constraint {
+
+	unsigned int particle;
+	cgp::vec3 target;
+};
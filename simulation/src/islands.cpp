@@ -0,0 +1,139 @@
+#include "islands.hpp"
+
+#include <algorithm>
+
+using namespace cgp;
+
+void union_find::initialize(unsigned int N) {
+
+	parent.resize(N);
+	rank.assign(N, 0);
+	for(unsigned int k = 0; k < N; k++) parent[k] = k;
+}
+
+unsigned int union_find::find(unsigned int i) {
+
+	while(parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+void union_find::unite(unsigned int a, unsigned int b) {
+
+	a = find(a);
+	b = find(b);
+	if(a == b) return;
+
+	if(rank[a] < rank[b]) std::swap(a,b);
+	parent[b] = a;
+	if(rank[a] == rank[b]) rank[a]++;
+}
+
+void island_manager::build(unsigned int N, std::vector<uint2> const& edges) {
+
+	union_find sets;
+	sets.initialize(N);
+	for(const uint2& e : edges)
+		sets.unite(e[0], e[1]);
+
+	// One island per root, particles listed in increasing index order
+	std::vector<int> islandOfRoot(N, -1);
+	islands.clear();
+	previous.clear();
+	islandOf.resize(N);
+	for(unsigned int i = 0; i < N; i++) {
+
+		unsigned int const root = sets.find(i);
+		if(islandOfRoot[root] < 0) {
+			islandOfRoot[root] = int(islands.size());
+			islands.push_back(island());
+			islands.back().sleepEnergy = sleepEnergy;
+		}
+		islandOf[i] = islandOfRoot[root];
+		islands[islandOf[i]].particles.push_back(i);
+	}
+}
+
+void island_manager::wake(int k) {
+
+	islands[k].sleeping = false;
+	islands[k].calmSteps = 0;
+}
+
+void island_manager::wake_all() {
+
+	for(int k = 0; k < int(islands.size()); k++)
+		wake(k);
+}
+
+int island_manager::sleeping_count() const {
+
+	int count = 0;
+	for(const island& isl : islands)
+		if(isl.sleeping) count++;
+	return count;
+}
+
+static bool overlap(island const& a, island const& b, float margin) {
+
+	return a.bbMin.x - margin <= b.bbMax.x && b.bbMin.x - margin <= a.bbMax.x
+		&& a.bbMin.y - margin <= b.bbMax.y && b.bbMin.y - margin <= a.bbMax.y
+		&& a.bbMin.z - margin <= b.bbMax.z && b.bbMin.z - margin <= a.bbMax.z;
+}
+
+void island_manager::wake_on_contact() {
+
+	// Awake islands touching a sleeping one wake it up (and the wake propagates at the next steps).
+	//  Sort and sweep along the axis of largest extent: the boxes, grown by the margin, are visited by increasing lower
+	//  bound and each one is only tested against the boxes of the other kind (moving or sleeping) still open on the axis.
+	sweep.clear();
+	bool anyMoving = false, anySleeping = false;
+	vec3 lower, upper;
+	for(int k = 0; k < int(islands.size()); k++) {
+
+		const island& isl = islands[k];
+		bool const moving = !isl.sleeping && isl.calmSteps == 0;
+		if(isl.particles.empty() || (!moving && !isl.sleeping)) continue;
+
+		lower = sweep.empty() ? isl.bbMin : vec3(std::min(lower.x,isl.bbMin.x), std::min(lower.y,isl.bbMin.y), std::min(lower.z,isl.bbMin.z));
+		upper = sweep.empty() ? isl.bbMax : vec3(std::max(upper.x,isl.bbMax.x), std::max(upper.y,isl.bbMax.y), std::max(upper.z,isl.bbMax.z));
+		sweep.push_back({ 0.0f, 0.0f, k, moving });
+		anyMoving = anyMoving || moving;
+		anySleeping = anySleeping || isl.sleeping;
+	}
+	if(!anyMoving || !anySleeping) return;
+
+	vec3 const extent = upper - lower;
+	int const axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+	for(sweep_entry& e : sweep) {
+		e.start = islands[e.island].bbMin[axis] - contactMargin;
+		e.end = islands[e.island].bbMax[axis];
+	}
+	std::sort(sweep.begin(), sweep.end(), [](const sweep_entry& a, const sweep_entry& b) { return a.start < b.start; });
+
+	openMoving.clear();
+	openSleeping.clear();
+	for(const sweep_entry& e : sweep) {
+
+		auto const closed = [&](const sweep_entry& o) { return o.end < e.start; };
+		openMoving.erase(std::remove_if(openMoving.begin(), openMoving.end(), closed), openMoving.end());
+		openSleeping.erase(std::remove_if(openSleeping.begin(), openSleeping.end(), closed), openSleeping.end());
+
+		if(e.moving) {
+			for(const sweep_entry& o : openSleeping)
+				if(overlap(islands[e.island], islands[o.island], contactMargin))
+					wake(o.island);
+			openMoving.push_back(e);
+		}
+		else {
+			for(const sweep_entry& o : openMoving)
+				if(overlap(islands[o.island], islands[e.island], contactMargin)) {
+					wake(e.island);
+					break;
+				}
+			openSleeping.push_back(e);
+		}
+	}
+}
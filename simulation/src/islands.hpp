@@ -0,0 +1,114 @@
+#pragma once
+
+#include "cgp/cgp.hpp"
+
+// Disjoint-set forest with path halving and union by rank
+struct union_find {
+
+	std::vector<unsigned int> parent;
+	std::vector<unsigned int> rank;
+
+	void initialize(unsigned int N);
+	unsigned int find(unsigned int i);
+	void unite(unsigned int a, unsigned int b);
+};
+
+// Set of particles connected through springs. A sleeping island is skipped by the solver.
+struct island {
+
+	std::vector<unsigned int> particles;
+	bool sleeping = false;
+	int calmSteps = 0;			// consecutive steps spent below the energy threshold
+	float sleepEnergy;			// kinetic energy per unit mass below which the island is considered at rest
+	cgp::vec3 bbMin, bbMax;		// bounding box at the last update, used for wake-on-contact
+};
+
+struct island_manager {
+
+	std::vector<island> islands;
+	std::vector<int> islandOf;		// island index of each particle
+
+	bool enabled = true;
+	float sleepEnergy = 0.01f;		// default threshold given to new islands
+	int sleepDelay = 60;			// number of calm steps before falling asleep
+	float contactMargin = 0.1f;		// distance at which an awake island wakes up a sleeping one
+
+	// Build the connected components of the spring graph (edges given as particle indices)
+	void build(unsigned int N, std::vector<cgp::uint2> const& edges);
+
+	void wake(int k);
+	void wake_all();
+
+	// Update energies, bounding boxes and sleeping states after a step of duration dt.
+	//  PARTICLES is any container of elements with .pos, .vel and .mass fields.
+	//  The energy uses the displacement over the step rather than .vel, which also holds the
+	//  gravity/contact velocity that the integrator cancels at each step for resting bodies.
+	//  Sleeping particles have their velocity set to zero.
+	template <typename PARTICLES>
+	void update(PARTICLES& particles, float dt);
+
+	int sleeping_count() const;
+
+private:
+	void wake_on_contact();
+	std::vector<cgp::vec3> previous;	// positions at the previous update
+
+	// Sort and sweep of wake_on_contact, kept between updates to avoid reallocation
+	struct sweep_entry {
+		float start;					// lower bound on the sweep axis of the box grown by contactMargin
+		float end;						// upper bound on the sweep axis
+		int island;
+		bool moving;					// awake and not calm, otherwise sleeping
+	};
+	std::vector<sweep_entry> sweep;
+	std::vector<sweep_entry> openMoving, openSleeping;
+};
+
+
+template <typename PARTICLES>
+void island_manager::update(PARTICLES& particles, float dt) {
+
+	if(!enabled) {
+		wake_all();
+		return;
+	}
+
+	profile_zone_cgp("islands");
+	bool const firstUpdate = previous.size() != particles.size();
+	if(firstUpdate) {
+		previous.resize(particles.size());
+		for(size_t i = 0; i < particles.size(); i++) previous[i] = particles[i].pos;
+	}
+
+	// Each island only touches its own particles
+	cgp::parallel_for(0, int(islands.size()), [&](int k) {
+
+		island& isl = islands[k];
+		if(isl.sleeping || isl.particles.empty()) return;
+
+		float energy = 0.0f, mass = 0.0f;
+		isl.bbMin = isl.bbMax = particles[isl.particles[0]].pos;
+		for(unsigned int i : isl.particles) {
+
+			auto const& p = particles[i];
+			cgp::vec3 const v = (p.pos - previous[i]) / dt;
+			previous[i] = p.pos;
+
+			energy += 0.5f * p.mass * dot(v,v);
+			mass += p.mass;
+			isl.bbMin = { std::min(isl.bbMin.x,p.pos.x), std::min(isl.bbMin.y,p.pos.y), std::min(isl.bbMin.z,p.pos.z) };
+			isl.bbMax = { std::max(isl.bbMax.x,p.pos.x), std::max(isl.bbMax.y,p.pos.y), std::max(isl.bbMax.z,p.pos.z) };
+		}
+		if(firstUpdate) return;
+
+		isl.calmSteps = energy < isl.sleepEnergy * mass ? isl.calmSteps + 1 : 0;
+		if(isl.calmSteps >= sleepDelay) {
+
+			isl.sleeping = true;
+			for(unsigned int i : isl.particles)
+				particles[i].vel = { 0,0,0 };
+		}
+	}, 1);
+
+	wake_on_contact();
+}
@@ -4,6 +4,7 @@
 
 // Custom scene of this code
 #include "scene.hpp"
+#include "benchmark.hpp"
 
 
 // *************************** //
@@ -28,10 +29,21 @@ scene_structure scene;
 
 GLFWwindow* standard_window_initialization(int width, int height);
 
-int main(int, char* argv[])
+int main(int argc, char* argv[])
 {
 	std::cout << "Run " << argv[0] << std::endl;
 
+	// Number of threads used by the parallel loops: simulation --threads N [...]
+	if (argc > 2 && std::string(argv[1]) == "--threads") {
+		cgp::parallel_set_thread_count(std::max(1, std::atoi(argv[2])));
+		argc -= 2;
+		argv += 2;
+	}
+
+	// Benchmark mode: simulation --benchmark [name]
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+		return benchmark_run(argc > 2 ? argv[2] : "all");
+
 
 	// ************************ //
 	//     INITIALISATION
@@ -45,13 +57,22 @@ int main(int, char* argv[])
 	scene.initialize();                                              
 	std::cout << "Initialization success" << std::endl;
 
+	// Playback mode: simulation --play trajectory.sbt
+	if (argc > 2 && std::string(argv[1]) == "--play") {
+		if (!scene.playback_open(argv[2]))
+			std::cout << "Cannot play " << argv[2] << ", running the simulation" << std::endl;
+	}
+
 
 	// ************************ //
 	//     Animation Loop
 	// ************************ //
 	std::cout<<"Start animation loop ..."<<std::endl;
+	profile_thread_cgp("main");
 	while (!glfwWindowShouldClose(window))
 	{
+		profile_zone_cgp("frame");
+
 		// Reset the screen for a new frame
 		helper_common.frame_begin(scene.environment.background_color, window, inputs.window, inputs.mouse.on_gui);
 		scene.environment.projection.update_aspect_ratio(inputs.window.aspect_ratio());
@@ -67,6 +88,7 @@ int main(int, char* argv[])
 	}
 	
 	// Cleanup
+	scene.simulation_stop();
 	cgp::imgui_cleanup();
 	glfwDestroyWindow(window);
 	glfwTerminate();
@@ -95,12 +117,14 @@ void mouse_move_callback(GLFWwindow* /*window*/, double xpos, double ypos)
 void mouse_click_callback(GLFWwindow* /*window*/, int button, int action, int /*mods*/)
 {
 	inputs.mouse.click.update_from_glfw_click(button, action);
+	scene.mouse_click_event(inputs);
 }
 
 // This function is called everytime a keyboard touch is pressed/released
 void keyboard_callback(GLFWwindow* /*window*/, int key, int , int action, int /*mods*/)
 {
 	inputs.keyboard.update_from_glfw_key(key, action);
+	scene.keyboard_event(inputs);
 }
 
 // Standard initialization procedure
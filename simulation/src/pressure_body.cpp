@@ -0,0 +1,135 @@
+#include "pressure_body.hpp"
+
+#include <algorithm>
+#include <string>
+#include <map>
+#include <tuple>
+
+using namespace cgp;
+
+void pressure_body::initialize(mesh const& surface, float vertex_mass) {
+
+	mass = vertex_mass;
+	pos.clear(); vel.clear(); triangles.clear(); edges.clear(); edgesL0.clear(); gradient.clear();
+	volume = restVolume = 0.0f;
+	if(surface.position.size() == 0) {
+		warning_cgp("Pressure body: empty surface mesh", "");
+		return;
+	}
+
+	// Weld the vertices sharing the same position (up to a tolerance relative to the size of the mesh)
+	vec3 pmin = surface.position[0], pmax = surface.position[0];
+	for(const vec3& p : surface.position) {
+		pmin = { std::min(pmin.x,p.x), std::min(pmin.y,p.y), std::min(pmin.z,p.z) };
+		pmax = { std::max(pmax.x,p.x), std::max(pmax.y,p.y), std::max(pmax.z,p.z) };
+	}
+	float const eps = 1e-5f * std::max(norm(pmax - pmin), 1e-6f);
+
+	std::map<std::tuple<int,int,int>, unsigned int> welded;
+	std::vector<unsigned int> index(surface.position.size());
+	for(int k = 0; k < surface.position.size(); k++) {
+
+		vec3 const& p = surface.position[k];
+		auto const key = std::make_tuple(int(std::round(p.x/eps)), int(std::round(p.y/eps)), int(std::round(p.z/eps)));
+		auto const it = welded.find(key);
+		if(it == welded.end()) {
+			index[k] = (unsigned int)pos.size();
+			welded[key] = index[k];
+			pos.push_back(p);
+		}
+		else
+			index[k] = it->second;
+	}
+	vel.assign(pos.size(), vec3(0,0,0));
+
+	for(const uint3& t : surface.connectivity) {
+
+		uint3 const w = { index[t[0]], index[t[1]], index[t[2]] };
+		if(w[0] != w[1] && w[1] != w[2] && w[0] != w[2])
+			triangles.push_back(w);
+	}
+
+	// The volume and its gradient are only meaningful for a closed surface
+	mesh_topology topology;
+	topology.build(buffer<uint3>(triangles), pos.size());
+	if(!topology.is_closed_manifold())
+		warning_cgp("Pressure body: surface is not a closed manifold, its volume is not meaningful",
+			std::to_string(topology.boundary_loops.size()) + " boundary loops, " + std::to_string(topology.non_manifold_edge_count) + " non-manifold half-edges, "
+			+ std::to_string(topology.non_manifold_vertex_count) + " non-manifold vertices");
+
+	// Unique edges of the surface used as springs
+	mesh_edge_adjacency const adjacency = mesh_edges(buffer<uint3>(triangles), pos.size());
+	edges.assign(adjacency.edges.begin(), adjacency.edges.end());
+	edgesL0.resize(edges.size());
+	for(size_t e = 0; e < edges.size(); e++)
+		edgesL0[e] = norm(pos[edges[e][0]] - pos[edges[e][1]]);
+
+	volume = compute_volume(gradient);
+	restVolume = volume;
+}
+
+void pressure_body::set_rest_pressure(float pressure) {
+
+	nRT = pressure * restVolume;
+}
+
+float pressure_body::compute_volume(std::vector<vec3>& grad) const {
+
+	grad.assign(pos.size(), vec3(0,0,0));
+	if(pos.empty()) return 0.0f;
+
+	// Positions are taken relative to a vertex to limit cancellation errors
+	vec3 const c = pos[0];
+	float V = 0.0f;
+	for(const uint3& t : triangles) {
+
+		vec3 const p0 = pos[t[0]] - c;
+		vec3 const p1 = pos[t[1]] - c;
+		vec3 const p2 = pos[t[2]] - c;
+		V += dot(p0, cross(p1,p2)) / 6.0f;
+
+		// dV/dp = area weighted normal / 3 on closed surfaces
+		vec3 const n = cross(p1-p0, p2-p0) / 6.0f;
+		grad[t[0]] += n;
+		grad[t[1]] += n;
+		grad[t[2]] += n;
+	}
+	return V;
+}
+
+void pressure_body::step(vec3 const& gravity, float ground, float dt) {
+
+	size_t const N = pos.size();
+
+	volume = compute_volume(gradient);
+	float const P = nRT / std::max(volume, 1e-6f);
+
+	force.resize(N);
+	for(size_t k = 0; k < N; k++)
+		force[k] = mass * gravity - mu * vel[k] + P * gradient[k];
+
+	for(size_t e = 0; e < edges.size(); e++) {
+
+		unsigned int const i = edges[e][0];
+		unsigned int const j = edges[e][1];
+		vec3 const d = pos[i] - pos[j];
+		float const L = norm(d);
+		if(L < 1e-6f) continue;
+
+		vec3 const F = -K * (L - edgesL0[e]) * d / L;
+		force[i] += F;
+		force[j] -= F;
+	}
+
+	// Semi-implicit Euler
+	for(size_t k = 0; k < N; k++) {
+
+		vel[k] += dt * force[k] / mass;
+		pos[k] += dt * vel[k];
+
+		if(pos[k].z < ground) {
+			pos[k].z = ground;
+			vel[k] = -vel[k] * dt;
+		}
+	}
+}
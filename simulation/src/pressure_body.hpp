@@ -0,0 +1,39 @@
+#pragma once
+
+#include "cgp/cgp.hpp"
+
+// Surface-only soft body inflated by an ideal gas (Matyka & Ollila, "Pressure model of soft body simulation").
+//  Only the closed triangle surface is simulated: edge springs keep the surface together and the enclosed
+//  volume V is recomputed each step from the triangles. The pressure P = nRT/V pushes every vertex along
+//  the gradient of the volume (area weighted vertex normal), so no internal spring is required.
+struct pressure_body {
+
+	std::vector<cgp::vec3> pos;
+	std::vector<cgp::vec3> vel;
+	std::vector<cgp::uint3> triangles;		// closed surface, oriented outward
+
+	std::vector<cgp::uint2> edges;			// surface springs (unique edges of the triangles)
+	std::vector<float> edgesL0;
+
+	float mass = 0.01f;		// mass of each vertex
+	float K = 5.0f;			// stiffness of the surface springs
+	float mu = 0.01f;		// damping coefficient
+	float nRT = 1.0f;		// gas constant: P = nRT / V
+
+	float volume = 0.0f;		// enclosed volume computed at the last step
+	float restVolume = 0.0f;	// enclosed volume of the initial shape
+
+	// Initialize from a closed mesh. Duplicated vertices (seams, poles) are welded.
+	void initialize(cgp::mesh const& surface, float vertex_mass);
+	// Set nRT such that the gas has the given pressure in the rest shape
+	void set_rest_pressure(float pressure);
+
+	// Enclosed volume (divergence theorem), gradient of the volume w.r.t. each vertex is accumulated in grad
+	float compute_volume(std::vector<cgp::vec3>& grad) const;
+
+	void step(cgp::vec3 const& gravity, float ground, float dt);
+
+private:
+	std::vector<cgp::vec3> force;		// work buffers
+	std::vector<cgp::vec3> gradient;
+};
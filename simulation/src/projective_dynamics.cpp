@@ -0,0 +1,133 @@
+#include "projective_dynamics.hpp"
+
+using namespace cgp;
+
+void projective_dynamics::initialize(std::vector<float> const& _masses, std::vector<pd_spring> const& _springs) {
+
+	masses = _masses;
+	springs = _springs;
+	invalidate();
+}
+
+void projective_dynamics::invalidate() {
+
+	for(cached_factor& f : factors)
+		f.valid = false;
+}
+
+bool projective_dynamics::is_factored() const {
+
+	for(const cached_factor& f : factors)
+		if(f.valid) return true;
+	return false;
+}
+
+projective_dynamics::solver_type& projective_dynamics::factor(float dt) {
+
+	useCount++;
+	cached_factor* slot = &factors[0];
+	for(cached_factor& f : factors) {
+
+		if(f.valid && f.dt == dt) {
+			f.lastUse = useCount;
+			return f.solver;
+		}
+		if(!f.valid || (slot->valid && f.lastUse < slot->lastUse))
+			slot = &f;
+	}
+
+	int const N = int(masses.size());
+	float const dt2 = dt * dt;
+
+	// Assemble M + dt^2 * sum_c K_c A_c^T A_c, where A_c extracts (q_i - q_j)
+	std::vector<Eigen::Triplet<float>> triplets;
+	triplets.reserve(N + 4 * springs.size());
+	for(int k = 0; k < N; k++)
+		triplets.push_back(Eigen::Triplet<float>(k,k,masses[k]));
+	for(const pd_spring& s : springs) {
+
+		float const w = dt2 * s.K;
+		triplets.push_back(Eigen::Triplet<float>(s.i,s.i,w));
+		triplets.push_back(Eigen::Triplet<float>(s.j,s.j,w));
+		triplets.push_back(Eigen::Triplet<float>(s.i,s.j,-w));
+		triplets.push_back(Eigen::Triplet<float>(s.j,s.i,-w));
+	}
+
+	Eigen::SparseMatrix<float> system(N,N);
+	system.setFromTriplets(triplets.begin(), triplets.end());
+
+	slot->solver.compute(system);
+	assert_cgp(slot->solver.info() == Eigen::Success, "Projective Dynamics: factorization of the global matrix failed");
+
+	slot->dt = dt;
+	slot->valid = true;
+	slot->lastUse = useCount;
+	return slot->solver;
+}
+
+void projective_dynamics::step(matrix_n3& positions, matrix_n3& velocities, vec3 const& gravity, std::vector<float> const& damping, float dt) {
+
+	int const N = int(masses.size());
+	int const N_spring = int(springs.size());
+	assert_cgp_no_msg(positions.rows() == N && velocities.rows() == N && int(damping.size()) == N);
+	if(N == 0 || dt <= 0) return;
+
+	solver_type& solver = factor(dt);
+
+	float const dt2 = dt * dt;
+
+	// Inertial prediction s = x + dt v + dt^2 g, with implicit linear damping on the velocity.
+	//  The n x 3 matrices are row-major and accessed through their data: the row expressions of this
+	//  Eigen version trigger -Wdeprecated-copy and are bounds-checked in debug builds.
+	inertia.resize(N,3);
+	float const* const x = positions.data();
+	float const* const v = velocities.data();
+	float* const s = inertia.data();
+	parallel_for(0, N, [&](int k) {
+
+		float const damped = dt / (1.0f + dt * damping[k] / masses[k]);
+		for(int a = 0; a < 3; a++)
+			s[3*k+a] = masses[k] * (x[3*k+a] + damped * v[3*k+a] + dt2 * gravity[a]);
+	});
+
+	matrix_n3 q(N,3);
+	for(int k = 0; k < N; k++)
+		q.row(k) = inertia.row(k) / masses[k];
+
+	projection.resize(N_spring,3);
+	rhs.resize(N,3);
+	for(int it = 0; it < iterations; it++) {
+
+		// Local step: project each spring on its rest length (independent per spring)
+		float const* const qd = q.data();
+		float* const d = projection.data();
+		parallel_for(0, N_spring, [&](int c) {
+
+			pd_spring const& sp = springs[c];
+			float* const dc = d + 3*c;
+			for(int a = 0; a < 3; a++)
+				dc[a] = qd[3*sp.i+a] - qd[3*sp.j+a];
+			float const L = std::sqrt(dc[0]*dc[0] + dc[1]*dc[1] + dc[2]*dc[2]);
+			if(L > 1e-6f)
+				for(int a = 0; a < 3; a++)
+					dc[a] *= sp.L0 / L;
+		});
+
+		// Global step: M s + dt^2 sum_c K_c A_c^T d_c, solved with the cached factor
+		float* const b = rhs.data();
+		std::copy(s, s + 3*N, b);
+		for(int c = 0; c < N_spring; c++) {
+
+			pd_spring const& sp = springs[c];
+			for(int a = 0; a < 3; a++) {
+				float const f = dt2 * sp.K * d[3*c+a];
+				b[3*sp.i+a] += f;
+				b[3*sp.j+a] -= f;
+			}
+		}
+		q = solver.solve(rhs);
+	}
+
+	velocities = (q - positions) / dt;
+	positions = q;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "cgp/cgp.hpp"
+// The sparse solvers of this Eigen version copy expression objects with implicit copy constructors
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-copy"
+#include "third_party/src/eigen/Eigen/SparseCholesky"
+#pragma GCC diagnostic pop
+
+// Spring constraint handled by the Projective Dynamics solver (endpoints given as particle indices).
+struct pd_spring {
+
+	unsigned int i;
+	unsigned int j;
+	float K;
+	float L0;
+};
+
+// Projective Dynamics solver (Bouaziz et al. 2014) restricted to spring constraints.
+//  The global system matrix (M + dt^2 * sum K A^T A) only depends on the masses, the spring topology, the stiffnesses and dt.
+//  It is factored with a sparse LDLT. The factors of the last few dt are cached until invalidate() is called, so that
+//  an adaptive stepper alternating between a small set of step sizes (see adaptive_timestep::quantize) reuses them.
+//  Each iteration is then a parallel local projection of the springs followed by a back-substitution.
+struct projective_dynamics {
+
+	using matrix_n3 = Eigen::Matrix<float, Eigen::Dynamic, 3, Eigen::RowMajor>;
+
+	int iterations = 10;
+
+	// Set the masses and spring constraints of the system. The factorization is invalidated.
+	void initialize(std::vector<float> const& masses, std::vector<pd_spring> const& springs);
+	// Force a new factorization at the next step (to be called when topology, masses or stiffness change)
+	void invalidate();
+	bool is_factored() const;
+
+	// Advance positions/velocities (n x 3) by dt.
+	//  gravity: uniform external acceleration; damping: per-particle linear damping coefficient (force = -damping*vel)
+	void step(matrix_n3& positions, matrix_n3& velocities, cgp::vec3 const& gravity, std::vector<float> const& damping, float dt);
+
+private:
+	using solver_type = Eigen::SimplicialLDLT<Eigen::SparseMatrix<float>>;
+
+	// Factor of dt, computed if not cached (the least recently used factor is replaced)
+	solver_type& factor(float dt);
+
+	std::vector<float> masses;
+	std::vector<pd_spring> springs;
+
+	struct cached_factor {
+		solver_type solver;
+		float dt = 0.0f;
+		bool valid = false;
+		unsigned int lastUse = 0;
+	};
+	static const int factor_cache_size = 4;
+	cached_factor factors[factor_cache_size];
+	unsigned int useCount = 0;
+
+	// Work buffers kept between steps to avoid reallocation
+	matrix_n3 inertia;    // M * s (constant over the iterations)
+	matrix_n3 projection; // Projected spring vectors d_c
+	matrix_n3 rhs;
+};
@@ -0,0 +1,59 @@
+#include "reorder.hpp"
+
+#include <algorithm>
+
+using namespace cgp;
+
+// Spread the 21 lower bits of x so that two zeros separate consecutive bits
+static uint64_t spread_bits(uint64_t x) {
+
+	x &= 0x1fffff;
+	x = (x | x << 32) & 0x1f00000000ffffull;
+	x = (x | x << 16) & 0x1f0000ff0000ffull;
+	x = (x | x << 8) & 0x100f00f00f00f00full;
+	x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+	x = (x | x << 2) & 0x1249249249249249ull;
+	return x;
+}
+
+uint64_t morton_code(vec3 const& p, vec3 const& low, vec3 const& high) {
+
+	float const levels = float((1 << 21) - 1);
+	uint64_t q[3];
+	for(int a = 0; a < 3; a++) {
+		float const extent = high[a] - low[a];
+		float const u = extent > 0 ? (p[a] - low[a]) / extent : 0.0f;
+		q[a] = uint64_t(std::max(0.0f, std::min(1.0f, u)) * levels);
+	}
+	return spread_bits(q[0]) | spread_bits(q[1]) << 1 | spread_bits(q[2]) << 2;
+}
+
+std::vector<unsigned int> morton_order(std::vector<vec3> const& positions) {
+
+	size_t const N = positions.size();
+	std::vector<unsigned int> order(N);
+	if(N == 0) return order;
+
+	vec3 low = positions[0], high = positions[0];
+	for(const vec3& p : positions) {
+		low = { std::min(low.x,p.x), std::min(low.y,p.y), std::min(low.z,p.z) };
+		high = { std::max(high.x,p.x), std::max(high.y,p.y), std::max(high.z,p.z) };
+	}
+
+	std::vector<std::pair<uint64_t, unsigned int> > keys(N);
+	for(size_t k = 0; k < N; k++)
+		keys[k] = { morton_code(positions[k], low, high), (unsigned int)k };
+	std::sort(keys.begin(), keys.end());
+
+	for(size_t k = 0; k < N; k++)
+		order[k] = keys[k].second;
+	return order;
+}
+
+std::vector<unsigned int> inverse_permutation(std::vector<unsigned int> const& order) {
+
+	std::vector<unsigned int> inverse(order.size());
+	for(size_t k = 0; k < order.size(); k++)
+		inverse[order[k]] = (unsigned int)k;
+	return inverse;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "cgp/cgp.hpp"
+
+#include <cstdint>
+
+// Spatial reordering of particles: nearby particles get nearby indices, so that the spring endpoints read
+//  by the solver fall in the same cache lines.
+
+// Interleaved bits (21 per axis) of the position quantized in the box [low,high]
+uint64_t morton_code(cgp::vec3 const& p, cgp::vec3 const& low, cgp::vec3 const& high);
+
+// Permutation sorting the positions along the Morton curve: order[new index] = old index
+std::vector<unsigned int> morton_order(std::vector<cgp::vec3> const& positions);
+
+// Inverse permutation: inverse[old index] = new index
+std::vector<unsigned int> inverse_permutation(std::vector<unsigned int> const& order);
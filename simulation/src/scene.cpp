@@ -1,7 +1,30 @@
 #include "scene.hpp"
+#include "checkpoint.hpp"
 
 using namespace cgp;
 
+// Corner ordering of the cube bodies and their surface quads
+//   4----5
+//  /|   /| 
+// 0----1 |
+// | 6--|-7
+// |/   |/
+// 2----3
+static const unsigned int cubeQuads[6][4] = { {0,1,3,2}, {1,5,7,3}, {5,4,6,7}, {4,0,2,6}, {2,3,7,6}, {1,0,4,5} };
+
+static std::vector<vec3> cube_corners(vec3 const& center, float halfSize) {
+
+	std::vector<vec3> corners;
+	for(float x : { 1.0f,-1.0f })
+		for(float z : { 1.0f,-1.0f })
+			for(float y : { -1.0f,1.0f })
+				corners.push_back(center + halfSize * vec3(x,y,z));
+	return corners;
+}
+
+// Edge springs of each cube corner, the diagonal spring of corner k goes to corner 7-k
+static const unsigned int cubeEdges[8][3] = { {4,1,2}, {5,0,3}, {6,3,0}, {7,2,1}, {0,5,6}, {1,4,7}, {2,7,4}, {3,6,5} };
+
 // Spring force applied on particle p_i with respect to position p_j.
 vec3 spring_force(const vec3& p_i, const vec3& p_j, float L0, float K) {
 
@@ -13,53 +36,498 @@ vec3 spring_force(const vec3& p_i, const vec3& p_j, float L0, float K) {
 	return F;
 }
 
-void scene_structure::simulation_step(float dt) {
+static simulation_parameters simulation_parameters_of(gui_parameters const& gui, float timeScale) {
 
-	vec3 const g = { 0,0,gui.gy };
+	simulation_parameters p;
+	p.gy = gui.gy;
+	p.sK = gui.sK;
+	p.sMu = gui.sMu;
+	p.solver = gui.solver;
+	p.pdIterations = gui.pdIterations;
+	p.sleeping = gui.sleeping;
+	p.adaptive = gui.adaptive;
+	p.adaptiveError = gui.adaptiveError;
+	p.reorder = gui.reorder;
+	p.reorderInterval = gui.reorderInterval;
+	p.timeScale = timeScale;
+	return p;
+}
 
-	bool onClickXneg = ImGui::Button("-X Force"); ImGui::SameLine();
-	bool onClickXpos = ImGui::Button("+X Force");
-	bool onClickYneg = ImGui::Button("-Y Force"); ImGui::SameLine();
-	bool onClickYpos = ImGui::Button("+Y Force");
-	bool onClickZneg = ImGui::Button("-Z Force"); ImGui::SameLine();
-	bool onClickZpos = ImGui::Button("+Z Force");
+void scene_structure::simulation_start() {
 
-	for(particle& p : particles) {
+	if(simulationRunning) return;
+	simulationRunning = true;
+	simulationThread = std::thread(&scene_structure::simulation_run, this);
+}
 
-		if(onClickXneg) p.vel += vec3(-10,0,0);
-		if(onClickXpos) p.vel += vec3(10,0,0);
-		if(onClickYneg) p.vel += vec3(0,-10,0);
-		if(onClickYpos) p.vel += vec3(0,10,0);
-		if(onClickZneg) p.vel += vec3(0,0,-10);
-		if(onClickZpos) p.vel += vec3(0,0,10);
+void scene_structure::simulation_stop() {
 
-		// Colliding with ground plane at arbitrary Z height
-		if(p.pos.z < -1.5f) {
-			p.pos.z = -1.5f;
-			p.vel = -p.vel * dt;
+	if(!simulationRunning) return;
+	simulationRunning = false;
+	simulationThread.join();
+}
+
+scene_structure::~scene_structure() {
+
+	simulation_stop();
+}
+
+void scene_structure::send(simulation_command const& command) {
+
+	if(!simulationRunning) {
+		apply(command);
+		return;
+	}
+	simulation_command queued = command;
+	while(!commands.push(std::move(queued)))
+		std::this_thread::yield();
+}
+
+void scene_structure::apply(simulation_command const& command) {
+
+	switch(command.type) {
+
+	case command_impulse:
+		apply_impulse(command.vector);
+		break;
+	case command_parameters:
+		set_parameters(command.parameters);
+		break;
+	case command_update_springs:
+		update_springs(command.K, command.mu);
+		break;
+	case command_add_cube:
+		add_cube(command.vector, 0.01f, command.K, command.mu, 2.0f);
+		islands.wake_all();
+		break;
+	case command_pin:
+	case command_unpin: {
+		particle_ids_update();
+		int const k = command.particle < particleOfId.size() ? particleOfId[command.particle] : -1;
+		if(k < 0) break;
+		unsigned int const i = (unsigned int)k;
+		pins.erase(std::remove_if(pins.begin(), pins.end(), [&](const pin_constraint& c) { return c.particle == i; }), pins.end());
+		if(command.type == command_pin) pins.push_back({ i, command.vector });
+		islands.wake(islands.islandOf[i]);
+		break;
+	}
+	case command_unpin_all:
+		pins.clear();
+		islands.wake_all();
+		break;
+	case command_checkpoint_save:
+		checkpoint_save(*this, command.filename);
+		break;
+	case command_checkpoint_load:
+		if(checkpoint_load(*this, command.filename)) {
+			pins.clear();
+			particle_ids_reset();
 		}
+		break;
+	case command_record_start:
+		recording_start(command.filename, command.encoding);
+		break;
+	case command_record_stop:
+		recorder.close();
+		break;
+	}
+}
+
+void scene_structure::simulation_tick(float dt) {
+
+	profile_zone_cgp("simulation tick");
+
+	// Commands are applied between two steps
+	simulation_command command;
+	while(commands.pop(command)) apply(command);
+
+	// The trajectory being recorded relies on a fixed numbering
+	if(parameters.reorder && !recorder.is_open()) {
+		bool const periodic = parameters.reorderInterval > 0 && stepsSinceReorder >= parameters.reorderInterval;
+		if(periodic || reorderedTopology != topologyVersion) reorder_particles();
+	}
+	stepsSinceReorder++;
+
+	if(dt > 0) {
+		// The clock follows the simulated time, the recorded frames stay on the simulation timeline
+		simulationTime += simulation_step(dt);
+		if(recorder.is_open()) recording_frame();
+	}
+	simulation_publish();
+}
+
+void scene_structure::simulation_run() {
+
+	profile_thread_cgp("simulation");
+
+	using clock = std::chrono::steady_clock;
+	clock::duration const period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(1.0f / stepsPerSecond));
+	clock::time_point next = clock::now();
+
+	while(simulationRunning) {
+
+		simulation_tick(parameters.timeScale * 0.01f);
+
+		// Fixed step rate, a late step (too many particles) is not caught up
+		next += period;
+		clock::time_point const now = clock::now();
+		if(next < now) next = now;
+		else std::this_thread::sleep_until(next);
+	}
+}
+
+void scene_structure::simulation_publish() {
+
+	profile_zone_cgp("publish snapshot");
+
+	simulation_snapshot& state = snapshots.write_buffer();
+
+	state.positions.resize(particles.size());
+	for(size_t k = 0; k < particles.size(); k++)
+		state.positions[k] = particles[k].pos;
+
+	particle_ids_update();
+	if(state.topology != topologyVersion) {
+		state.ids = particleId;
+		state.segments.clear();
+		for(unsigned int i = 0; i < particles.size(); i++)
+			for(const spring& s : particles[i].springs)
+				if(s.isDrawn) state.segments.push_back(uint2{ i, s.other });
+		state.cubes = cubes;
+		state.topology = topologyVersion;
+	}
+	state.pinned.clear();
+	for(const pin_constraint& c : pins) state.pinned.push_back(c.particle);
+
+	state.time = simulationTime;
+	state.islandCount = int(islands.islands.size());
+	state.sleepingIslands = islands.sleeping_count();
+	state.stats = stepper.stats;
+	state.recording = recorder.is_open();
+	state.recordedFrames = recorder.frame_count();
+	state.recordedBytes = recorder.is_open() ? recorder.bytes_written() : 0;
+	state.parameters = parameters;
+	state.parametersVersion = parametersVersion;
+
+	snapshots.publish();
+}
 
+void scene_structure::set_parameters(simulation_parameters const& p) {
+
+	bool const gravityChanged = p.gy != parameters.gy;
+	parameters = p;
+	if(gravityChanged) islands.wake_all();
+}
+
+void scene_structure::apply_impulse(vec3 const& impulse) {
+
+	islands.wake_all();
+	for(particle& p : particles) p.vel += impulse;
+}
+
+void scene_structure::reorder_particles() {
+
+	profile_zone_cgp("reorder");
+
+	std::vector<vec3> positions(particles.size());
+	for(size_t k = 0; k < particles.size(); k++) positions[k] = particles[k].pos;
+	std::vector<unsigned int> const order = morton_order(positions);
+	std::vector<unsigned int> const newIndex = inverse_permutation(order);
+
+	// Springs are copied (not moved) in the new order so that their arrays are also allocated in sequence
+	std::vector<particle> reordered;
+	reordered.reserve(particles.size());
+	for(unsigned int i : order) {
+
+		particle const& p = particles[i];
+		reordered.push_back(particle(p.mass, p.pos, p.vel));
+		std::vector<spring>& springs = reordered.back().springs;
+		springs = p.springs;
+		for(spring& s : springs) s.other = newIndex[s.other];
+		std::sort(springs.begin(), springs.end(), [](const spring& a, const spring& b) { return a.other < b.other; });
+	}
+	particles.swap(reordered);
+
+	for(unsigned int& c : cubes) c = newIndex[c];
+	for(pin_constraint& c : pins) c.particle = newIndex[c.particle];
+
+	particle_ids_update();
+	std::vector<unsigned int> reorderedIds(order.size());
+	for(size_t k = 0; k < order.size(); k++) {
+		reorderedIds[k] = particleId[order[k]];
+		particleOfId[reorderedIds[k]] = int(k);
+	}
+	particleId.swap(reorderedIds);
+
+	// The connected components are unchanged: sleeping islands stay asleep
+	std::vector<island> previousIslands;
+	previousIslands.swap(islands.islands);
+	std::vector<int> previousIslandOf;
+	previousIslandOf.swap(islands.islandOf);
+
+	topologyVersion++;
+	reorderedTopology = topologyVersion;
+	stepsSinceReorder = 0;
+	islands_build();
+	for(island& isl : islands.islands) {
+		if(isl.particles.empty() || previousIslandOf.size() != order.size()) continue;
+		island const& old = previousIslands[previousIslandOf[order[isl.particles[0]]]];
+		isl.sleeping = old.sleeping;
+		isl.calmSteps = old.calmSteps;
+		isl.sleepEnergy = old.sleepEnergy;
+		isl.bbMin = old.bbMin;
+		isl.bbMax = old.bbMax;
+	}
+	projective_dynamics_initialize();
+}
+
+// Ids are given to the particles appended since the last call (all of them if the particles were replaced)
+void scene_structure::particle_ids_update() {
+
+	if(particleId.size() > particles.size()) particle_ids_reset();
+	while(particleId.size() < particles.size()) {
+		particleId.push_back((unsigned int)particleOfId.size());
+		particleOfId.push_back(int(particleId.size() - 1));
+	}
+}
+
+// The particles were replaced: the previous ids refer to no particle anymore
+void scene_structure::particle_ids_reset() {
+
+	std::fill(particleOfId.begin(), particleOfId.end(), -1);
+	particleId.clear();
+}
+
+void scene_structure::apply_pins() {
+
+	for(const pin_constraint& c : pins) {
+		particles[c.particle].pos = c.target;
+		particles[c.particle].vel = { 0,0,0 };
+	}
+}
+
+unsigned short spring_material_index(std::vector<spring_material>& materials, float K, float mu) {
+
+	for(size_t k = 0; k < materials.size(); k++)
+		if(materials[k].K == K && materials[k].mu == mu)
+			return (unsigned short)k;
+	assert_cgp(materials.size() <= std::numeric_limits<unsigned short>::max(), "Too many spring materials");
+	materials.push_back({ K, mu });
+	return (unsigned short)(materials.size() - 1);
+}
+
+// Global stiffness/damping edit: only the material table is written, whatever the number of springs
+void scene_structure::update_springs(float K, float mu) {
+
+	for(spring_material& m : materials) {
+		m.K = K;
+		m.mu = mu;
+	}
+
+	// Stiffness changed: the Projective Dynamics factor must be recomputed before its next step
+	pdOutdated = true;
+	islands.wake_all();
+}
+
+float scene_structure::simulation_step(float dt) {
+
+	if(parameters.adaptive) {
+		stepper.errorType = parameters.adaptiveError;
+		// Projective Dynamics caches one factorization per step size
+		stepper.quantize = parameters.solver == solver_projective_dynamics;
+		return stepper.advance(*this, dt);
+	}
+
+	simulation_integrate(dt);
+	simulation_accept(dt);
+	return dt;
+}
+
+void scene_structure::simulation_integrate(float dt) {
+
+	profile_zone_cgp("integrate");
+
+	if(parameters.solver == solver_projective_dynamics) {
+
+		// The global solve couples all the particles: sleeping is not used by this backend
+		islands.wake_all();
+		projective_dynamics_step(dt);
+		apply_pins();
+		return;
+	}
+
+	// Islands share no spring: they are integrated in parallel. Sleeping islands are not integrated.
+	parallel_for(0, int(islands.islands.size()), [&](int k) {
+
+		const island& isl = islands.islands[k];
+		if(isl.sleeping) return;
+
+		for(unsigned int i : isl.particles)
+			simulation_step_particle(particles[i], dt);
+	}, 1);
+	apply_pins();
+}
+
+// Sleeping states are only updated by accepted steps: the trial integrations of the adaptive stepper
+//  are rolled back without the islands noticing them
+void scene_structure::simulation_accept(float dt) {
+
+	if(parameters.solver == solver_projective_dynamics) return;
+	islands.enabled = parameters.sleeping;
+	islands.update(particles, dt);
+}
+
+void scene_structure::simulation_step_particle(particle& p, float dt) {
+
+	vec3 const g = { 0,0,parameters.gy };
+
+	// Colliding with ground plane at arbitrary Z height
+	if(p.pos.z < -1.5f) {
+		p.pos.z = -1.5f;
+		p.vel = -p.vel * dt;
+	}
+
+	for(const spring& s : p.springs) {
+
+		// Forces
+		spring_material const& m = materials[s.material];
+		const vec3 Fspring = spring_force(p.pos,particles[s.other].pos,s.L0,m.K);
+		const vec3 Fweight = p.mass * g;
+		const vec3 Fdamping = -m.mu * p.vel;
+		vec3 F = Fspring + Fweight + Fdamping;
+
+		// Velocity-Verlet integration
+		const vec3 halfVel = p.vel + dt / 2 * F / p.mass;
+		p.pos = p.pos + dt * halfVel;
+		F = spring_force(p.pos,particles[s.other].pos,s.L0,m.K) + Fweight + Fdamping;
+		p.vel = halfVel + dt / 2 * F / p.mass;
+	}
+}
+
+void scene_structure::save_state(simulation_state& state) const {
+
+	state.pos.resize(particles.size());
+	state.vel.resize(particles.size());
+	for(size_t k = 0; k < particles.size(); k++) {
+		state.pos[k] = particles[k].pos;
+		state.vel[k] = particles[k].vel;
+	}
+}
+
+void scene_structure::restore_state(simulation_state const& state) {
+
+	for(size_t k = 0; k < particles.size(); k++) {
+		particles[k].pos = state.pos[k];
+		particles[k].vel = state.vel[k];
+	}
+}
+
+// A step is considered unstable if it produced non finite values or overstretched springs
+bool scene_structure::is_stable() const {
+
+	for(const particle& p : particles) {
+
+		if(!std::isfinite(p.pos.x + p.pos.y + p.pos.z) || !std::isfinite(p.vel.x + p.vel.y + p.vel.z))
+			return false;
+		for(const spring& s : p.springs)
+			if(norm(p.pos - particles[s.other].pos) > 3 * s.L0)
+				return false;
+	}
+	return true;
+}
+
+// Stability bound of the explicit integration: 2/omega for the stiffest particle,
+//  and no particle should travel more than half of its shortest spring in one step.
+float scene_structure::stable_timestep() const {
+
+	float dt = std::numeric_limits<float>::max();
+	for(const particle& p : particles) {
+
+		float K = 0.0f, L0 = std::numeric_limits<float>::max();
 		for(const spring& s : p.springs) {
+			K += materials[s.material].K;
+			L0 = std::min(L0, s.L0);
+		}
+		if(K > 0) dt = std::min(dt, 2 * std::sqrt(p.mass / K));
+
+		float const v = norm(p.vel);
+		if(v > 1e-6f && L0 < std::numeric_limits<float>::max()) dt = std::min(dt, 0.5f * L0 / v);
+	}
+	return dt;
+}
+
+void scene_structure::islands_build() {
+
+	std::vector<uint2> edges;
+	for(unsigned int i = 0; i < particles.size(); i++)
+		for(const spring& s : particles[i].springs)
+			edges.push_back(uint2{ i, s.other });
+	islands.build((unsigned int)particles.size(), edges);
+}
+
+// Gather the unique springs (i<j) of the particles into the Projective Dynamics solver.
+//  Must be called again whenever the topology, the masses or the stiffnesses change.
+void scene_structure::projective_dynamics_initialize() {
+
+	std::vector<float> masses;
+	std::vector<pd_spring> springs;
+	for(unsigned int i = 0; i < particles.size(); i++) {
+
+		masses.push_back(particles[i].mass);
+		for(const spring& s : particles[i].springs)
+			springs.push_back({ std::min(i,s.other), std::max(i,s.other), materials[s.material].K, s.L0 });
+	}
+
+	// Springs are usually stored at both ends: keep a single constraint per pair
+	std::sort(springs.begin(), springs.end(), [](const pd_spring& a, const pd_spring& b) { return a.i < b.i || (a.i == b.i && a.j < b.j); });
+	springs.erase(std::unique(springs.begin(), springs.end(), [](const pd_spring& a, const pd_spring& b) { return a.i == b.i && a.j == b.j; }), springs.end());
 
-			// Forces
-			const vec3 Fspring = spring_force(p.pos,*s.posOther,s.L0,s.K);
-			const vec3 Fweight = p.mass * g;
-			const vec3 Fdamping = -s.mu * p.vel;
-			vec3 F = Fspring + Fweight + Fdamping;
-
-			// Velocity-Verlet integration
-			const vec3 halfVel = p.vel + dt / 2 * F / p.mass;
-			p.pos = p.pos + dt * halfVel;
-			F = spring_force(p.pos,*s.posOther,s.L0,s.K) + Fweight + Fdamping;
-			p.vel = halfVel + dt / 2 * F / p.mass;
+	pd.initialize(masses, springs);
+	pdOutdated = false;
+}
+
+void scene_structure::projective_dynamics_step(float dt) {
+
+	profile_zone_cgp("projective dynamics");
+
+	if(pdOutdated) projective_dynamics_initialize();
+
+	int const N = int(particles.size());
+	projective_dynamics::matrix_n3 positions(N,3), velocities(N,3);
+	std::vector<float> damping(N);
+	for(int k = 0; k < N; k++) {
+
+		const particle& p = particles[k];
+		positions.row(k) << p.pos.x, p.pos.y, p.pos.z;
+		velocities.row(k) << p.vel.x, p.vel.y, p.vel.z;
+
+		damping[k] = 0.0f;
+		for(const spring& s : p.springs) damping[k] += materials[s.material].mu;
+	}
+
+	pd.iterations = parameters.pdIterations;
+	pd.step(positions, velocities, vec3(0,0,parameters.gy), damping, dt);
+
+	for(int k = 0; k < N; k++) {
+
+		particle& p = particles[k];
+		p.pos = { positions(k,0), positions(k,1), positions(k,2) };
+		p.vel = { velocities(k,0), velocities(k,1), velocities(k,2) };
+
+		// Colliding with ground plane at arbitrary Z height
+		if(p.pos.z < -1.5f) {
+			p.pos.z = -1.5f;
+			p.vel = -p.vel * dt;
 		}
 	}
 }
 
 void scene_structure::display() {
+	profile_zone_cgp("display");
 	// Basics common elements
 	// ***************************************** //
 	timer.update();
+	gpuTimer.frame();
 	environment.light = environment.camera.position();
 	if (gui.display_frame)
 		draw(global_frame, environment);
@@ -67,70 +535,298 @@ void scene_structure::display() {
 	// Update simulation parameters
 	if(ImGui::Button("Update parameters")) {
 
-		for(particle& p : particles) {
+		send(simulation_command::update_springs(gui.sK, gui.sMu));
+	}
 
-			// p.mass = gui.pM;
+	if(playback.is_open()) {
+		display_playback();
+		return;
+	}
 
-			// Edge springs
-			for(int i = 0; i < 2; i++) {
+	// Latest state completed by the simulation thread
+	snapshots.update();
+	simulation_snapshot const& state = snapshots.read_buffer();
+	std::vector<vec3> const& position = state.positions;
 
-				p.springs[i].K = gui.sK;
-				p.springs[i].mu = gui.sMu;
-				// p.springs[i].L0 = gui.sL0;
-			}
+	if(gui.displayParticles) {
 
-			// Cube diagonal spring
-			if(p.springs.size() > 2) {
+		profile_zone_cgp("draw particles");
+		gpu_timer_scope gpuPass(gpuTimer, "draw particles");
+		particle_sphere.shading.color = { 0,0,0 };
+		for(const vec3& p : position) {
 
-				// float cubeDiag = gui.sL0 * sqrt(3);
-				// cubeDiag = 4;
-				p.springs[2].K = gui.sK;
-				p.springs[2].mu = gui.sMu;
-				// p.springs[2].L0 = cubeDiag;
-			}
+			particle_sphere.transform.translation = p;
+			draw(particle_sphere,environment);
 		}
 	}
 
-	simulation_step(timer.scale * 0.01f);
-
-	if(gui.displayParticles || gui.displaySprings) {
+	particle_sphere.shading.color = { 0,0,1 };
+	for(unsigned int k : state.pinned) {
 
-		for(const particle& p : particles) {
-
-			particle_sphere.transform.translation = p.pos;
-			particle_sphere.shading.color = { 0,0,0 };
-
-			if(gui.displayParticles) draw(particle_sphere,environment);
-
-			if(gui.displaySprings) {
+		particle_sphere.transform.translation = position[k];
+		draw(particle_sphere,environment);
+	}
 
-				for(const spring& s : p.springs) {
+	if(gui.displaySprings) {
 
-					if(s.isDrawn) draw_segment(p.pos,*s.posOther);
-				}
-			}
-		}
+		profile_zone_cgp("draw springs");
+		gpu_timer_scope gpuPass(gpuTimer, "draw springs");
+		for(const uint2& s : state.segments)
+			draw_segment(position[s[0]],position[s[1]]);
 	}
 
-	if(gui.displayMesh) {
+	if(gui.displayMesh && !state.cubes.empty()) {
 
+		profile_zone_cgp("draw mesh");
+		gpu_timer_scope gpuPass(gpuTimer, "draw mesh");
 		mesh shape;
-		shape.push_back(mesh_primitive_quadrangle(particles[0].pos, particles[1].pos, particles[3].pos, particles[2].pos));
-		shape.push_back(mesh_primitive_quadrangle(particles[1].pos, particles[5].pos, particles[7].pos, particles[3].pos));
-		shape.push_back(mesh_primitive_quadrangle(particles[5].pos, particles[4].pos, particles[6].pos, particles[7].pos));
-		shape.push_back(mesh_primitive_quadrangle(particles[4].pos, particles[0].pos, particles[2].pos, particles[6].pos));
-		shape.push_back(mesh_primitive_quadrangle(particles[2].pos, particles[3].pos, particles[7].pos, particles[6].pos));
-		shape.push_back(mesh_primitive_quadrangle(particles[1].pos, particles[0].pos, particles[4].pos, particles[5].pos));
+		for(size_t c = 0; c < state.cubes.size(); c += 8) {
+			unsigned int const* corner = &state.cubes[c];
+			for(const auto& q : cubeQuads)
+				shape.push_back(mesh_primitive_quadrangle(position[corner[q[0]]], position[corner[q[1]]], position[corner[q[2]]], position[corner[q[3]]]));
+		}
 		cube.clear();
 		cube.initialize(shape);
 		cube.shading.color = vec3(1,0,0);
 		draw(cube,environment);
 	}
 
+	display_jellies(timer.scale * 0.01f);
+	display_balloons(timer.scale * 0.01f);
+
+	profile_zone_cgp("draw ground");
+	gpu_timer_scope gpuPass(gpuTimer, "draw ground");
 	draw(ground,environment);
 }
 
+void scene_structure::spawn_jellies(int count) {
+
+	float const pM = 0.01f;
+	float const halfSize = 0.2f;
+
+	for(int k = 0; k < count; k++) {
+
+		vec3 const center = { rand_interval(-5,5), rand_interval(-5,5), rand_interval(0,8) };
+		shape_matching_body body;
+		body.initialize(cube_corners(center,halfSize), pM);
+		jellies.push_back(body);
+	}
+
+	// Surface of all the jellies, positions are updated at each frame
+	jelliesMesh = mesh();
+	for(unsigned int b = 0; b < jellies.size(); b++) {
+
+		unsigned int const offset = 8 * b;
+		for(const vec3& p : jellies[b].pos) jelliesMesh.position.push_back(p);
+		for(const auto& q : cubeQuads) {
+			jelliesMesh.connectivity.push_back(uint3{ offset+q[0], offset+q[1], offset+q[2] });
+			jelliesMesh.connectivity.push_back(uint3{ offset+q[0], offset+q[2], offset+q[3] });
+		}
+	}
+	jelliesMesh.fill_empty_field();
+	jelliesNormals.initialize(jelliesMesh.connectivity, jelliesMesh.position.size());
+	jelliesDrawable.clear();
+	jelliesDrawable.optimize_vertex_cache = true;
+	jelliesDrawable.initialize(jelliesMesh, "Jellies");
+	jelliesDrawable.shading.color = vec3(0.2f,0.8f,0.3f);
+}
+
+void scene_structure::display_jellies(float dt) {
+
+	if(jellies.empty()) return;
+
+	profile_zone_cgp("jellies");
+	shape_matching_parameters parameters;
+	parameters.alpha = gui.jellyStiffness;
+	parameters.gravity = { 0,0,gui.gy };
+	shape_matching_step(jellies, parameters, dt);
+
+	int offset = 0;
+	for(const shape_matching_body& body : jellies)
+		for(const vec3& p : body.pos)
+			jelliesMesh.position[offset++] = p;
+	jelliesNormals.update(jelliesMesh.position, jelliesMesh.normal);
+	jelliesDrawable.update_position(jelliesMesh.position);
+	jelliesDrawable.update_normal(jelliesMesh.normal);
+
+	if(gui.displayMesh) draw(jelliesDrawable,environment);
+}
+
+void scene_structure::spawn_balloon() {
+
+	vec3 const center = { rand_interval(-3,3), rand_interval(-3,3), rand_interval(2,6) };
+	pressure_body body;
+	body.initialize(mesh_primitive_sphere(1.0f, center, 30, 15), 0.01f);
+	balloons.push_back(body);
+
+	// Drawable built on the welded surface
+	mesh shape;
+	shape.position.resize(int(body.pos.size()));
+	for(unsigned int k = 0; k < body.pos.size(); k++) shape.position[k] = body.pos[k];
+	for(const uint3& t : body.triangles) shape.connectivity.push_back(t);
+	shape.fill_empty_field();
+
+	mesh_drawable drawable;
+	drawable.optimize_vertex_cache = true;
+	drawable.initialize(shape, "Balloon");
+	drawable.shading.color = vec3(0.3f,0.4f,1.0f);
+	balloonsDrawable.push_back(drawable);
+
+	mesh_normal_updater normals;
+	normals.initialize(shape.connectivity, shape.position.size());
+	balloonsNormals.push_back(normals);
+}
+
+void scene_structure::display_balloons(float dt) {
+
+	if(balloons.empty()) return;
+
+	profile_zone_cgp("balloons");
+	buffer<vec3> position, normal;
+	for(unsigned int b = 0; b < balloons.size(); b++) {
+
+		pressure_body& body = balloons[b];
+		body.set_rest_pressure(gui.balloonPressure);
+		body.step(vec3(0,0,gui.gy), -1.5f, dt);
+
+		if(!gui.displayMesh) continue;
+
+		position.resize(int(body.pos.size()));
+		for(unsigned int k = 0; k < body.pos.size(); k++) position[k] = body.pos[k];
+		balloonsNormals[b].update(position, normal);
+
+		balloonsDrawable[b].update_position(position);
+		balloonsDrawable[b].update_normal(normal);
+		draw(balloonsDrawable[b],environment);
+	}
+}
+
+
+
+void scene_structure::recording_start(std::string const& filename, int encoding) {
+
+	std::vector<uint3> triangles;
+	for(size_t c = 0; c < cubes.size(); c += 8) {
+		unsigned int const* corner = &cubes[c];
+		for(const auto& q : cubeQuads) {
+			triangles.push_back(uint3{ corner[q[0]], corner[q[1]], corner[q[2]] });
+			triangles.push_back(uint3{ corner[q[0]], corner[q[2]], corner[q[3]] });
+		}
+	}
+	recorder.encoding = encoding;
+	recorder.open(filename, (unsigned int)particles.size(), triangles);
+}
+
+void scene_structure::recording_frame() {
+
+	// The recorded topology is fixed: adding particles ends the recording
+	if(particles.size() != recorder.vertex_count()) {
+		std::cout << "Trajectory: particle count changed, recording stopped" << std::endl;
+		recorder.close();
+		return;
+	}
+	if(recorder.failed()) {
+		std::cout << "Trajectory: recording stopped after a write failure" << std::endl;
+		recorder.close();
+		return;
+	}
+
+	std::vector<vec3>& frame = recorder.next_frame();
+	for(size_t k = 0; k < particles.size(); k++)
+		frame[k] = particles[k].pos;
+	recorder.submit(simulationTime);
+}
+
+
+
+bool scene_structure::playback_open(std::string const& filename) {
+
+	if(!playback.open(filename) || playback.frame_count() == 0) {
+		playback.close();
+		return false;
+	}
 
+	// Drawable allocated once, the frames then only overwrite its position/normal VBOs
+	mesh shape;
+	shape.position.resize(int(playback.vertex_count()));
+	std::vector<vec3> const& first = playback.read_frame(0);
+	for(unsigned int k = 0; k < playback.vertex_count(); k++) shape.position[k] = first[k];
+	for(const uint3& t : playback.triangles()) shape.connectivity.push_back(t);
+	shape.fill_empty_field();
+
+	playbackDrawable.clear();
+	if(shape.connectivity.size() > 0) {
+		playbackDrawable.optimize_vertex_cache = true;
+		playbackDrawable.initialize(shape, "Playback");
+		playbackDrawable.shading.color = vec3(1,0,0);
+	}
+	playbackNormal.resize(shape.position.size());
+	playbackNormals.area_weighted = true;
+	playbackNormals.initialize(shape.connectivity, shape.position.size());
+	playbackFrame = 0;
+	return true;
+}
+
+void scene_structure::playback_close() {
+
+	playback.close();
+	playbackDrawable.clear();
+}
+
+void scene_structure::display_playback() {
+
+	profile_zone_cgp("playback");
+
+	int const frameCount = playback.frame_count();
+	if(playbackRunning) playbackFrame = (playbackFrame + 1) % frameCount;
+	playbackFrame = std::max(0, std::min(frameCount - 1, playbackFrame));
+
+	// Raw frames are read in place from the mapping, quantized ones are decoded from their keyframe
+	vec3 const* position = playback.raw_frame(playbackFrame);
+	if(position == nullptr) position = playback.read_frame(playbackFrame).data();
+	unsigned int const N = playback.vertex_count();
+
+	if(!playback.triangles().empty()) {
+		playbackNormals.update(position, playbackNormal);
+		playbackDrawable.update_position(position, N);
+		playbackDrawable.update_normal(playbackNormal);
+		draw(playbackDrawable,environment);
+	}
+	else {
+		particle_sphere.shading.color = { 0,0,0 };
+		for(unsigned int k = 0; k < N; k++) {
+			particle_sphere.transform.translation = position[k];
+			draw(particle_sphere,environment);
+		}
+	}
+
+	draw(ground,environment);
+}
+
+
+
+void scene_structure::add_cube(vec3 const& center, float pM, float sK, float sMu, float sL0) {
+
+	unsigned int const offset = (unsigned int)particles.size();
+	for(const vec3& p : cube_corners(center, sL0 / 2))
+		particles.push_back(particle(pM,p,vec3(0,0,0)));
+
+	unsigned short const material = spring_material_index(materials, sK, sMu);
+	for(unsigned int k = 0; k < 8; k++)
+		for(unsigned int j : cubeEdges[k])
+			particles[offset+k].springs.push_back(spring(offset+j,material,sL0));
+
+	float cubeDiag = sL0 * sqrt(3);
+	cubeDiag = 4;
+	for(unsigned int k = 0; k < 8; k++)
+		particles[offset+k].springs.push_back(spring(offset+7-k,material,cubeDiag));
+
+	for(unsigned int k = 0; k < 8; k++)
+		cubes.push_back(offset+k);
+	topologyVersion++;
+	islands_build();
+	projective_dynamics_initialize();
+}
 
 void scene_structure::initialize() {
 
@@ -145,65 +841,16 @@ void scene_structure::initialize() {
 	// }
 	// for(int i = 1; i < len; i++) {
 
-	// 	particles[i].springs.push_back(spring(&particles[i-1].pos,len*1.0f,0.01f,dl));
-	// 	if(i < len-1) particles[i].springs.push_back(spring(&particles[i+1].pos,len*1.0f,0.01f,dl));
+	// 	particles[i].springs.push_back(spring(i-1,len*1.0f,0.01f,dl));
+	// 	if(i < len-1) particles[i].springs.push_back(spring(i+1,len*1.0f,0.01f,dl));
 	// }
 
-	// CUBE
-	//   4----5
-	//  /|   /| 
-	// 0----1 |
-	// | 6--|-7
-	// |/   |/
-	// 2----3
 	float zPosCube = 5;
 	float pM = 0.01f;	
 	float sK = 3.0f;
 	float sMu = 0.01f;
 	float sL0 = 2.0f;
-	particles.push_back(particle(pM,vec3(1,-1,1+zPosCube),vec3(0,0,0)));
-	particles.push_back(particle(pM,vec3(1,1,1+zPosCube),vec3(0,0,0)));
-	particles.push_back(particle(pM,vec3(1,-1,-1+zPosCube),vec3(0,0,0)));
-	particles.push_back(particle(pM,vec3(1,1,-1+zPosCube),vec3(0,0,0)));
-	particles.push_back(particle(pM,vec3(-1,-1,1+zPosCube),vec3(0,0,0)));
-	particles.push_back(particle(pM,vec3(-1,1,1+zPosCube),vec3(0,0,0)));
-	particles.push_back(particle(pM,vec3(-1,-1,-1+zPosCube),vec3(0,0,0)));
-	particles.push_back(particle(pM,vec3(-1,1,-1+zPosCube),vec3(0,0,0)));
-	particles[0].springs.push_back(spring(&particles[4].pos,sK,sMu,sL0));
-	particles[0].springs.push_back(spring(&particles[1].pos,sK,sMu,sL0));
-	particles[0].springs.push_back(spring(&particles[2].pos,sK,sMu,sL0));
-	particles[1].springs.push_back(spring(&particles[5].pos,sK,sMu,sL0));
-	particles[1].springs.push_back(spring(&particles[0].pos,sK,sMu,sL0));
-	particles[1].springs.push_back(spring(&particles[3].pos,sK,sMu,sL0));
-	particles[2].springs.push_back(spring(&particles[6].pos,sK,sMu,sL0));
-	particles[2].springs.push_back(spring(&particles[3].pos,sK,sMu,sL0));
-	particles[2].springs.push_back(spring(&particles[0].pos,sK,sMu,sL0));
-	particles[3].springs.push_back(spring(&particles[7].pos,sK,sMu,sL0));
-	particles[3].springs.push_back(spring(&particles[2].pos,sK,sMu,sL0));
-	particles[3].springs.push_back(spring(&particles[1].pos,sK,sMu,sL0));
-	particles[4].springs.push_back(spring(&particles[0].pos,sK,sMu,sL0));
-	particles[4].springs.push_back(spring(&particles[5].pos,sK,sMu,sL0));
-	particles[4].springs.push_back(spring(&particles[6].pos,sK,sMu,sL0));
-	particles[5].springs.push_back(spring(&particles[1].pos,sK,sMu,sL0));
-	particles[5].springs.push_back(spring(&particles[4].pos,sK,sMu,sL0));
-	particles[5].springs.push_back(spring(&particles[7].pos,sK,sMu,sL0));
-	particles[6].springs.push_back(spring(&particles[2].pos,sK,sMu,sL0));
-	particles[6].springs.push_back(spring(&particles[7].pos,sK,sMu,sL0));
-	particles[6].springs.push_back(spring(&particles[4].pos,sK,sMu,sL0));
-	particles[7].springs.push_back(spring(&particles[3].pos,sK,sMu,sL0));
-	particles[7].springs.push_back(spring(&particles[6].pos,sK,sMu,sL0));
-	particles[7].springs.push_back(spring(&particles[5].pos,sK,sMu,sL0));
-
-	float cubeDiag = sL0 * sqrt(3);
-	cubeDiag = 4;
-	particles[0].springs.push_back(spring(&particles[7].pos,sK,sMu,cubeDiag));
-	particles[7].springs.push_back(spring(&particles[0].pos,sK,sMu,cubeDiag));
-	particles[1].springs.push_back(spring(&particles[6].pos,sK,sMu,cubeDiag));
-	particles[6].springs.push_back(spring(&particles[1].pos,sK,sMu,cubeDiag));
-	particles[2].springs.push_back(spring(&particles[5].pos,sK,sMu,cubeDiag));
-	particles[3].springs.push_back(spring(&particles[4].pos,sK,sMu,cubeDiag));
-	particles[5].springs.push_back(spring(&particles[2].pos,sK,sMu,cubeDiag));
-	particles[4].springs.push_back(spring(&particles[3].pos,sK,sMu,cubeDiag));
+	add_cube(vec3(0,0,zPosCube), pM, sK, sMu, sL0);
 
 	mesh groundMesh = mesh_primitive_quadrangle(vec3(1000,-1000,-1.5f),vec3(1000,1000,-1.5f),vec3(-1000,1000,-1.5f),vec3(-1000,-1000,-1.5f));
 	ground.initialize(groundMesh);
@@ -224,10 +871,47 @@ void scene_structure::initialize() {
 	gui.sK = sK;
 	gui.sMu = sMu;
 	// gui.sL0 = sL0;
+
+	parameters = simulation_parameters_of(gui, timer.scale);
+	sentParameters = parameters;
+	simulation_start();
 }
 
 void scene_structure::display_gui() {
 
+	profile_zone_cgp("gui");
+	ImGui::Checkbox("Profiler",&gui.displayProfiler);
+	if(gui.displayProfiler) profiler.display(gpuTimer);
+
+	if(playback.is_open()) {
+		ImGui::Text("Playback: %d frames, t = %.2f s", playback.frame_count(), playback.frame_time(playbackFrame));
+		ImGui::SliderInt("Frame",&playbackFrame,0,playback.frame_count()-1);
+		ImGui::Checkbox("Play",&playbackRunning);
+		if(ImGui::Button("Back to simulation")) playback_close();
+		return;
+	}
+
+	// Statistics of the simulation thread, and parameters it changed itself (e.g. loaded from a checkpoint)
+	snapshots.update();
+	simulation_snapshot const& state = snapshots.read_buffer();
+	if(state.parametersVersion != adoptedParametersVersion) {
+
+		simulation_parameters const& p = state.parameters;
+		gui.gy = p.gy;
+		gui.sK = p.sK;
+		gui.sMu = p.sMu;
+		gui.solver = p.solver;
+		gui.pdIterations = p.pdIterations;
+		gui.sleeping = p.sleeping;
+		gui.adaptive = p.adaptive;
+		gui.adaptiveError = p.adaptiveError;
+		gui.reorder = p.reorder;
+		gui.reorderInterval = p.reorderInterval;
+		timer.scale = p.timeScale;
+		sentParameters = p;
+		adoptedParametersVersion = state.parametersVersion;
+	}
+
 	// ImGui::Checkbox("Frame", &gui.display_frame);
 	ImGui::Checkbox("Draw mesh", &gui.displayMesh);
 	ImGui::Checkbox("Draw particles", &gui.displayParticles);
@@ -237,9 +921,131 @@ void scene_structure::display_gui() {
 	ImGui::SliderFloat("Springs stiffness",&gui.sK,1.0f,5.0f);
 	ImGui::SliderFloat("Springs damping coefficient",&gui.sMu,0.001f,0.1f);
 	// ImGui::SliderFloat("Springs rest-length",&gui.sL0,1.0f,5.0f);
+	ImGui::Combo("Solver",&gui.solver,"Mass-spring\0Projective Dynamics\0");
+	if(gui.solver == solver_projective_dynamics)
+		ImGui::SliderInt("PD iterations",&gui.pdIterations,1,50);
+
+	ImGui::SliderInt("Jellies to spawn",&gui.jellyCount,1,1000);
+	ImGui::SliderFloat("Jellies stiffness",&gui.jellyStiffness,0.01f,1.0f);
+	if(ImGui::Button("Spawn jellies")) spawn_jellies(gui.jellyCount);
+
+	ImGui::Checkbox("Adaptive time step",&gui.adaptive);
+	if(gui.adaptive) {
+		ImGui::Combo("Step control",&gui.adaptiveError,"CFL bound\0Step doubling\0");
+		adaptive_timestep_statistics const& stats = state.stats;
+		ImGui::Text("Substeps: %d (rejected %d)", stats.accepted, stats.rejected);
+		ImGui::Text("dt: %.2e [%.2e, %.2e]", stats.dtLast, stats.dtMin, stats.dtMax);
+		if(gui.adaptiveError == adaptive_error_step_doubling) ImGui::Text("Local error: %.2e", stats.errorLast);
+		if(stats.truncated > 0) ImGui::Text("Substep limit reached: %.2e s not simulated", stats.truncated);
+	}
+
+	ImGui::Checkbox("Island sleeping",&gui.sleeping);
+	ImGui::Text("Sleeping islands: %d / %d", state.sleepingIslands, state.islandCount);
+	ImGui::Checkbox("Reorder particles (Morton)",&gui.reorder);
+	if(gui.reorder)
+		ImGui::SliderInt("Reorder interval (steps)",&gui.reorderInterval,0,6000);
+	if(ImGui::Button("Add cube")) {
+		vec3 const center = { rand_interval(-4,4), rand_interval(-4,4), rand_interval(2,8) };
+		send(simulation_command::add_cube(center, gui.sK, gui.sMu));
+	}
+
+	ImGui::SliderFloat("Balloons pressure",&gui.balloonPressure,0.0f,20.0f);
+	if(ImGui::Button("Spawn balloon")) spawn_balloon();
+
+	if(ImGui::Button("Save checkpoint")) send(simulation_command::checkpoint_save("checkpoint.sbk"));
+	ImGui::SameLine();
+	if(ImGui::Button("Load checkpoint")) send(simulation_command::checkpoint_load("checkpoint.sbk"));
+
+	if(!state.recording) {
+		if(ImGui::Button("Record trajectory")) {
+			int const encoding = gui.recordRaw ? trajectory_encoding_raw : trajectory_encoding_quantized;
+			send(simulation_command::record_start("trajectory.sbt", encoding));
+		}
+		ImGui::SameLine();
+		ImGui::Checkbox("Raw frames",&gui.recordRaw);
+		if(ImGui::Button("Play trajectory")) playback_open("trajectory.sbt");
+	}
+	else {
+		if(ImGui::Button("Stop recording")) send(simulation_command::record_stop());
+		ImGui::SameLine();
+		ImGui::Text("%d frames, %.1f MB", state.recordedFrames, state.recordedBytes / 1048576.0);
+	}
+
+	bool onClickXneg = ImGui::Button("-X Force"); ImGui::SameLine();
+	bool onClickXpos = ImGui::Button("+X Force");
+	bool onClickYneg = ImGui::Button("-Y Force"); ImGui::SameLine();
+	bool onClickYpos = ImGui::Button("+Y Force");
+	bool onClickZneg = ImGui::Button("-Z Force"); ImGui::SameLine();
+	bool onClickZpos = ImGui::Button("+Z Force");
+
+	vec3 impulse = { 0,0,0 };
+	if(onClickXneg) impulse += vec3(-10,0,0);
+	if(onClickXpos) impulse += vec3(10,0,0);
+	if(onClickYneg) impulse += vec3(0,-10,0);
+	if(onClickYpos) impulse += vec3(0,10,0);
+	if(onClickZneg) impulse += vec3(0,0,-10);
+	if(onClickZpos) impulse += vec3(0,0,10);
+	if(norm(impulse) > 0) send(simulation_command::impulse(impulse));
+
+	ImGui::Text("Pinned particles: %d (shift + click)", int(state.pinned.size()));
+	if(!state.pinned.empty()) {
+		ImGui::SameLine();
+		if(ImGui::Button("Release pins")) send(simulation_command::unpin_all());
+	}
+
+	// Parameter changes are sent to the simulation thread
+	simulation_parameters const p = simulation_parameters_of(gui, timer.scale);
+	if(!(p == sentParameters)) {
+		sentParameters = p;
+		send(simulation_command::set_parameters(p));
+	}
+}
+
+
+
+void scene_structure::keyboard_event(inputs_interaction_parameters const& inputs) {
+
+	// Impulses are sent once per key press
+	inputs_keyboard_parameters const& k = inputs.keyboard;
+	vec3 impulse = { 0,0,0 };
+	if(k.left && !previousKeyboard.left) impulse += vec3(-10,0,0);
+	if(k.right && !previousKeyboard.right) impulse += vec3(10,0,0);
+	if(k.up && !previousKeyboard.up) impulse += k.shift ? vec3(0,0,10) : vec3(0,10,0);
+	if(k.down && !previousKeyboard.down) impulse += k.shift ? vec3(0,0,-10) : vec3(0,-10,0);
+	previousKeyboard = k;
+
+	if(norm(impulse) > 0) send(simulation_command::impulse(impulse));
 }
 
+void scene_structure::mouse_click_event(inputs_interaction_parameters const& inputs) {
+
+	if(!inputs.mouse.click.left || !inputs.keyboard.shift || inputs.mouse.on_gui || playback.is_open()) return;
+
+	// Particle of the last snapshot closest to the ray under the cursor
+	simulation_snapshot const& state = snapshots.read_buffer();
+	vec3 const origin = environment.camera.position();
+	vec3 const direction = camera_ray_direction(environment.camera.matrix_frame(), environment.projection.matrix_inverse(), inputs.mouse.position.current);
+
+	int picked = -1;
+	float closest = 0.3f;
+	for(unsigned int k = 0; k < state.positions.size(); k++) {
 
+		vec3 const p = state.positions[k] - origin;
+		float const t = dot(p, direction);
+		float const d = norm(p - t * direction);
+		if(t > 0 && d < closest) {
+			closest = d;
+			picked = int(k);
+		}
+	}
+	if(picked < 0) return;
+
+	bool const pinned = std::find(state.pinned.begin(), state.pinned.end(), (unsigned int)picked) != state.pinned.end();
+	// The particle is sent by id: the simulation may have reordered its particles meanwhile
+	if(picked >= int(state.ids.size())) return;
+	if(pinned) send(simulation_command::unpin(state.ids[picked]));
+	else send(simulation_command::pin(state.ids[picked], state.positions[picked]));
+}
 
 void scene_structure::draw_segment(vec3 const& a, vec3 const& b) {
 
@@ -1,28 +1,85 @@
 #pragma once
 
 #include "cgp/cgp.hpp"
+#include "projective_dynamics.hpp"
+#include "shape_matching.hpp"
+#include "pressure_body.hpp"
+#include "islands.hpp"
+#include "adaptive_timestep.hpp"
+#include "trajectory.hpp"
+#include "triple_buffer.hpp"
+#include "spsc_queue.hpp"
+#include "commands.hpp"
+#include "reorder.hpp"
+
+#include <thread>
+#include <atomic>
 
 struct gui_parameters {
 	bool display_frame = false;
 	bool displayMesh = true;
 	bool displayParticles = false;
 	bool displaySprings = false;
+	bool displayProfiler = false;
 	float gy = -9.81f; // gravity
 	// float pM;	
 	float sK;
 	float sMu;
 	// float sL0;
+	int solver = solver_mass_spring;
+	int pdIterations = 10;
+	int jellyCount = 200;
+	float jellyStiffness = 0.5f;
+	float balloonPressure = 5.0f;
+	bool recordRaw = false;
+	bool sleeping = true;
+	bool adaptive = false;
+	int adaptiveError = adaptive_error_cfl;
+	bool reorder = false;
+	int reorderInterval = 600;
 };
 
-struct spring {
+// State published by the simulation thread at the end of a step, read by the renderer
+struct simulation_snapshot {
+
+	std::vector<cgp::vec3> positions;
+	std::vector<cgp::uint2> segments;		// drawn springs
+	std::vector<unsigned int> cubes;		// 8 corner indices per cube
+	std::vector<unsigned int> pinned;
+	std::vector<unsigned int> ids;			// stable id of each particle (see scene_structure::particleId), refreshed with the topology
+	int topology = -1;						// version of segments and cubes, only refreshed when it changes
+
+	float time = 0.0f;
+	int islandCount = 0;
+	int sleepingIslands = 0;
+	adaptive_timestep_statistics stats;
+	bool recording = false;
+	int recordedFrames = 0;
+	uint64_t recordedBytes = 0;
+
+	// Parameters changed by the simulation itself (checkpoint loading) are adopted by the GUI
+	simulation_parameters parameters;
+	int parametersVersion = 0;
+};
+
+// Stiffness and damping shared by the springs referencing it
+struct spring_material {
 
-	cgp::vec3* posOther;
 	float K; 				// spring stiffness
 	float mu; 				// damping coefficient
+};
+
+// Index of the material (K,mu) in the table, added if missing
+unsigned short spring_material_index(std::vector<spring_material>& materials, float K, float mu);
+
+struct spring {
+
+	unsigned int other;		// index of the other end in scene_structure::particles
 	float L0; 				// rest-length of spring
+	unsigned short material;	// index in scene_structure::materials
 	bool isDrawn;
 
-	spring(cgp::vec3* _posOther, float _K, float _mu, float _L0, bool _isDrawn = true): posOther(_posOther), K(_K), mu(_mu), L0(_L0), isDrawn(_isDrawn) {};
+	spring(unsigned int _other, unsigned short _material, float _L0, bool _isDrawn = true): other(_other), L0(_L0), material(_material), isDrawn(_isDrawn) {};
 };
 
 struct particle {
@@ -43,10 +100,118 @@ struct scene_structure {
 
 	// Particles:
 	std::vector<particle> particles;
-
-	void simulation_step(float dt);
+	std::vector<spring_material> materials;		// small table referenced by the springs
+
+	// Indices change with reorder_particles: the commands refer to particles by a stable id instead
+	std::vector<unsigned int> particleId;		// id of each particle
+	std::vector<int> particleOfId;				// current index of each id, -1 once the particle is removed
+	void particle_ids_update();
+	void particle_ids_reset();
+
+	// The particle system is simulated by a dedicated thread which owns particles, cubes, islands, pd, stepper
+	//  and recorder while it runs. The renderer only reads the snapshots published through a triple buffer,
+	//  and the GUI and input events send commands that are applied between two steps (directly when the
+	//  thread is not running). The solver itself never touches the GUI.
+	simulation_parameters parameters;
+	float simulationTime = 0.0f;
+	float stepsPerSecond = 60.0f;
+	int topologyVersion = 0;				// incremented whenever particles or springs are added or replaced
+	int parametersVersion = 0;				// incremented when the simulation changes its own parameters
+	triple_buffer<simulation_snapshot> snapshots;
+	spsc_queue<simulation_command, 256> commands;
+	std::thread simulationThread;
+	std::atomic<bool> simulationRunning { false };
+	void simulation_start();
+	void simulation_stop();
+	void simulation_run();
+	void simulation_publish();
+	// Apply the queued commands, then step, record and publish (one iteration of the simulation thread)
+	void simulation_tick(float dt);
+	void send(simulation_command const& command);
+	void apply(simulation_command const& command);
+	void set_parameters(simulation_parameters const& p);
+
+	// GUI side
+	simulation_parameters sentParameters;
+	int adoptedParametersVersion = 0;
+
+	// Input events turned into commands: arrows give impulses (shift: up/down along Z),
+	//  shift + left click pins/unpins the particle under the cursor
+	cgp::inputs_keyboard_parameters previousKeyboard;
+	void keyboard_event(cgp::inputs_interaction_parameters const& inputs);
+	void mouse_click_event(cgp::inputs_interaction_parameters const& inputs);
+
+	// Return the simulated time, shorter than dt if the adaptive stepper reached its substep limit
+	float simulation_step(float dt);
+	void simulation_integrate(float dt);
+	void simulation_accept(float dt);
+	void simulation_step_particle(particle& p, float dt);
+
+	// Adaptive substepping of simulation_integrate (see adaptive_timestep::advance)
+	adaptive_timestep stepper;
+	void save_state(simulation_state& state) const;
+	void restore_state(simulation_state const& state);
+	bool is_stable() const;
+	float stable_timestep() const;
 	void draw_segment(cgp::vec3 const& a, cgp::vec3 const& b);
 
+	// Cube bodies: indices of their 8 corners in particles, stored contiguously for each cube
+	std::vector<unsigned int> cubes;
+	void add_cube(cgp::vec3 const& center, float pM, float sK, float sMu, float sL0);
+	void apply_impulse(cgp::vec3 const& impulse);
+	void update_springs(float K, float mu);
+
+	// Renumber the particles along the Morton curve of their positions and sort the springs of each particle.
+	//  Applied after topology changes and every reorderInterval steps when parameters.reorder is set.
+	int reorderedTopology = -1;
+	int stepsSinceReorder = 0;
+	void reorder_particles();
+
+	// Particles held in place, enforced after each integration
+	std::vector<pin_constraint> pins;
+	void apply_pins();
+
+	// Connected components of the spring graph, resting ones are put to sleep
+	island_manager islands;
+	void islands_build();
+
+	// Projective Dynamics backend (the factor is cached until invalidated)
+	projective_dynamics pd;
+	bool pdOutdated = false;					// stiffnesses changed since the last initialization
+	void projective_dynamics_initialize();
+	void projective_dynamics_step(float dt);
+
+	// Meshless shape-matching bodies, rendered together as a single mesh
+	std::vector<shape_matching_body> jellies;
+	cgp::mesh jelliesMesh;
+	cgp::mesh_normal_updater jelliesNormals;
+	cgp::mesh_drawable jelliesDrawable;
+	void spawn_jellies(int count);
+	void display_jellies(float dt);
+
+	// Closed-surface bodies inflated by an internal pressure
+	std::vector<pressure_body> balloons;
+	std::vector<cgp::mesh_drawable> balloonsDrawable;
+	std::vector<cgp::mesh_normal_updater> balloonsNormals;
+	void spawn_balloon();
+	void display_balloons(float dt);
+
+	// Streaming recording of the particle positions (the cube surfaces are stored as the displayed topology)
+	trajectory_writer recorder;
+	void recording_start(std::string const& filename, int encoding);
+	void recording_frame();
+
+	// Playback of a baked trajectory in place of the simulation
+	trajectory_reader playback;
+	cgp::mesh_drawable playbackDrawable;
+	cgp::buffer<cgp::vec3> playbackNormal;
+	cgp::mesh_normal_updater playbackNormals;		// area weighted normals of the trajectory surface
+	int playbackFrame = 0;
+	bool playbackRunning = true;
+	bool playback_open(std::string const& filename);
+	void playback_close();
+	void display_playback();
+
 	// Drawable structure to display the particles and the spring
 	cgp::mesh_drawable particle_sphere;
 	cgp::segments_drawable segment;
@@ -59,6 +224,8 @@ struct scene_structure {
 	cgp::scene_environment_basic environment; // Standard environment controler
 	gui_parameters gui;                       // Standard GUI element storage
 	cgp::timer_basic timer;
+	cgp::profiler_gui profiler;
+	cgp::gpu_timer gpuTimer;		// GPU duration of the ground, mesh, particle and spring passes
 
 
 	// ****************************** //
@@ -68,6 +235,7 @@ struct scene_structure {
 	void initialize();  // Standard initialization to be called before the animation loop
 	void display();     // The frame display to be called within the animation loop
 	void display_gui(); // The display of the GUI, also called within the animation loop
+	~scene_structure();
 };
 
 
@@ -0,0 +1,115 @@
+#include "shape_matching.hpp"
+
+using namespace cgp;
+
+// Outer product a b^T
+static mat3 outer(vec3 const& a, vec3 const& b) {
+
+	return mat3{ a.x*b.x, a.x*b.y, a.x*b.z,
+	             a.y*b.x, a.y*b.y, a.y*b.z,
+	             a.z*b.x, a.z*b.y, a.z*b.z };
+}
+
+static vec3 column(mat3 const& M, int k) {
+
+	return { M(0,k), M(1,k), M(2,k) };
+}
+
+void shape_matching_body::initialize(std::vector<vec3> const& rest_positions, float particle_mass) {
+
+	int const N = int(rest_positions.size());
+	assert_cgp(N > 0, "Shape matching body requires at least one particle");
+
+	mass = particle_mass;
+	pos = rest_positions;
+	vel.assign(N, vec3(0,0,0));
+
+	vec3 center = { 0,0,0 };
+	for(const vec3& p : rest_positions) center += p;
+	center /= float(N);
+
+	rest.resize(N);
+	mat3 Aqq;
+	Aqq.fill(0.0f);
+	for(int k = 0; k < N; k++) {
+
+		rest[k] = rest_positions[k] - center;
+		Aqq += outer(rest[k], rest[k]);
+	}
+
+	// Planar or degenerated rest shapes cannot use the linear mode
+	Aqq_inv = std::abs(det(Aqq)) > 1e-5f ? inverse(Aqq) : mat3::identity();
+	rotation = rotation_transform();
+}
+
+rotation_transform shape_matching_extract_rotation(mat3 const& A, rotation_transform const& R0, int max_iterations) {
+
+	rotation_transform R = R0;
+	for(int it = 0; it < max_iterations; it++) {
+
+		mat3 const M = R.matrix();
+		vec3 omega = { 0,0,0 };
+		float d = 0.0f;
+		for(int k = 0; k < 3; k++) {
+
+			omega += cross(column(M,k), column(A,k));
+			d += dot(column(M,k), column(A,k));
+		}
+		omega /= std::abs(d) + 1e-9f;
+
+		float const w = norm(omega);
+		if(w < 1e-9f) break;
+		R = rotation_transform::from_axis_angle(omega / w, w) * R;
+	}
+	return R;
+}
+
+static void shape_matching_step_body(shape_matching_body& b, shape_matching_parameters const& parameters, float dt) {
+
+	int const N = int(b.pos.size());
+
+	vec3 center = { 0,0,0 };
+	for(const vec3& p : b.pos) center += p;
+	center /= float(N);
+
+	mat3 Apq;
+	Apq.fill(0.0f);
+	for(int k = 0; k < N; k++)
+		Apq += outer(b.pos[k] - center, b.rest[k]);
+
+	b.rotation = shape_matching_extract_rotation(Apq, b.rotation);
+	mat3 T = b.rotation.matrix();
+	if(parameters.beta > 0) {
+
+		// Volume preserving linear part blended with the rotation
+		mat3 A = Apq * b.Aqq_inv;
+		float const d = det(A);
+		if(d > 1e-6f) {
+			A /= std::cbrt(d);
+			T = parameters.beta * A + (1 - parameters.beta) * T;
+		}
+	}
+
+	float const damping = std::max(0.0f, 1.0f - parameters.damping);
+	for(int k = 0; k < N; k++) {
+
+		vec3 const goal = T * b.rest[k] + center;
+		vec3& p = b.pos[k];
+		vec3& v = b.vel[k];
+
+		v = damping * (v + parameters.alpha * (goal - p) / dt + dt * parameters.gravity);
+		p += dt * v;
+
+		if(p.z < parameters.ground) {
+			p.z = parameters.ground;
+			v = -v * dt;
+		}
+	}
+}
+
+void shape_matching_step(std::vector<shape_matching_body>& bodies, shape_matching_parameters const& parameters, float dt) {
+
+	int const N_body = int(bodies.size());
+
+	parallel_for(0, N_body, [&](int k) { shape_matching_step_body(bodies[k], parameters, dt); }, 16);
+}
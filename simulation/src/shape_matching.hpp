@@ -0,0 +1,34 @@
+#pragma once
+
+#include "cgp/cgp.hpp"
+
+// Meshless deformable body (Muller et al. 2005, "Meshless deformations based on shape matching").
+//  No spring is stored: each step, the particles are pulled toward the rest shape transformed by the
+//  best rigid (or linear) transformation matching the current positions.
+struct shape_matching_body {
+
+	std::vector<cgp::vec3> pos;
+	std::vector<cgp::vec3> vel;
+	float mass;						// mass of each particle
+
+	std::vector<cgp::vec3> rest;	// q_i: rest positions relative to the rest center of mass
+	cgp::mat3 Aqq_inv;				// (sum q_i q_i^T)^-1, precomputed once (uniform masses cancel out)
+	cgp::rotation_transform rotation;	// last extracted rotation, used as warm start
+
+	void initialize(std::vector<cgp::vec3> const& rest_positions, float particle_mass);
+};
+
+struct shape_matching_parameters {
+
+	float alpha = 0.5f;		// stiffness in [0,1] (1: rigid)
+	float beta = 0.0f;		// blend between rotation (0) and linear transformation (1)
+	float damping = 0.01f;	// linear damping of the velocity
+	cgp::vec3 gravity = { 0,0,-9.81f };
+	float ground = -1.5f;	// z position of the ground plane
+};
+
+// Optimal rotation of the deformation A, computed iteratively from the warm start R (Muller et al. 2016)
+cgp::rotation_transform shape_matching_extract_rotation(cgp::mat3 const& A, cgp::rotation_transform const& R, int max_iterations = 10);
+
+// Advance all the bodies by dt. The bodies are independent and processed in parallel.
+void shape_matching_step(std::vector<shape_matching_body>& bodies, shape_matching_parameters const& parameters, float dt);
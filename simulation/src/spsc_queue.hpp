@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue with a single producer thread and a single consumer thread
+template <typename T, size_t capacity>
+struct spsc_queue {
+
+	// Producer side, return false if the queue is full
+	bool push(T&& value) {
+
+		size_t const t = tail.load(std::memory_order_relaxed);
+		size_t const next = (t + 1) % capacity;
+		if(next == head.load(std::memory_order_acquire)) return false;
+		slots[t] = std::move(value);
+		tail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side, return false if the queue is empty
+	bool pop(T& value) {
+
+		size_t const h = head.load(std::memory_order_relaxed);
+		if(h == tail.load(std::memory_order_acquire)) return false;
+		value = std::move(slots[h]);
+		head.store((h + 1) % capacity, std::memory_order_release);
+		return true;
+	}
+
+private:
+	T slots[capacity];
+	std::atomic<size_t> head { 0 };
+	std::atomic<size_t> tail { 0 };
+};
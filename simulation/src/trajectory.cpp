@@ -0,0 +1,510 @@
+#include "trajectory.hpp"
+
+#include <cstring>
+
+using namespace cgp;
+
+static const char trajectory_magic[8] = { 'S','B','T','R','A','J',0,0 };
+static const char trajectory_record_marker[4] = { 'F','R','M',0 };
+static const float quantization_levels = 65535.0f;
+
+// Quantization of a coordinate relative to the frame bounding box (shared by the encoder and the decoder)
+static int quantize(float x, float low, float scale) {
+
+	float const q = std::round((x - low) * scale);
+	return int(std::max(0.0f, std::min(quantization_levels, q)));
+}
+
+static float dequantize(int q, float low, float step) {
+
+	return low + float(q) * step;
+}
+
+// Bounding box of the frame
+static void frame_box(std::vector<vec3> const& positions, vec3& low, vec3& high) {
+
+	low = positions.empty() ? vec3(0,0,0) : positions[0];
+	high = low;
+	for(const vec3& p : positions) {
+		low = { std::min(low.x,p.x), std::min(low.y,p.y), std::min(low.z,p.z) };
+		high = { std::max(high.x,p.x), std::max(high.y,p.y), std::max(high.z,p.z) };
+	}
+}
+
+// Quantization scale and step of each axis
+static void frame_quantization(vec3 const& low, vec3 const& high, vec3& scale, vec3& step) {
+
+	for(int a = 0; a < 3; a++) {
+		float const extent = high[a] - low[a];
+		scale[a] = extent > 0 ? quantization_levels / extent : 0.0f;
+		step[a] = extent / quantization_levels;
+	}
+}
+
+// Prediction of a vertex of a non-key frame from its two previous decoded positions (one after a keyframe)
+static vec3 predict(std::vector<vec3> const* previous, size_t i) {
+
+	if(previous[1].empty()) return previous[0][i];
+	return 2.0f * previous[0][i] - previous[1][i];
+}
+
+static uint32_t zigzag(int value) {
+
+	return (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+}
+
+static int unzigzag(uint32_t v) {
+
+	return int(v >> 1) ^ -int(v & 1);
+}
+
+// Residuals are bit-packed by blocks of residual_block values, each block using the width of its largest value
+static const size_t residual_block = 32;
+
+static void pack_residuals(std::vector<uint32_t> const& values, std::vector<uint8_t>& out) {
+
+	for(size_t start = 0; start < values.size(); start += residual_block) {
+
+		size_t const end = std::min(values.size(), start + residual_block);
+		uint32_t combined = 0;
+		for(size_t k = start; k < end; k++) combined |= values[k];
+		int width = 0;
+		while(width < 32 && (combined >> width) != 0) width++;
+		out.push_back(uint8_t(width));
+
+		uint64_t bits = 0;
+		int count = 0;
+		for(size_t k = start; k < end; k++) {
+			bits |= uint64_t(values[k]) << count;
+			count += width;
+			while(count >= 8) {
+				out.push_back(uint8_t(bits));
+				bits >>= 8;
+				count -= 8;
+			}
+		}
+		if(count > 0) out.push_back(uint8_t(bits));
+	}
+}
+
+// Unpack N values, a truncated stream reads as zeros
+static void unpack_residuals(uint8_t const* in, uint8_t const* end, size_t N, std::vector<uint32_t>& values) {
+
+	values.assign(N, 0);
+	for(size_t start = 0; start < N && in < end; start += residual_block) {
+
+		size_t const last = std::min(N, start + residual_block);
+		int const width = std::min(32, int(*in++));
+		uint32_t const mask = width == 32 ? 0xffffffffu : (1u << width) - 1;
+
+		uint64_t bits = 0;
+		int count = 0;
+		for(size_t k = start; k < last; k++) {
+			while(count < width && in < end) {
+				bits |= uint64_t(*in++) << count;
+				count += 8;
+			}
+			values[k] = uint32_t(bits) & mask;
+			bits >>= width;
+			count -= width;
+		}
+	}
+}
+
+
+
+trajectory_writer::~trajectory_writer() {
+
+	close();
+}
+
+bool trajectory_writer::open(std::string const& filename, unsigned int vertexCount, std::vector<uint3> const& triangles) {
+
+	close();
+	file = std::fopen(filename.c_str(), "wb");
+	if(file == nullptr) {
+		std::cout << "Trajectory: cannot open " << filename << " for writing" << std::endl;
+		return false;
+	}
+
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, trajectory_magic, sizeof(header.magic));
+	header.version = trajectory_version;
+	header.encoding = uint32_t(encoding);
+	header.vertexCount = vertexCount;
+	header.triangleCount = uint32_t(triangles.size());
+	header.keyframeInterval = uint32_t(std::max(1, keyframeInterval));
+
+	bool const valid = std::fwrite(&header, sizeof(header), 1, file) == 1
+		&& (triangles.empty() || std::fwrite(triangles.data(), sizeof(uint3), triangles.size(), file) == triangles.size());
+	if(!valid) {
+		std::cout << "Trajectory: cannot write " << filename << std::endl;
+		std::fclose(file);
+		file = nullptr;
+		return false;
+	}
+
+	table.clear();
+	pending.clear();
+	previous[0].clear();
+	previous[1].clear();
+	stopping = false;
+	error = false;
+	submitted = 0;
+	written = sizeof(header) + triangles.size() * sizeof(uint3);
+
+	worker = std::thread(&trajectory_writer::run, this);
+	return true;
+}
+
+bool trajectory_writer::close() {
+
+	if(file == nullptr) return true;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	changed.notify_all();
+	worker.join();
+
+	// After a failed write the header is left open: the reader recovers the complete frames by scanning
+	if(!error) {
+		header.frameCount = uint32_t(table.size());
+		header.frameTableOffset = written;
+		error = (!table.empty() && std::fwrite(table.data(), sizeof(trajectory_frame), table.size(), file) != table.size())
+			|| std::fseek(file, 0, SEEK_SET) != 0
+			|| std::fwrite(&header, sizeof(header), 1, file) != 1;
+	}
+	error = std::fclose(file) != 0 || error;
+	file = nullptr;
+	if(error) std::cout << "Trajectory: write failed, the recording is incomplete" << std::endl;
+	return !error;
+}
+
+bool trajectory_writer::is_open() const {
+
+	return file != nullptr;
+}
+
+bool trajectory_writer::failed() const {
+
+	std::lock_guard<std::mutex> guard(lock);
+	return error;
+}
+
+unsigned int trajectory_writer::vertex_count() const {
+
+	return header.vertexCount;
+}
+
+int trajectory_writer::frame_count() const {
+
+	return submitted;
+}
+
+uint64_t trajectory_writer::bytes_written() const {
+
+	std::lock_guard<std::mutex> guard(lock);
+	return written;
+}
+
+std::vector<vec3>& trajectory_writer::next_frame() {
+
+	std::unique_lock<std::mutex> guard(lock);
+	changed.wait(guard, [this]() { return int(pending.size()) < maxPendingFrames; });
+	if(!pool.empty()) {
+		current.swap(pool.back());
+		pool.pop_back();
+	}
+	current.resize(header.vertexCount);
+	return current;
+}
+
+void trajectory_writer::submit(float time) {
+
+	assert_cgp_no_msg(current.size() == header.vertexCount);
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		pending.emplace_back(std::move(current), time);
+		current = std::vector<vec3>();
+	}
+	submitted++;
+	changed.notify_all();
+}
+
+void trajectory_writer::run() {
+
+	profile_thread_cgp("trajectory writer");
+	std::unique_lock<std::mutex> guard(lock);
+	while(true) {
+
+		changed.wait(guard, [this]() { return stopping || !pending.empty(); });
+		if(pending.empty()) return;		// stopping and everything is written
+
+		std::vector<vec3> positions = std::move(pending.front().first);
+		float const time = pending.front().second;
+		pending.pop_front();
+		guard.unlock();
+
+		// Frames are dropped after a failed write (error is only written by this thread)
+		bool valid = !error;
+		size_t size = positions.size() * sizeof(vec3);
+		if(valid) {
+
+			profile_zone_cgp("write frame");
+			uint8_t const* data = reinterpret_cast<uint8_t const*>(positions.data());
+			if(header.encoding != trajectory_encoding_raw) {
+				bool const keyframe = table.size() % header.keyframeInterval == 0;
+				encode(positions, keyframe);
+				data = blob.data();
+				size = blob.size();
+			}
+
+			// The record and the frame are flushed together: a crash loses at most the frames still queued
+			trajectory_record record;
+			std::memcpy(record.marker, trajectory_record_marker, sizeof(record.marker));
+			record.index = uint32_t(table.size());
+			record.size = uint32_t(size);
+			record.time = time;
+			valid = std::fwrite(&record, sizeof(record), 1, file) == 1
+				&& std::fwrite(data, 1, size, file) == size
+				&& std::fflush(file) == 0;
+			if(!valid) std::cout << "Trajectory: write failed, the following frames are dropped" << std::endl;
+		}
+
+		guard.lock();
+		if(valid) {
+			table.push_back({ written + sizeof(trajectory_record), uint32_t(size), time });
+			written += sizeof(trajectory_record) + size;
+		}
+		error = !valid;
+		pool.push_back(std::move(positions));
+		changed.notify_all();
+	}
+}
+
+void trajectory_writer::encode(std::vector<vec3> const& positions, bool keyframe) {
+
+	size_t const N = positions.size();
+
+	vec3 low, high, scale, step;
+	frame_box(positions, low, high);
+	frame_quantization(low, high, scale, step);
+
+	blob.resize(2 * sizeof(vec3));
+	std::memcpy(blob.data(), &low, sizeof(vec3));
+	std::memcpy(blob.data() + sizeof(vec3), &high, sizeof(vec3));
+
+	if(keyframe) {
+		previous[0].clear();
+		previous[1].clear();
+	}
+
+	// The prediction uses the decoded positions (not the exact ones) so that the decoder can reproduce it
+	decoded.resize(N);
+	residuals.resize(3 * N);
+	int last[3] = { 0,0,0 };
+	for(size_t i = 0; i < N; i++) {
+
+		vec3 const guess = keyframe ? vec3(0,0,0) : predict(previous, i);
+		for(int a = 0; a < 3; a++) {
+
+			int const q = quantize(positions[i][a], low[a], scale[a]);
+			int const prediction = keyframe ? last[a] : quantize(guess[a], low[a], scale[a]);
+			residuals[3*i+a] = zigzag(q - prediction);
+			last[a] = q;
+			decoded[i][a] = dequantize(q, low[a], step[a]);
+		}
+	}
+
+	pack_residuals(residuals, blob);
+
+	previous[1].swap(previous[0]);
+	previous[0].swap(decoded);
+}
+
+
+
+bool trajectory_reader::open(std::string const& filename) {
+
+	close();
+	if(!file.open(filename)) {
+		std::cout << "Trajectory: cannot map " << filename << std::endl;
+		return false;
+	}
+
+	bool valid = file.size() >= sizeof(header);
+	if(valid) {
+		std::memcpy(&header, file.data(), sizeof(header));
+		valid = std::memcmp(header.magic, trajectory_magic, sizeof(header.magic)) == 0 && header.version == trajectory_version
+			&& (header.encoding == trajectory_encoding_quantized || header.encoding == trajectory_encoding_raw) && header.keyframeInterval > 0
+			&& sizeof(header) + uint64_t(header.triangleCount) * sizeof(uint3) <= file.size();
+	}
+	if(!valid) {
+		std::cout << "Trajectory: " << filename << " is not a valid trajectory" << std::endl;
+		close();
+		return false;
+	}
+
+	// The frame table is only written when the recording is closed
+	bool const closed = header.frameTableOffset > 0;
+	valid = closed
+		&& sizeof(header) + uint64_t(header.triangleCount) * sizeof(uint3) <= header.frameTableOffset
+		&& header.frameTableOffset + uint64_t(header.frameCount) * sizeof(trajectory_frame) <= file.size();
+	if(valid) {
+		table = reinterpret_cast<trajectory_frame const*>(file.data() + header.frameTableOffset);
+		uint64_t const rawSize = uint64_t(header.vertexCount) * sizeof(vec3);
+		for(uint32_t k = 0; valid && k < header.frameCount; k++)
+			valid = (header.encoding == trajectory_encoding_raw ? table[k].size == rawSize : table[k].size >= 2 * sizeof(vec3))
+				&& table[k].offset + table[k].size <= header.frameTableOffset;
+	}
+	if(!valid) {
+		valid = recover();
+		std::cout << "Trajectory: " << filename << (closed ? " has an invalid frame table" : " was not closed") << ", "
+			<< header.frameCount << " frames recovered" << std::endl;
+	}
+
+	surface.resize(header.triangleCount);
+	if(header.triangleCount > 0)
+		std::memcpy(surface.data(), file.data() + sizeof(header), surface.size() * sizeof(uint3));
+	for(const uint3& t : surface)
+		valid = valid && t[0] < header.vertexCount && t[1] < header.vertexCount && t[2] < header.vertexCount;
+	if(!valid) {
+		std::cout << "Trajectory: " << filename << " has triangles referencing missing vertices" << std::endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+// Rebuild the frame table from the records, up to the last complete frame
+bool trajectory_reader::recover() {
+
+	recoveredTable.clear();
+	uint64_t const rawSize = uint64_t(header.vertexCount) * sizeof(vec3);
+	uint64_t offset = sizeof(header) + uint64_t(header.triangleCount) * sizeof(uint3);
+	while(offset + sizeof(trajectory_record) <= file.size()) {
+
+		trajectory_record record;
+		std::memcpy(&record, file.data() + offset, sizeof(record));
+		bool const complete = std::memcmp(record.marker, trajectory_record_marker, sizeof(record.marker)) == 0
+			&& record.index == recoveredTable.size()
+			&& (header.encoding == trajectory_encoding_raw ? record.size == rawSize : record.size >= 2 * sizeof(vec3))
+			&& offset + sizeof(record) + record.size <= file.size();
+		if(!complete) break;
+
+		recoveredTable.push_back({ offset + sizeof(record), record.size, record.time });
+		offset += sizeof(record) + record.size;
+	}
+
+	header.frameCount = uint32_t(recoveredTable.size());
+	header.frameTableOffset = offset;
+	table = recoveredTable.data();
+	return true;
+}
+
+void trajectory_reader::close() {
+
+	file.close();
+	table = nullptr;
+	recoveredTable.clear();
+	surface.clear();
+	decodedFrame = -1;
+	previous[0].clear();
+	previous[1].clear();
+}
+
+bool trajectory_reader::is_open() const {
+
+	return file.is_open();
+}
+
+int trajectory_reader::encoding() const {
+
+	return int(header.encoding);
+}
+
+unsigned int trajectory_reader::vertex_count() const {
+
+	return header.vertexCount;
+}
+
+int trajectory_reader::frame_count() const {
+
+	return is_open() ? int(header.frameCount) : 0;
+}
+
+float trajectory_reader::frame_time(int k) const {
+
+	return table[k].time;
+}
+
+std::vector<uint3> const& trajectory_reader::triangles() const {
+
+	return surface;
+}
+
+std::vector<vec3> const& trajectory_reader::read_frame(int k) {
+
+	assert_cgp(k >= 0 && k < frame_count(), "Frame " + str(k) + " out of range [0," + str(frame_count()) + "[");
+
+	if(k != decodedFrame) {
+
+		// Decode from the keyframe, or continue from the last decoded frame when it is on the way
+		int const keyframe = header.encoding == trajectory_encoding_raw ? k : k - k % int(header.keyframeInterval);
+		int const first = (decodedFrame >= keyframe && decodedFrame < k) ? decodedFrame + 1 : keyframe;
+		for(int f = first; f <= k; f++)
+			decode(f);
+		decodedFrame = k;
+	}
+	return previous[0];
+}
+
+vec3 const* trajectory_reader::raw_frame(int k) const {
+
+	if(header.encoding != trajectory_encoding_raw) return nullptr;
+	assert_cgp(k >= 0 && k < frame_count(), "Frame " + str(k) + " out of range [0," + str(frame_count()) + "[");
+	return reinterpret_cast<vec3 const*>(file.data() + table[k].offset);
+}
+
+void trajectory_reader::decode(int k) {
+
+	size_t const N = header.vertexCount;
+	if(header.encoding == trajectory_encoding_raw) {
+		previous[0].assign(raw_frame(k), raw_frame(k) + N);
+		return;
+	}
+	bool const keyframe = k % header.keyframeInterval == 0;
+
+	uint8_t const* in = reinterpret_cast<uint8_t const*>(file.data() + table[k].offset);
+	uint8_t const* const end = in + table[k].size;
+
+	vec3 low, high, scale, step;
+	std::memcpy(&low, in, sizeof(vec3));
+	std::memcpy(&high, in + sizeof(vec3), sizeof(vec3));
+	frame_quantization(low, high, scale, step);
+	unpack_residuals(in + 2 * sizeof(vec3), end, 3 * N, residuals);
+
+	if(keyframe) {
+		previous[0].clear();
+		previous[1].clear();
+	}
+
+	decoded.resize(N);
+	int last[3] = { 0,0,0 };
+	for(size_t i = 0; i < N; i++) {
+
+		vec3 const guess = keyframe ? vec3(0,0,0) : predict(previous, i);
+		for(int a = 0; a < 3; a++) {
+
+			int const prediction = keyframe ? last[a] : quantize(guess[a], low[a], scale[a]);
+			int const q = prediction + unzigzag(residuals[3*i+a]);
+			last[a] = q;
+			decoded[i][a] = dequantize(q, low[a], step[a]);
+		}
+	}
+
+	previous[1].swap(previous[0]);
+	previous[0].swap(decoded);
+}
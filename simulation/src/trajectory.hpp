@@ -0,0 +1,150 @@
+#pragma once
+
+#include "cgp/cgp.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+// Baked trajectory: a fixed set of vertices recorded over many frames.
+//  File layout:
+//    trajectory_header
+//    triangles    uint3[triangleCount]     (surface to display, indices into the vertices)
+//    frames       trajectory_record followed by one encoded blob per frame, appended and flushed while recording
+//    frame table  trajectory_frame[frameCount]   (written when the recording is closed)
+//
+//  frameCount and frameTableOffset are only set when the recording is closed. A file that was not closed (crash,
+//  full disk) is still readable: the frames are found by scanning their records, up to the last complete one.
+//
+//  A frame stores its bounding box followed by the positions quantized on 16 bits per axis relative to that box.
+//  Quantized values are delta encoded against a prediction, zigzag mapped and bit-packed by blocks of 32 values:
+//   - keyframes (every keyframeInterval frames) predict each vertex from the previous vertex of the same frame,
+//   - other frames predict each vertex by linear extrapolation of its two previous decoded positions.
+//  A frame is therefore decoded from its keyframe, which bounds the cost of a random access.
+//  Raw trajectories store the float positions instead (3x to 5x larger): a frame can then be used in place from
+//  the memory mapping, which gives O(1) seeks for playback.
+
+constexpr uint32_t trajectory_version = 2;
+
+enum trajectory_encoding {
+	trajectory_encoding_quantized = 0,
+	trajectory_encoding_raw = 1
+};
+
+struct trajectory_header {
+
+	char magic[8];				// "SBTRAJ" followed by zeros
+	uint32_t version;
+	uint32_t encoding;
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+	uint32_t keyframeInterval;
+	uint32_t frameCount;
+	uint64_t frameTableOffset;
+};
+
+struct trajectory_frame {
+
+	uint64_t offset;			// position of the encoded frame in the file
+	uint32_t size;				// size in bytes of the encoded frame
+	float time;
+};
+
+// Written before each encoded frame, so that the frame table can be rebuilt by scanning the file
+struct trajectory_record {
+
+	char marker[4];				// "FRM" followed by a zero
+	uint32_t index;				// frame number
+	uint32_t size;				// size in bytes of the encoded frame that follows
+	float time;
+};
+
+// Streaming recorder: frames are copied at submission and encoded/written by a background thread
+struct trajectory_writer {
+
+	int encoding = trajectory_encoding_quantized;
+	int keyframeInterval = 30;
+	int maxPendingFrames = 8;		// the producer waits when that many frames are queued
+
+	trajectory_writer() = default;
+	trajectory_writer(trajectory_writer const&) = delete;
+	trajectory_writer& operator=(trajectory_writer const&) = delete;
+	~trajectory_writer();
+
+	bool open(std::string const& filename, unsigned int vertexCount, std::vector<cgp::uint3> const& triangles);
+	// Write the frame table and close the file (waits for the pending frames). Return false if a write failed.
+	bool close();
+	bool is_open() const;
+	// A write failed: the following frames are dropped, the file keeps the frames written before
+	bool failed() const;
+
+	unsigned int vertex_count() const;
+	int frame_count() const;
+	uint64_t bytes_written() const;
+
+	// Buffer of vertex_count() positions to fill for the next frame, then call submit()
+	std::vector<cgp::vec3>& next_frame();
+	void submit(float time);
+
+private:
+	void run();
+	void encode(std::vector<cgp::vec3> const& positions, bool keyframe);
+
+	std::FILE* file = nullptr;
+	trajectory_header header;
+	std::vector<trajectory_frame> table;
+
+	std::thread worker;
+	mutable std::mutex lock;
+	std::condition_variable changed;
+	std::deque<std::pair<std::vector<cgp::vec3>, float> > pending;
+	std::vector<std::vector<cgp::vec3> > pool;		// recycled frame buffers
+	std::vector<cgp::vec3> current;
+	bool stopping = false;
+	bool error = false;
+	int submitted = 0;
+	uint64_t written = 0;
+
+	// Encoder state (worker thread only)
+	std::vector<uint8_t> blob;
+	std::vector<cgp::vec3> previous[2];			// two last decoded frames (the second one is empty after a keyframe)
+	std::vector<cgp::vec3> decoded;
+	std::vector<uint32_t> residuals;
+};
+
+// Random access reader of a baked trajectory, the file is memory mapped
+struct trajectory_reader {
+
+	bool open(std::string const& filename);
+	void close();
+	bool is_open() const;
+
+	int encoding() const;
+	unsigned int vertex_count() const;
+	int frame_count() const;
+	float frame_time(int k) const;
+	std::vector<cgp::uint3> const& triangles() const;
+
+	// Decode frame k, the result stays valid until the next call. Sequential reads (k, k+1, ...) decode one frame each.
+	std::vector<cgp::vec3> const& read_frame(int k);
+	// Positions of frame k inside the mapping for raw trajectories (no decoding nor copy), nullptr otherwise
+	cgp::vec3 const* raw_frame(int k) const;
+
+private:
+	void decode(int k);
+	bool recover();
+
+	cgp::mapped_file file;
+	trajectory_header header;
+	trajectory_frame const* table = nullptr;		// in the mapping, or recoveredTable for a file that was not closed
+	std::vector<trajectory_frame> recoveredTable;
+	std::vector<cgp::uint3> surface;
+
+	int decodedFrame = -1;						// frame held in previous[0]
+	std::vector<cgp::vec3> previous[2];
+	std::vector<cgp::vec3> decoded;
+	std::vector<uint32_t> residuals;
+};
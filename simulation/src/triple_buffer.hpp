@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+
+// Lock-free triple buffer between one writer thread and one reader thread.
+//  The writer fills write_buffer() then publish(); the reader calls update() then uses read_buffer().
+//  The two threads never access the same buffer: the third one is exchanged atomically in between, so the
+//  reader always sees the latest complete state and the writer never waits.
+template <typename T>
+struct triple_buffer {
+
+	// Writer side
+	T& write_buffer() { return buffers[back]; }
+	void publish() { back = middle.exchange(back | fresh, std::memory_order_acq_rel) & index; }
+
+	// Reader side: take the last published buffer if any, return false if nothing new was published
+	bool update() {
+
+		if(!(middle.load(std::memory_order_relaxed) & fresh)) return false;
+		front = middle.exchange(front, std::memory_order_acq_rel) & index;
+		return true;
+	}
+	T const& read_buffer() const { return buffers[front]; }
+
+private:
+	static const int index = 3;
+	static const int fresh = 4;		// set when the middle buffer was published and not read yet
+
+	T buffers[3];
+	std::atomic<int> middle { 1 };
+	int back = 0;
+	int front = 2;
+};